@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "allocation_hooks.hpp"
+
+namespace mdns::bench
+{
+/** @brief reports the heap allocations made while it is alive as
+ * "allocs/op" of the benchmark
+ */
+class AllocationCounter
+{
+public:
+    explicit AllocationCounter(benchmark::State& state)
+        : m_state(state)
+        , m_start(test::get_num_allocations())
+    {
+    }
+
+    ~AllocationCounter()
+    {
+        const auto n = test::get_num_allocations() - m_start;
+        m_state.counters["allocs/op"] = benchmark::Counter(
+            static_cast<double>(n), benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& m_state;
+    const uint64_t m_start;
+};
+
+} // namespace mdns::bench
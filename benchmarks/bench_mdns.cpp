@@ -0,0 +1,226 @@
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_Pcap.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+#include "mdns/MDNS_Parse.hpp"
+
+#include "allocation_counter.hpp"
+#include "mdns_service_setup.hpp"
+
+using namespace testing;
+using namespace mdns::test;
+using mdns::bench::AllocationCounter;
+
+
+namespace
+{
+using mdns::MDNS_ServiceProbe;
+using mdns::MDNS_ServiceSetup;
+
+const std::vector<std::string> ravenna_service{ "_ravenna", "_sub", "_http",
+    "_tcp", "local" };
+const std::vector<std::string> nmos_node_service{ "_nmos-node", "_tcp",
+    "local" };
+
+const iuring::IPAddress& source_address()
+{
+    static const auto addr = iuring::IPAddress::parse("192.168.1.50").value();
+    return addr;
+}
+
+void BM_ExtractName_Uncompressed(benchmark::State& state)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    const auto packet = create_mdns_query_packet(0x1234, ravenna_service);
+    const auto* name = packet.data() + sizeof(mdns::MDNS_Header);
+
+    mdns::name_list_t name_list;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mdns::extract_name(packet.data(),
+            packet.data() + packet.size(), name_list, name, logger));
+    }
+}
+BENCHMARK(BM_ExtractName_Uncompressed);
+
+void BM_ExtractName_Compressed(benchmark::State& state)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    const auto packet = create_mdns_reply_with_compression(0x1234);
+    // RDATA of the first answer: "myservice" + pointer to _http._tcp.local
+    const auto* name = packet.data() + sizeof(mdns::MDNS_Header) + 18 + 10;
+
+    mdns::name_list_t name_list;
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mdns::extract_name(packet.data(),
+            packet.data() + packet.size(), name_list, name, logger));
+    }
+}
+BENCHMARK(BM_ExtractName_Compressed);
+
+// parse, dispatch, encode and flush one query. The same query repeats
+// within a second so after the first iteration the rate limiter suppresses
+// the records, as it would in a query storm.
+void BM_HandleQuery(benchmark::State& state)
+{
+    MDNS_ServiceSetup setup;
+    const auto packet = create_mdns_query_packet(0, ravenna_service);
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), source_address());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        MDNS_ServiceProbe::receive(*setup.service, msg);
+        MDNS_ServiceProbe::answer_all(*setup.service);
+    }
+}
+BENCHMARK(BM_HandleQuery);
+
+// a DNS-SD announcement: PTR, SRV, TXT and A
+void BM_HandleReply_ServiceRecords(benchmark::State& state)
+{
+    MDNS_ServiceSetup setup;
+    const auto packet = create_mdns_service_reply_packet(0,
+        { "_nmos-register", "_tcp", "local" }, "registry",
+        { "registry", "local" }, 8080,
+        { "api_proto=http", "api_ver=v1.0,v1.1,v1.2,v1.3", "api_auth=false",
+            "pri=100" },
+        0xC0A80132);
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), source_address());
+
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        MDNS_ServiceProbe::receive(*setup.service, msg);
+    }
+}
+BENCHMARK(BM_HandleReply_ServiceRecords);
+
+void send_reply_benchmark(
+    benchmark::State& state, const std::vector<std::string>& service_name)
+{
+    MDNS_ServiceSetup setup;
+    const std::vector<mdns::QuestionData> questions{ mdns::QuestionData{
+        .name_list = mdns::name_list_t::from_labels(service_name).value(),
+        .type = static_cast<uint16_t>(mdns::RRType::PTR),
+        .clazz = mdns::MDNS_class::IN,
+        .question_unicast = false } };
+
+    AllocationCounter allocations(state);
+    for (auto _ : state)
+    {
+        MDNS_ServiceProbe::send_reply(
+            *setup.service, questions, source_address());
+    }
+}
+
+void BM_SendReply_Ravenna(benchmark::State& state)
+{
+    send_reply_benchmark(state, ravenna_service);
+}
+BENCHMARK(BM_SendReply_Ravenna);
+
+void BM_SendReply_NMOS(benchmark::State& state)
+{
+    send_reply_benchmark(state, nmos_node_service);
+}
+BENCHMARK(BM_SendReply_NMOS);
+
+// a browse answered from a registry of state.range(0) instances, the
+// instance records and host addresses all go to the additional section
+void BM_SendReply_RegistryBrowse(benchmark::State& state)
+{
+    MDNS_ServiceSetup setup;
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+        const auto name = "node-" + std::to_string(i);
+        if (!setup.service->add_service(mdns::MDNS_ServiceInstance{
+                .instance_name = name,
+                .service_type = { "_http", "_tcp", "local" },
+                .subtypes = {},
+                .host_name = { name, "local" },
+                .port = 8080,
+                .txt = "path=/" }))
+        {
+            state.SkipWithError("can't add the instances");
+            return;
+        }
+    }
+    const std::vector<mdns::QuestionData> questions{ mdns::QuestionData{
+        .name_list = { "_http", "_tcp", "local" },
+        .type = static_cast<uint16_t>(mdns::RRType::PTR),
+        .clazz = mdns::MDNS_class::IN,
+        .question_unicast = false } };
+
+    for (auto _ : state)
+    {
+        MDNS_ServiceProbe::send_reply(
+            *setup.service, questions, source_address());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SendReply_RegistryBrowse)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+// a recorded capture (MDNS_BENCH_CAPTURE=<pcap/pcapng>) replayed at maximum
+// speed through the receive callback, one iteration per pass over the file
+void BM_ReplayCapture(benchmark::State& state)
+{
+    const char* path = std::getenv("MDNS_BENCH_CAPTURE");
+    if (path == nullptr)
+    {
+        state.SkipWithError("MDNS_BENCH_CAPTURE not set");
+        return;
+    }
+
+    MDNS_ServiceSetup setup;
+    if (setup.recv_callbacks.empty())
+    {
+        state.SkipWithError("service did not submit a receive");
+        return;
+    }
+
+    // load once so the file reads stay out of the measurement
+    std::vector<mdns::MDNS_CapturedDatagram> datagrams;
+    auto reader = mdns::MDNS_PcapReader::open(path, setup.logger);
+    if (!reader)
+    {
+        state.SkipWithError("can't read the capture");
+        return;
+    }
+    while (auto datagram = reader->next())
+    {
+        datagrams.push_back(std::move(*datagram));
+    }
+
+    for (auto _ : state)
+    {
+        for (const auto& datagram : datagrams)
+        {
+            iuring::ReceivedMessage msg(datagram.payload.data(),
+                datagram.payload.size(), datagram.source);
+            setup.recv_callbacks.front()(msg);
+        }
+        MDNS_ServiceProbe::answer_all(*setup.service);
+    }
+    state.SetItemsProcessed(
+        state.iterations() * static_cast<int64_t>(datagrams.size()));
+}
+BENCHMARK(BM_ReplayCapture);
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
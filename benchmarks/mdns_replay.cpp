@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <mdns/MDNS_Metrics.hpp>
+#include <mdns/MDNS_Pcap.hpp>
+
+#include "mdns_service_setup.hpp"
+
+/** @brief replays a pcap/pcapng capture into MDNS_Service on mocked io_uring
+ * and prints the throughput and the service metrics.
+ *
+ * usage: iuring_mdns_replay <capture> [--max-speed] [--extract <out.pcap>]
+ *
+ * --extract writes the mdns datagrams of the capture to a minimal pcap
+ * instead, e.g. to cut them out of a large capture of the whole network.
+ */
+
+namespace
+{
+int usage(const char* name)
+{
+    std::cerr << "usage: " << name
+              << " <capture> [--max-speed] [--extract <out.pcap>]\n";
+    return 2;
+}
+
+int extract(mdns::MDNS_PcapReader& reader, const std::string& path,
+    logging::ILogger& logger)
+{
+    auto writer = mdns::MDNS_PcapWriter::create(path, logger);
+    if (!writer)
+    {
+        std::cerr << "can't create " << path << "\n";
+        return 1;
+    }
+
+    const auto group = iuring::IPAddress::parse("224.0.0.251").value();
+    while (auto datagram = reader.next())
+    {
+        iuring::ReceivedMessage msg(datagram->payload.data(),
+            datagram->payload.size(), datagram->source);
+        const std::chrono::system_clock::time_point when(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                datagram->timestamp));
+
+        // faster than the writer thread, wait for room in its ring
+        while (!writer->write(msg, group, when) &&
+            msg.get_size() <= mdns::MDNS_PcapWriter::MAX_DATAGRAM_SIZE)
+        {
+            writer->flush();
+        }
+    }
+    writer->flush();
+
+    std::cout << writer->get_num_written() << " datagrams written, "
+              << reader.get_num_skipped() << " packets skipped\n";
+    return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        return usage(argv[0]);
+    }
+
+    const std::string capture = argv[1];
+    auto speed = mdns::MDNS_ReplaySpeed::ORIGINAL;
+    std::string extract_path;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--max-speed") == 0)
+        {
+            speed = mdns::MDNS_ReplaySpeed::MAXIMUM;
+        }
+        else if (std::strcmp(argv[i], "--extract") == 0 && i + 1 < argc)
+        {
+            extract_path = argv[++i];
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    mdns::MDNS_ServiceSetup setup;
+    auto reader = mdns::MDNS_PcapReader::open(capture, setup.logger);
+    if (!reader)
+    {
+        std::cerr << "can't read " << capture << "\n";
+        return 1;
+    }
+
+    if (!extract_path.empty())
+    {
+        return extract(*reader, extract_path, setup.logger);
+    }
+
+    if (setup.recv_callbacks.empty())
+    {
+        std::cerr << "the service did not submit a receive\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto num_delivered = mdns::replay_capture(
+        *reader, speed, [&setup](const iuring::ReceivedMessage& msg) {
+            setup.recv_callbacks.front()(msg);
+            mdns::MDNS_ServiceProbe::answer_all(*setup.service);
+        });
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << num_delivered << " datagrams replayed ("
+              << reader->get_num_skipped() << " skipped) in "
+              << elapsed.count() << " s, "
+              << (elapsed.count() > 0 ? num_delivered / elapsed.count() : 0)
+              << " datagrams/s\n\n";
+    std::cout << mdns::to_prometheus_text(setup.service->get_metrics());
+    return 0;
+}
@@ -0,0 +1,562 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <mdns/MDNS_Metrics.hpp>
+
+#include "allocation_hooks.hpp"
+#include "mdns_service_setup.hpp"
+
+/** @brief synthetic mdns storm against MDNS_Service on mocked io_uring.
+ *
+ * Thousands of simulated queriers and responders send a query mix (PTR,
+ * SRV, TXT, A, ANY, QU/QM, known-answer lists) and announcement floods as
+ * Poisson arrivals in virtual time. The service runs on a single simulated
+ * realtime thread: every call into it costs the wall time it actually took,
+ * received datagrams are handled before the next drain tick, so queueing
+ * delay and saturation come out of the model rather than from the speed
+ * of the host running the simulation.
+ *
+ * A drain tick is what the service's idle task runs, called directly so
+ * the rate limiter sees virtual time. Replies are encoded and submitted
+ * to the mocked io_uring, whose work item counts them and completes them
+ * at once: the latency is from a query's arrival to the submission of its
+ * reply and leaves out the kernel and the wire.
+ *
+ * usage: iuring_mdns_storm [--queriers N] [--responders N] [--services N]
+ *            [--query-rate HZ] [--announce-rate HZ] [--duration S]
+ *            [--qu-fraction F] [--known-answers N] [--seed N]
+ *            [--sweep MAX_QUERIERS] [--metrics]
+ */
+
+namespace
+{
+using namespace mdns;
+using namespace mdns::test;
+
+using namespace std::chrono_literals;
+
+enum class QueryKind
+{
+    PTR,
+    SRV,
+    TXT,
+    A,
+    ANY,
+    NUM_KINDS
+};
+
+struct StormConfig
+{
+    size_t num_queriers = 1000;
+    size_t num_responders = 1000;
+
+    // published by the service under test, the rest of the names belong to
+    // the simulated peers
+    size_t num_services = 8;
+
+    // per querier / responder and virtual second
+    double query_rate = 1.0;
+    double announce_rate = 0.05;
+
+    double duration_s = 10.0;
+    double qu_fraction = 0.1;
+    size_t max_known_answers = 8;
+    uint64_t seed = 1;
+
+    // weights of PTR, SRV, TXT, A and ANY in the query mix
+    std::array<double, static_cast<size_t>(QueryKind::NUM_KINDS)> mix{ 40,
+        20, 15, 15, 10 };
+
+    size_t sweep_max_queriers = 0;
+    bool print_metrics = false;
+};
+
+struct StormResult
+{
+    uint64_t num_queries = 0;
+    uint64_t num_announcements = 0;
+    uint64_t num_answered = 0;
+    uint64_t num_dropped = 0;
+
+    // reply datagrams submitted to io_uring
+    uint64_t num_sent = 0;
+    uint64_t num_sent_bytes = 0;
+
+    // virtual time the simulated realtime thread spent in the service
+    std::chrono::nanoseconds busy{ 0 };
+    std::chrono::nanoseconds duration{ 0 };
+
+    std::chrono::nanoseconds p50{ 0 };
+    std::chrono::nanoseconds p99{ 0 };
+    std::chrono::nanoseconds p999{ 0 };
+
+    uint64_t peak_heap_bytes = 0;
+    MDNS_MetricsSnapshot metrics;
+};
+
+const name_list_t http_service{ "_http", "_tcp", "local" };
+const name_list_t ravenna_service{ "_ravenna", "_sub", "_http", "_tcp",
+    "local" };
+const name_list_t nmos_node_service{ "_nmos-node", "_tcp", "local" };
+
+std::string device_name(size_t ix)
+{
+    return "device-" + std::to_string(ix);
+}
+
+void append_u16(std::vector<uint8_t>& packet, uint16_t value)
+{
+    packet.push_back(static_cast<uint8_t>(value >> 8));
+    packet.push_back(static_cast<uint8_t>(value));
+}
+
+void append_name(std::vector<uint8_t>& packet, const name_list_t& name)
+{
+    const auto encoded = encode_mdns_name(name.to_vector());
+    packet.insert(packet.end(), encoded.begin(), encoded.end());
+}
+
+/** @brief one question plus a known-answer list of PTR records
+ * (RFC 6762 §7.1)
+ */
+std::vector<uint8_t> build_query(const name_list_t& qname, uint16_t qtype,
+    bool unicast_response, const std::vector<name_list_t>& known_answers)
+{
+    std::vector<uint8_t> packet;
+    append_u16(packet, 0);
+    append_u16(packet, 0);
+    append_u16(packet, 1);
+    append_u16(packet, static_cast<uint16_t>(known_answers.size()));
+    append_u16(packet, 0);
+    append_u16(packet, 0);
+
+    append_name(packet, qname);
+    append_u16(packet, qtype);
+    append_u16(packet, unicast_response ? 0x8001 : 0x0001);
+
+    for (const auto& answer : known_answers)
+    {
+        const auto rdata = encode_mdns_name(answer.to_vector());
+        append_name(packet, qname);
+        append_u16(packet, static_cast<uint16_t>(RRType::PTR));
+        append_u16(packet, 1);
+        append_u16(packet, 0);
+        append_u16(packet, 4500);
+        append_u16(packet, static_cast<uint16_t>(rdata.size()));
+        packet.insert(packet.end(), rdata.begin(), rdata.end());
+    }
+    return packet;
+}
+
+/** @brief the datagrams of the storm, built up front so the packet
+ * construction stays out of the measurements
+ */
+class StormTraffic
+{
+public:
+    static constexpr size_t NUM_QUERY_VARIANTS = 4096;
+
+    StormTraffic(const StormConfig& config, std::mt19937_64& rng)
+    {
+        const size_t num_devices =
+            std::max(config.num_services, config.num_responders);
+        std::uniform_int_distribution<size_t> pick_device(
+            0, std::max<size_t>(num_devices, 1) - 1);
+        std::uniform_int_distribution<size_t> pick_num_known(
+            0, config.max_known_answers);
+        std::bernoulli_distribution qu(config.qu_fraction);
+        std::discrete_distribution<size_t> pick_kind(
+            config.mix.begin(), config.mix.end());
+
+        for (size_t i = 0; i < NUM_QUERY_VARIANTS; i++)
+        {
+            const auto device = device_name(pick_device(rng));
+            // device names are short, appending can't fail
+            name_list_t instance{ device };
+            (void) instance.append(http_service);
+
+            name_list_t qname;
+            uint16_t qtype = 0;
+            std::vector<name_list_t> known_answers;
+            switch (static_cast<QueryKind>(pick_kind(rng)))
+            {
+            case QueryKind::PTR: {
+                static const std::array<name_list_t, 3> browse_names{
+                    http_service, ravenna_service, nmos_node_service
+                };
+                qname = browse_names[i % browse_names.size()];
+                qtype = static_cast<uint16_t>(RRType::PTR);
+                const auto num_known = pick_num_known(rng);
+                for (size_t k = 0; k < num_known; k++)
+                {
+                    name_list_t known{ device_name(pick_device(rng)) };
+                    (void) known.append(qname);
+                    known_answers.push_back(known);
+                }
+                break;
+            }
+            case QueryKind::SRV:
+                qname = instance;
+                qtype = static_cast<uint16_t>(RRType::SRV);
+                break;
+            case QueryKind::TXT:
+                qname = instance;
+                qtype = static_cast<uint16_t>(RRType::TXT);
+                break;
+            case QueryKind::A:
+                qname = { device, "local" };
+                qtype = static_cast<uint16_t>(RRType::A);
+                break;
+            case QueryKind::ANY:
+            case QueryKind::NUM_KINDS:
+                qname = instance;
+                qtype = 255;
+                break;
+            }
+            queries.push_back(
+                build_query(qname, qtype, qu(rng), known_answers));
+        }
+
+        for (size_t i = 0; i < config.num_responders; i++)
+        {
+            announcements.push_back(create_mdns_service_reply_packet(0,
+                http_service.to_vector(), device_name(i),
+                { device_name(i), "local" }, 80,
+                { "path=/", "api_ver=v1.3", "pri=" + std::to_string(i) },
+                0x0A000000 | static_cast<uint32_t>(i + 1)));
+        }
+
+        const auto num_peers = config.num_queriers + config.num_responders;
+        for (size_t i = 0; i < num_peers; i++)
+        {
+            // 10.x.y.z, clear of the service's own 192.168.1.100
+            sources.push_back(iuring::IPAddress::parse(
+                "10." + std::to_string(((i + 1) >> 16) & 0xff) + "." +
+                std::to_string(((i + 1) >> 8) & 0xff) + "." +
+                std::to_string((i + 1) & 0xff))
+                    .value());
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> queries;
+    std::vector<std::vector<uint8_t>> announcements;
+    std::vector<iuring::IPAddress> sources;
+};
+
+template <typename Func> std::chrono::nanoseconds timed(const Func& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::steady_clock::now() - start;
+}
+
+std::chrono::nanoseconds percentile(
+    std::vector<std::chrono::nanoseconds>& samples, double fraction)
+{
+    if (samples.empty())
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto ix = std::min(samples.size() - 1,
+        static_cast<size_t>(fraction * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + ix, samples.end());
+    return samples[ix];
+}
+
+StormResult run_storm(const StormConfig& config)
+{
+    std::mt19937_64 rng(config.seed);
+    const StormTraffic traffic(config, rng);
+
+    reset_peak_bytes_live();
+    MDNS_ServiceSetup setup;
+    for (size_t i = 0; i < config.num_services; i++)
+    {
+        if (!setup.service->add_service(MDNS_ServiceInstance{
+                .instance_name = device_name(i),
+                .service_type = http_service,
+                .subtypes = { "_ravenna" },
+                .host_name = { device_name(i), "local" },
+                .port = 80,
+                .txt = "path=/" }))
+        {
+            std::cerr << "invalid service name " << device_name(i) << "\n";
+            std::exit(1);
+        }
+    }
+    if (setup.recv_callbacks.empty())
+    {
+        std::cerr << "the service did not submit a receive\n";
+        std::exit(1);
+    }
+    const auto& deliver = setup.recv_callbacks.front();
+
+    const double query_rate =
+        config.query_rate * static_cast<double>(config.num_queriers);
+    const double announce_rate =
+        config.announce_rate * static_cast<double>(config.num_responders);
+    std::exponential_distribution<double> next_gap(
+        std::max(query_rate + announce_rate, 1e-9));
+    std::bernoulli_distribution is_query(
+        query_rate / std::max(query_rate + announce_rate, 1e-9));
+    std::uniform_int_distribution<size_t> pick_query(
+        0, traffic.queries.size() - 1);
+    std::uniform_int_distribution<size_t> pick_querier(
+        0, std::max<size_t>(config.num_queriers, 1) - 1);
+    std::uniform_int_distribution<size_t> pick_responder(
+        0, std::max<size_t>(config.num_responders, 1) - 1);
+
+    StormResult result;
+    result.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(config.duration_s));
+
+    // the rate limiter runs on virtual time, anchored at the start
+    const auto epoch = MDNS_RateLimiter::clock::now();
+
+    const auto gap = [&]() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double>(next_gap(rng)));
+    };
+
+    std::chrono::nanoseconds next_arrival = gap();
+    std::chrono::nanoseconds server_free{ 0 };
+    std::deque<std::chrono::nanoseconds> queued_arrivals;
+    std::vector<std::chrono::nanoseconds> latencies;
+
+    while (next_arrival < result.duration || !queued_arrivals.empty())
+    {
+        const bool arrival_first = next_arrival < result.duration &&
+            (queued_arrivals.empty() || next_arrival <= server_free);
+        if (arrival_first)
+        {
+            // completions are handled before the idle tasks of the kernel
+            const auto start = std::max(next_arrival, server_free);
+            std::chrono::nanoseconds cost;
+            if (is_query(rng))
+            {
+                const auto& packet = traffic.queries[pick_query(rng)];
+                const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+                    traffic.sources[pick_querier(rng)]);
+                const auto num_dropped =
+                    setup.service->get_num_dropped_queries();
+                cost = timed([&]() { deliver(msg); });
+                result.num_queries++;
+                if (setup.service->get_num_dropped_queries() == num_dropped)
+                {
+                    queued_arrivals.push_back(next_arrival);
+                }
+                else
+                {
+                    result.num_dropped++;
+                }
+            }
+            else
+            {
+                const auto responder = pick_responder(rng);
+                const auto& packet = traffic.announcements[responder];
+                const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+                    traffic.sources[config.num_queriers + responder]);
+                cost = timed([&]() { deliver(msg); });
+                result.num_announcements++;
+            }
+            server_free = start + cost;
+            result.busy += cost;
+            next_arrival += gap();
+            continue;
+        }
+
+        // one drain tick of the idle task, replies included
+        const auto tick_start = std::max(server_free, queued_arrivals.front());
+        const auto num_before = MDNS_ServiceProbe::num_pending_queries(
+            *setup.service);
+        const auto cost = timed([&]() {
+            MDNS_ServiceProbe::answer_batch(*setup.service, epoch + tick_start);
+        });
+        server_free = tick_start + cost;
+        result.busy += cost;
+
+        const auto num_answered =
+            num_before - MDNS_ServiceProbe::num_pending_queries(*setup.service);
+        for (size_t i = 0; i < num_answered; i++)
+        {
+            latencies.push_back(server_free - queued_arrivals.front());
+            queued_arrivals.pop_front();
+        }
+        result.num_answered += num_answered;
+    }
+
+    result.p50 = percentile(latencies, 0.5);
+    result.p99 = percentile(latencies, 0.99);
+    result.p999 = percentile(latencies, 0.999);
+    result.num_sent = setup.num_submitted;
+    result.num_sent_bytes = setup.num_submitted_bytes;
+    result.peak_heap_bytes =
+        g_peak_bytes_live.load(std::memory_order_relaxed);
+    result.metrics = setup.service->get_metrics();
+    return result;
+}
+
+double to_us(std::chrono::nanoseconds t)
+{
+    return std::chrono::duration<double, std::micro>(t).count();
+}
+
+double per_second(uint64_t n, std::chrono::nanoseconds t)
+{
+    const auto s = std::chrono::duration<double>(t).count();
+    return s > 0 ? static_cast<double>(n) / s : 0.0;
+}
+
+void print_header()
+{
+    std::cout << "latency: query arrival to reply submitted to io_uring "
+                 "(mocked, sends complete at once)\n";
+    std::cout << std::setw(9) << "queriers" << std::setw(12) << "offered/s"
+              << std::setw(12) << "handled/s" << std::setw(10) << "sent/s"
+              << std::setw(11) << "sent KiB/s" << std::setw(12) << "capacity/s"
+              << std::setw(7) << "util%" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us" << std::setw(10) << "p999 us"
+              << std::setw(9) << "dropped" << std::setw(11) << "heap KiB"
+              << "\n";
+}
+
+void print_row(const StormConfig& config, const StormResult& result)
+{
+    const auto num_packets = result.num_queries + result.num_announcements;
+    const auto num_handled = num_packets - result.num_dropped;
+    std::cout << std::fixed << std::setprecision(0) << std::setw(9)
+              << config.num_queriers << std::setw(12)
+              << per_second(num_packets, result.duration) << std::setw(12)
+              << per_second(num_handled, result.duration) << std::setw(10)
+              << per_second(result.num_sent, result.duration) << std::setw(11)
+              << per_second(result.num_sent_bytes, result.duration) / 1024.0
+              << std::setw(12) << per_second(num_handled, result.busy)
+              << std::setw(7)
+              << 100.0 * to_us(result.busy) / to_us(result.duration)
+              << std::setprecision(1) << std::setw(10) << to_us(result.p50)
+              << std::setw(10) << to_us(result.p99) << std::setw(10)
+              << to_us(result.p999) << std::setw(9) << result.num_dropped
+              << std::setprecision(0) << std::setw(11)
+              << static_cast<double>(result.peak_heap_bytes) / 1024.0 << "\n";
+}
+
+int usage(const char* name)
+{
+    std::cerr << "usage: " << name
+              << " [--queriers N] [--responders N] [--services N]\n"
+                 "    [--query-rate HZ] [--announce-rate HZ] [--duration S]\n"
+                 "    [--qu-fraction F] [--known-answers N] [--seed N]\n"
+                 "    [--sweep MAX_QUERIERS] [--metrics]\n";
+    return 2;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    StormConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--metrics")
+        {
+            config.print_metrics = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            return usage(argv[0]);
+        }
+
+        const char* value = argv[++i];
+        if (arg == "--queriers")
+        {
+            config.num_queriers = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--responders")
+        {
+            config.num_responders = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--services")
+        {
+            config.num_services = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--query-rate")
+        {
+            config.query_rate = std::strtod(value, nullptr);
+        }
+        else if (arg == "--announce-rate")
+        {
+            config.announce_rate = std::strtod(value, nullptr);
+        }
+        else if (arg == "--duration")
+        {
+            config.duration_s = std::strtod(value, nullptr);
+        }
+        else if (arg == "--qu-fraction")
+        {
+            config.qu_fraction = std::strtod(value, nullptr);
+        }
+        else if (arg == "--known-answers")
+        {
+            config.max_known_answers = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--seed")
+        {
+            config.seed = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--sweep")
+        {
+            config.sweep_max_queriers = std::strtoull(value, nullptr, 10);
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    print_header();
+    StormResult result;
+    if (config.sweep_max_queriers == 0)
+    {
+        result = run_storm(config);
+        print_row(config, result);
+    }
+    else
+    {
+        // double the queriers until the single instance can't keep up
+        for (config.num_queriers = 100;
+             config.num_queriers <= config.sweep_max_queriers;
+             config.num_queriers *= 2)
+        {
+            result = run_storm(config);
+            print_row(config, result);
+            if (result.num_dropped > 0)
+            {
+                std::cout << "saturated at " << config.num_queriers
+                          << " queriers\n";
+                break;
+            }
+        }
+    }
+
+    rusage resources{};
+    getrusage(RUSAGE_SELF, &resources);
+    std::cout << "max rss: " << resources.ru_maxrss << " KiB\n";
+
+    if (config.print_metrics)
+    {
+        std::cout << "\n" << to_prometheus_text(result.metrics);
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#include <mdns/MDNS_Header.hpp>
+
+#include "mdns/MDNS_Decoder.hpp"
+
+/** @brief libFuzzer target for the packet decoder.
+ *
+ * Decodes every question and record the header announces, the way
+ * MDNS_Service does, and aborts when that takes more than a small fixed
+ * cost plus a per-byte bound, so a packet that makes the decoder
+ * super-linear is reported like a crash.
+ *
+ * The per-byte bound is sized from the worst linear inputs (a 9000 byte
+ * packet packed with A records or one-byte TXT strings): about 210 cycles
+ * per byte under ASan and UBSan, 50 without. 500 leaves headroom for the
+ * coverage instrumentation on top; a decoder that follows a compression
+ * chain per name, or rescans the packet per record, costs thousands.
+ *
+ * Without a cycle counter the bound is in nanoseconds instead, which is
+ * the same bound on any core running at 1 GHz or more.
+ *
+ *   cmake -DMDNS_BUILD_FUZZERS=ON -DCMAKE_CXX_COMPILER=clang++ ...
+ *   ./fuzz_mdns_decoder -max_len=9000 corpus/
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#ifndef MDNS_FUZZ_MAX_CYCLES_PER_BYTE
+#define MDNS_FUZZ_MAX_CYCLES_PER_BYTE 500
+#endif
+
+#ifndef MDNS_FUZZ_BASE_CYCLES
+#define MDNS_FUZZ_BASE_CYCLES 50000
+#endif
+#else
+#ifndef MDNS_FUZZ_MAX_NS_PER_BYTE
+#define MDNS_FUZZ_MAX_NS_PER_BYTE 500
+#endif
+
+#ifndef MDNS_FUZZ_BASE_NS
+#define MDNS_FUZZ_BASE_NS 50000
+#endif
+#endif
+
+namespace
+{
+#if defined(__x86_64__) || defined(__i386__)
+constexpr const char* UNIT = "cycles";
+constexpr uint64_t BASE_COST = MDNS_FUZZ_BASE_CYCLES;
+constexpr uint64_t MAX_COST_PER_BYTE = MDNS_FUZZ_MAX_CYCLES_PER_BYTE;
+
+uint64_t read_clock()
+{
+    return __rdtsc();
+}
+#else
+constexpr const char* UNIT = "ns";
+constexpr uint64_t BASE_COST = MDNS_FUZZ_BASE_NS;
+constexpr uint64_t MAX_COST_PER_BYTE = MDNS_FUZZ_MAX_NS_PER_BYTE;
+
+uint64_t read_clock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+size_t decode(const uint8_t* data, size_t size)
+{
+    if (size < sizeof(mdns::MDNS_Header))
+    {
+        return 0;
+    }
+
+    const auto* hdr = reinterpret_cast<const mdns::MDNS_Header*>(data);
+    mdns::MDNS_Decoder decoder(
+        data, data + size, data + sizeof(mdns::MDNS_Header));
+
+    // a bad entry does not end the message as long as the decoder got past
+    // it, so the entries behind it are decoded as well; every iteration
+    // either consumes input or stops, which keeps the loops linear
+    size_t num_decoded = 0;
+    for (int i = 0; i < hdr->get_num_questions(); i++)
+    {
+        const auto* pos = decoder.get_position();
+        mdns::QuestionData question{};
+        if (decoder.read_question(question))
+        {
+            num_decoded++;
+        }
+        else if (decoder.get_position() == pos)
+        {
+            return num_decoded;
+        }
+    }
+
+    const int num_records = hdr->get_num_answers() +
+                            hdr->get_num_authority() +
+                            hdr->get_num_additional();
+    for (int i = 0; i < num_records; i++)
+    {
+        const auto* pos = decoder.get_position();
+        if (decoder.read_record())
+        {
+            num_decoded++;
+        }
+        else if (decoder.get_position() == pos)
+        {
+            return num_decoded;
+        }
+    }
+    return num_decoded;
+}
+
+} // anonymous namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const uint64_t budget = BASE_COST + MAX_COST_PER_BYTE * size;
+
+    // the first run of an input pays for cold caches and page faults, a
+    // preemption can hit any run: only the best of a few runs counts
+    uint64_t best = UINT64_MAX;
+    for (int attempt = 0; attempt < 3 && best > budget; attempt++)
+    {
+        const auto start = read_clock();
+        decode(data, size);
+        best = std::min(best, read_clock() - start);
+    }
+
+    if (best > budget)
+    {
+        std::fprintf(stderr,
+            "mdns decoder took %llu %s for %zu bytes (budget %llu)\n",
+            static_cast<unsigned long long>(best), UNIT, size,
+            static_cast<unsigned long long>(budget));
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mdns
+{
+/** @brief a domain name held inline in wire format (RFC 1035 §3.1).
+ *
+ * The length prefixed labels (without the root label) and the offset of
+ * each label live in fixed size arrays, so building, copying and comparing
+ * names never allocates. Labels are handed out as string_views into the
+ * name and it can be iterated like the std::vector<std::string> it
+ * replaces. Fixed names are best written as mdns_name<"a.b.c">, which
+ * builds them at compile time.
+ */
+class DNSName
+{
+public:
+    // RFC 1035 §2.3.4, the wire length includes the root label
+    static constexpr size_t MAX_WIRE_LENGTH = 255;
+    static constexpr size_t MAX_LABEL_LENGTH = 63;
+
+    // every label takes its length byte and at least one character
+    static constexpr size_t MAX_LABELS = (MAX_WIRE_LENGTH - 1) / 2;
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::string_view;
+
+        constexpr const_iterator() = default;
+        constexpr const_iterator(const DNSName* name, size_t ix)
+            : m_name(name)
+            , m_ix(ix)
+        {
+        }
+
+        constexpr std::string_view operator*() const
+        {
+            return (*m_name)[m_ix];
+        }
+
+        constexpr std::string_view operator[](difference_type n) const
+        {
+            return (*m_name)[m_ix + n];
+        }
+
+        constexpr const_iterator& operator++()
+        {
+            m_ix++;
+            return *this;
+        }
+
+        constexpr const_iterator operator++(int)
+        {
+            auto ret = *this;
+            m_ix++;
+            return ret;
+        }
+
+        constexpr const_iterator& operator--()
+        {
+            m_ix--;
+            return *this;
+        }
+
+        constexpr const_iterator operator--(int)
+        {
+            auto ret = *this;
+            m_ix--;
+            return ret;
+        }
+
+        constexpr const_iterator& operator+=(difference_type n)
+        {
+            m_ix += n;
+            return *this;
+        }
+
+        constexpr const_iterator& operator-=(difference_type n)
+        {
+            m_ix -= n;
+            return *this;
+        }
+
+        friend constexpr const_iterator operator+(
+            const_iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend constexpr const_iterator operator+(
+            difference_type n, const_iterator it)
+        {
+            return it += n;
+        }
+
+        friend constexpr const_iterator operator-(
+            const_iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend constexpr difference_type operator-(
+            const const_iterator& a, const const_iterator& b)
+        {
+            return static_cast<difference_type>(a.m_ix) -
+                static_cast<difference_type>(b.m_ix);
+        }
+
+        constexpr bool operator==(const const_iterator& other) const
+        {
+            return m_ix == other.m_ix;
+        }
+
+        constexpr auto operator<=>(const const_iterator& other) const
+        {
+            return m_ix <=> other.m_ix;
+        }
+
+    private:
+        const DNSName* m_name = nullptr;
+        size_t m_ix = 0;
+    };
+
+    using iterator = const_iterator;
+    using value_type = std::string_view;
+    using size_type = size_t;
+
+    constexpr DNSName() = default;
+
+    // for fixed names in code, names built from input (configuration,
+    // packets) go through from_labels() or push_back(). Labels that don't
+    // fit are dropped and mark the name, see valid().
+    constexpr DNSName(std::initializer_list<std::string_view> labels)
+    {
+        for (const auto label : labels)
+        {
+            if (!push_back(label))
+            {
+                m_truncated = true;
+                break;
+            }
+        }
+    }
+
+    /** @return std::nullopt when a label is empty or longer than
+     * MAX_LABEL_LENGTH or the name would exceed MAX_WIRE_LENGTH
+     */
+    static std::optional<DNSName> from_labels(
+        std::span<const std::string> labels)
+    {
+        DNSName ret;
+        for (const auto& label : labels)
+        {
+            if (!ret.push_back(label))
+            {
+                return std::nullopt;
+            }
+        }
+        return ret;
+    }
+
+    constexpr size_t size() const
+    {
+        return m_num_labels;
+    }
+
+    constexpr bool empty() const
+    {
+        return m_num_labels == 0;
+    }
+
+    /** @return false when the labels the name was constructed from didn't
+     * fit: one was empty or longer than MAX_LABEL_LENGTH, or the name
+     * longer than MAX_WIRE_LENGTH. It then holds the labels before that
+     * one and must not be published.
+     */
+    constexpr bool valid() const
+    {
+        return !m_truncated;
+    }
+
+    constexpr std::string_view operator[](size_t ix) const
+    {
+        const auto offset = m_offsets[ix];
+        return std::string_view(&m_data[offset + 1],
+            static_cast<uint8_t>(m_data[offset]));
+    }
+
+    constexpr std::string_view front() const
+    {
+        return (*this)[0];
+    }
+
+    constexpr std::string_view back() const
+    {
+        return (*this)[m_num_labels - 1];
+    }
+
+    constexpr const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    constexpr const_iterator end() const
+    {
+        return const_iterator(this, m_num_labels);
+    }
+
+    /** @return false (leaving the name unchanged) when the label is empty,
+     * longer than MAX_LABEL_LENGTH or the name would exceed
+     * MAX_WIRE_LENGTH
+     */
+    [[nodiscard]] constexpr bool push_back(std::string_view label)
+    {
+        if (label.empty() || label.size() > MAX_LABEL_LENGTH ||
+            m_length + 1 + label.size() + 1 > MAX_WIRE_LENGTH)
+        {
+            return false;
+        }
+        m_offsets[m_num_labels++] = m_length;
+        m_data[m_length] = static_cast<char>(label.size());
+        std::copy(label.begin(), label.end(), &m_data[m_length + 1]);
+        m_length += 1 + label.size();
+        return true;
+    }
+
+    /** @brief appends all labels of other, all or nothing. Fails for an
+     * invalid other as well.
+     */
+    [[nodiscard]] constexpr bool append(const DNSName& other)
+    {
+        if (!other.valid() ||
+            size_t{ m_length } + other.m_length + 1 > MAX_WIRE_LENGTH)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < other.m_num_labels; i++)
+        {
+            m_offsets[m_num_labels++] = m_length + other.m_offsets[i];
+        }
+        std::copy_n(other.m_data.begin(), other.m_length, &m_data[m_length]);
+        m_length += other.m_length;
+        return true;
+    }
+
+    constexpr void pop_back()
+    {
+        m_length = m_offsets[--m_num_labels];
+    }
+
+    constexpr void clear()
+    {
+        m_length = 0;
+        m_num_labels = 0;
+        m_truncated = false;
+    }
+
+    /** @brief the labels as they go on the wire, without the root label
+     */
+    std::span<const uint8_t> get_wire_labels() const
+    {
+        return { reinterpret_cast<const uint8_t*>(m_data.data()), m_length };
+    }
+
+    /** @brief "a.b.c" (or with another separator), allocates
+     */
+    std::string to_string(std::string_view separator = ".") const
+    {
+        std::string ret;
+        for (size_t i = 0; i < m_num_labels; i++)
+        {
+            if (i > 0)
+            {
+                ret += separator;
+            }
+            ret += (*this)[i];
+        }
+        return ret;
+    }
+
+    /** @brief for the StringUtils helpers that take string vectors
+     */
+    std::vector<std::string> to_vector() const
+    {
+        return std::vector<std::string>(begin(), end());
+    }
+
+    bool operator==(const DNSName& other) const
+    {
+        return m_length == other.m_length &&
+            memcmp(m_data.data(), other.m_data.data(), m_length) == 0;
+    }
+
+    bool operator==(const std::vector<std::string>& labels) const
+    {
+        return std::equal(begin(), end(), labels.begin(), labels.end());
+    }
+
+    /** @brief FNV-1a of the wire labels with ASCII letters folded to lower
+     * case, equal for names that only differ in case (RFC 1035 §2.3.3)
+     */
+    constexpr uint64_t get_canonical_hash() const
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < m_length; i++)
+        {
+            h = (h ^ to_lower(static_cast<uint8_t>(m_data[i]))) *
+                1099511628211ull;
+        }
+        return h;
+    }
+
+    /** @brief name equality as mdns defines it, ASCII letters compare case
+     * insensitively (RFC 6762 §16). Names equal so have the same
+     * get_canonical_hash(), use this wherever that is the key.
+     */
+    constexpr bool equals_canonical(const DNSName& other) const
+    {
+        if (m_length != other.m_length)
+        {
+            return false;
+        }
+        // length bytes are below 64 so aren't folded
+        for (size_t i = 0; i < m_length; i++)
+        {
+            if (to_lower(static_cast<uint8_t>(m_data[i])) !=
+                to_lower(static_cast<uint8_t>(other.m_data[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** @brief as equals_canonical(), but a "*" label in pattern matches any
+     * label
+     */
+    bool matches(const DNSName& pattern) const
+    {
+        if (m_num_labels != pattern.m_num_labels)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < m_num_labels; i++)
+        {
+            if (pattern[i] != "*" &&
+                !labels_equal_canonical(pattern[i], (*this)[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint8_t to_lower(uint8_t c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<uint8_t>(c + ('a' - 'A'))
+                                    : c;
+    }
+
+    static constexpr bool labels_equal_canonical(
+        std::string_view a, std::string_view b)
+    {
+        return std::ranges::equal(a, b, [](char x, char y) {
+            return to_lower(static_cast<uint8_t>(x)) ==
+                to_lower(static_cast<uint8_t>(y));
+        });
+    }
+
+    std::array<char, MAX_WIRE_LENGTH - 1> m_data{};
+    std::array<uint8_t, MAX_LABELS> m_offsets{};
+    uint8_t m_length = 0;
+    uint8_t m_num_labels = 0;
+    bool m_truncated = false;
+};
+
+using name_list_t = DNSName;
+
+/** @brief a name built at compile time, see mdns_name
+ */
+struct DNSNameLiteral
+{
+    DNSName name;
+    uint64_t canonical_hash;
+
+    constexpr operator const DNSName&() const
+    {
+        return name;
+    }
+};
+
+namespace detail
+{
+    template <size_t N> struct FixedString
+    {
+        char text[N]{};
+
+        consteval FixedString(const char (&s)[N])
+        {
+            std::copy_n(s, N, text);
+        }
+    };
+
+    template <FixedString S> consteval DNSNameLiteral make_name_literal()
+    {
+        const std::string_view text(S.text, sizeof(S.text) - 1);
+        DNSName name;
+        size_t start = 0;
+        for (size_t i = 0; i <= text.size(); i++)
+        {
+            // a trailing dot (the root label) is optional
+            if (i < text.size() && text[i] != '.')
+            {
+                continue;
+            }
+            if (i < text.size() || start < text.size())
+            {
+                if (!name.push_back(text.substr(start, i - start)))
+                {
+                    throw "empty label, label or name too long";
+                }
+            }
+            start = i + 1;
+        }
+        return DNSNameLiteral{ name, name.get_canonical_hash() };
+    }
+} // namespace detail
+
+/** @brief a dotted name literal turned into wire format, label offsets and
+ * canonical hash at compile time, e.g.
+ *
+ *  if (q.equals(mdns_name<"_ravenna._sub._http._tcp.local">))
+ *
+ * Malformed literals don't compile.
+ */
+template <detail::FixedString S>
+inline constexpr DNSNameLiteral mdns_name = detail::make_name_literal<S>();
+
+} // namespace mdns
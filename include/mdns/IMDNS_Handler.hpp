@@ -1,8 +1,11 @@
 #pragma once
 
 #include <format>
+#include <functional>
 #include <map>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <iuring/IOUringInterface.hpp>
@@ -21,9 +24,6 @@
 
 namespace mdns
 {
-using name_list_t = std::vector<std::string>;
-
-
 // if SRV then payload is pre-decoded here:
 struct SRV_payload
 {
@@ -35,7 +35,7 @@ struct SRV_payload
 
 struct ReplyData : public StringUtils::ToStringMixin
 {
-    std::vector<std::string> name_list;
+    name_list_t name_list;
     uint16_t type;
     MDNS_class clazz;
     std::string payload;
@@ -44,13 +44,15 @@ struct ReplyData : public StringUtils::ToStringMixin
     std::optional<iuring::IPAddress> A;
     std::optional<name_list_t> PTR;
     std::optional<std::map<std::string, std::string>> TXT;
+    uint32_t ttl;
 
-    ReplyData(const std::vector<std::string>& _name_list, const uint16_t _type,
+    ReplyData(const name_list_t& _name_list, const uint16_t _type,
         const MDNS_class _clazz, const std::string& _payload,
         const std::optional<SRV_payload>& _SRV,
         const std::optional<iuring::IPAddress>& _A,
         const std::optional<name_list_t>& _PTR,
-        const std::optional<std::map<std::string, std::string>>& _TXT)
+        const std::optional<std::map<std::string, std::string>>& _TXT,
+        uint32_t _ttl = 0)
         : name_list(_name_list)
         , type(_type)
         , clazz(_clazz)
@@ -59,6 +61,7 @@ struct ReplyData : public StringUtils::ToStringMixin
         , A(_A)
         , PTR(_PTR)
         , TXT(_TXT)
+        , ttl(_ttl)
     {
     }
 
@@ -67,33 +70,26 @@ struct ReplyData : public StringUtils::ToStringMixin
         return static_cast<RRType>(type);
     }
 
+    /** @brief a record with TTL 0 announces that the record is withdrawn
+     * and should be dropped from the cache (RFC 6762 §10.1)
+     */
+    bool is_goodbye() const
+    {
+        return ttl == 0;
+    }
+
     std::string to_string() const override
     {
-        return StringUtils::to_string(name_list);
+        return name_list.to_string();
     }
 
     /** @brief compares with possible wildcard entries
      * 
      * @param to check against. for example: *.b.c whill match x.b.c registered service
      */
-    bool equals(const std::vector<std::string>& s) const
+    bool equals(const name_list_t& s) const
     {
-        if (name_list.size() != s.size())
-        {
-            return false;
-        }
-        for (size_t i = 0; i < name_list.size(); i++)
-        {
-            if (s[i] == "*")
-            {
-                continue;
-            }
-            if (name_list[i] != s[i])
-            {
-                return false;
-            }
-        }
-        return true;
+        return name_list.matches(s);
     }
 };
 
@@ -104,9 +100,39 @@ public:
         const name_list_t& name, const name_list_t& value) = 0;
     virtual void append_TXT(
         const name_list_t& name, const std::string& txt) = 0;
-    virtual void append_SRV(
-        const name_list_t& name, const name_list_t& hostname_list) = 0;
+
+    /** @brief a TXT record of several strings, e.g. one per "key=value"
+     * pair (RFC 6763 §6.3)
+     */
+    virtual void append_TXT(
+        const name_list_t& name, std::span<const std::string> strings) = 0;
+
+    /** @brief a TXT record from its wire format rdata (length prefixed
+     * strings), for callers that render it once and answer many times
+     */
+    virtual void append_TXT_rdata(
+        const name_list_t& name, std::string_view rdata) = 0;
+    virtual void append_SRV(const name_list_t& name,
+        const name_list_t& hostname_list, uint16_t port) = 0;
     virtual void append_A(const name_list_t& name, const in_addr& addr) = 0;
+    virtual void append_AAAA(const name_list_t& name, const in6_addr& addr) = 0;
+
+    /** @brief appends A and/or AAAA records for the addresses of the
+     * interface the reply is sent on.
+     */
+    virtual void append_host_addresses(const name_list_t& name) = 0;
+
+    /** @brief asserts that name (which we own) has records of these types
+     * and no others (RFC 6762 §6.1), so queriers can cache the absence of
+     * the others instead of retrying.
+     */
+    virtual void append_NSEC(
+        const name_list_t& name, std::span<const RRType> types) = 0;
+
+    /** @brief NSEC for a host name, listing the address types of the
+     * interface the reply is sent on.
+     */
+    virtual void append_host_NSEC(const name_list_t& name) = 0;
 };
 
 enum class MDNS_IsHandled
@@ -137,6 +163,32 @@ public:
     virtual MDNS_IsHandled handle_reply(
         const std::vector<ReplyData>& question) = 0;
 
+    /** @brief appends the records this handler publishes without being
+     * asked. Used to send the goodbye packet when the service shuts down.
+     */
+    virtual void append_announcement([[maybe_unused]] IAnswerList& answer)
+    {
+    }
+
+    using announcer_t = std::function<void(IMDNS_Handler&)>;
+
+    /** @brief installed by the MDNS_Service the handler is added to.
+     */
+    void set_announcer(const announcer_t& announcer)
+    {
+        m_announcer = announcer;
+    }
+
+    using executor_t = std::function<void(std::move_only_function<void()>)>;
+
+    /** @brief installed by the MDNS_Service the handler is added to, see
+     * run_on_service().
+     */
+    void set_executor(const executor_t& executor)
+    {
+        m_executor = executor;
+    }
+
     const std::shared_ptr<iuring::IOUringInterface> get_io()
     {
         return m_io;
@@ -147,10 +199,38 @@ public:
         return m_logger;
     }
 
+protected:
+    /** @brief asks the service to multicast append_announcement()
+     * unsolicited. Calls made in quick succession result in one packet.
+     */
+    void request_announcement()
+    {
+        if (m_announcer)
+        {
+            m_announcer(*this);
+        }
+    }
+
+    /** @brief runs task on the thread handle_question() is called on: the
+     * service's worker thread when it has one, otherwise right away. The
+     * state questions are answered from must only be changed this way.
+     */
+    void run_on_service(std::move_only_function<void()> task)
+    {
+        if (m_executor)
+        {
+            m_executor(std::move(task));
+            return;
+        }
+        task();
+    }
+
 private:
     const std::shared_ptr<iuring::IOUringInterface> m_io;
     logging::ILogger& m_logger;
     iuring::NetworkAdapter& m_adapter;
+    announcer_t m_announcer;
+    executor_t m_executor;
 };
 
 } // namespace mdns
\ No newline at end of file
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <mdns/IMDNS_Handler.hpp>
+#include <mdns/MDNS_RateLimiter.hpp>
+
+namespace mdns
+{
+/** @brief answer list that encodes records directly in wire format.
+ *
+ * Names are compressed (RFC 1035 §4.1.4) against the names already
+ * written to the same packet, and records are split over multiple packets
+ * when they no longer fit in a single datagram.
+ *
+ * While a question is set, only the records it asks for are answers. The
+ * records handlers add for other names are collected, those the answers
+ * point at (SRV, TXT and addresses of browsed instances, RFC 6763 §12) are
+ * written behind the answers by write_additional_records(). So are the
+ * NSEC records (RFC 6762 §6.1) for the question's name, a reply may consist
+ * of nothing else when we own the name but not the asked for type.
+ *
+ * All memory comes from the memory resource given at construction, the
+ * service hands in an arena it releases after every batch of replies.
+ */
+class MDNS_AnswerList final : public IAnswerList
+{
+public:
+    // keep a reply inside a single ethernet frame (RFC 6762 §17)
+    static constexpr size_t MAX_PACKET_SIZE = 1460;
+
+    // RFC 6762 §10: 120 secs for host records, 75 minutes for the others.
+    static constexpr uint32_t TTL_HOST_RECORD_SECS = 120;
+    static constexpr uint32_t TTL_OTHER_RECORD_SECS = 4500;
+
+    // the lookup tables are sized for a typical reply up front, larger
+    // lists (a browse of a big registry) grow them in the arena
+    static constexpr size_t RESERVED_NAMES = 16;
+    static constexpr size_t RESERVED_RECORDS = 32;
+
+    struct Packet
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        explicit Packet(const allocator_type& alloc)
+            : payload(alloc)
+            , names(alloc)
+        {
+            payload.reserve(MAX_PACKET_SIZE);
+        }
+
+        Packet(Packet&& other, const allocator_type& alloc)
+            : payload(std::move(other.payload), alloc)
+            , num_answers(other.num_answers)
+            , num_additional(other.num_additional)
+            , names(std::move(other.names), alloc)
+        {
+        }
+
+        std::pmr::vector<uint8_t> payload;
+        uint16_t num_answers = 0;
+        uint16_t num_additional = 0;
+
+        // offsets (including header) of the name suffixes written so far,
+        // the suffixes themselves are read back from the payload
+        std::pmr::vector<uint16_t> names;
+    };
+
+    explicit MDNS_AnswerList(
+        const std::optional<in_addr>& host_ip4 = std::nullopt,
+        const std::optional<in6_addr>& host_ip6 = std::nullopt,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : m_host_ip4(host_ip4)
+        , m_host_ip6(host_ip6)
+        , m_packets(memory)
+        , m_additional(memory)
+        , m_additional_names(memory)
+        , m_additional_name_index(memory)
+        , m_referenced_names(memory)
+        , m_record_keys(memory)
+    {
+        m_packets.emplace_back();
+        m_additional.reserve(RESERVED_RECORDS);
+        m_additional_names.reserve(RESERVED_NAMES);
+        m_additional_name_index.reserve(RESERVED_NAMES);
+        m_referenced_names.reserve(RESERVED_NAMES);
+        m_record_keys.reserve(RESERVED_RECORDS);
+    }
+
+    /** @brief when set, all records are emitted with TTL 0 (RFC 6762 §10.1)
+     */
+    void set_goodbye(bool goodbye)
+    {
+        m_goodbye = goodbye;
+    }
+
+    /** @brief records multicast on this interface less than a second ago
+     * are left out.
+     */
+    void set_rate_limiter(
+        MDNS_RateLimiter* limiter, MDNS_RateLimiter::clock::time_point now)
+    {
+        m_rate_limiter = limiter;
+        m_now = now;
+    }
+
+    /** @brief the question the records appended next answer, nullptr (as
+     * for announcements) makes every record an answer. A record for the
+     * question's name is an answer when it has the asked for type (or the
+     * question is ANY), the other address family and its NSEC go to the
+     * additional section (RFC 6762 §6.1, §6.2) and other types are left
+     * out. Records for other names are candidates for the additional
+     * section.
+     */
+    void set_question(const QuestionData* q);
+
+    /** @brief appends the collected records for names that answers (or
+     * other additional records) point at to the last packet, leaving out
+     * those already in the list and those that don't fit. Call once, after
+     * all questions were answered.
+     */
+    void write_additional_records();
+
+    void append_PTR(const name_list_t& name, const name_list_t& value) override;
+    void append_TXT(const name_list_t& name, const std::string& txt) override;
+    void append_TXT(const name_list_t& name,
+        std::span<const std::string> strings) override;
+    void append_TXT_rdata(
+        const name_list_t& name, std::string_view rdata) override;
+    void append_SRV(const name_list_t& name, const name_list_t& hostname_list,
+        uint16_t port) override;
+    void append_A(const name_list_t& name, const in_addr& addr) override;
+    void append_AAAA(const name_list_t& name, const in6_addr& addr) override;
+    void append_host_addresses(const name_list_t& name) override;
+    void append_NSEC(
+        const name_list_t& name, std::span<const RRType> types) override;
+    void append_host_NSEC(const name_list_t& name) override;
+
+    uint16_t get_num_answers() const
+    {
+        return m_num_answers;
+    }
+
+    uint16_t get_num_additional() const
+    {
+        return m_num_additional;
+    }
+
+    size_t get_num_packets() const
+    {
+        return m_packets.size();
+    }
+
+    const Packet& get_packet(size_t ix) const
+    {
+        return m_packets[ix];
+    }
+
+private:
+    /** @brief an NSEC type bit map with the single window block 0 the
+     * restricted form of RFC 6762 §6.1 allows, for types below 256
+     */
+    struct TypeBitmap
+    {
+        std::array<uint8_t, 32> bits{};
+        uint8_t length = 0;
+
+        void set(RRType type)
+        {
+            const auto t = static_cast<uint8_t>(type);
+            bits[t / 8] |= 0x80 >> (t % 8);
+            length = std::max<uint8_t>(length, t / 8 + 1);
+        }
+    };
+
+    /** @brief a record for the additional section, copied as the names it
+     * refers to may be gone by the time the list is sent. Names are indices
+     * into m_additional_names.
+     */
+    struct AdditionalRecord
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        explicit AdditionalRecord(const allocator_type& alloc)
+            : txt(alloc)
+        {
+        }
+
+        AdditionalRecord(AdditionalRecord&& other, const allocator_type& alloc)
+            : type(other.type)
+            , written(other.written)
+            , name(other.name)
+            , target(other.target)
+            , port(other.port)
+            , txt(std::move(other.txt), alloc)
+            , addr4(other.addr4)
+            , addr6(other.addr6)
+            , types(other.types)
+        {
+        }
+
+        RRType type{};
+        bool written = false;
+        uint32_t name = 0;
+        // PTR and SRV
+        uint32_t target = 0;
+        uint16_t port = 0;
+        // the rdata, length prefixed strings
+        std::pmr::string txt;
+        in_addr addr4{};
+        in6_addr addr6{};
+        TypeBitmap types;
+    };
+
+    enum class Section
+    {
+        ANSWER,
+        ADDITIONAL,
+        NONE
+    };
+
+    std::optional<in_addr> m_host_ip4;
+    std::optional<in6_addr> m_host_ip6;
+    std::pmr::vector<Packet> m_packets;
+    uint16_t m_num_answers = 0;
+    uint16_t m_num_additional = 0;
+    bool m_goodbye = false;
+    MDNS_RateLimiter* m_rate_limiter = nullptr;
+    MDNS_RateLimiter::clock::time_point m_now;
+
+    const QuestionData* m_question = nullptr;
+    bool m_writing_additional = false;
+    std::pmr::vector<AdditionalRecord> m_additional;
+    // the names the additional records refer to, each stored once and
+    // found through their canonical hash
+    std::pmr::vector<name_list_t> m_additional_names;
+    std::pmr::unordered_multimap<uint64_t, uint32_t> m_additional_name_index;
+    // per entry of m_additional_names: whether answers point at it
+    std::pmr::vector<bool> m_referenced_names;
+
+    // name, type and rdata hashes of the records written so far
+    std::pmr::unordered_set<uint64_t> m_record_keys;
+
+    uint32_t ttl(uint32_t secs) const
+    {
+        return m_goodbye ? 0 : secs;
+    }
+
+    Section get_section(const name_list_t& name, RRType type) const;
+    uint32_t intern_additional_name(const name_list_t& name);
+    void add_reference(const name_list_t& name);
+    bool is_referenced(uint32_t name) const;
+    void write_TXT(const name_list_t& name, std::string_view rdata);
+    void write_NSEC(const name_list_t& name, const TypeBitmap& types);
+
+    /** @brief true when the record doesn't go into the answers right away,
+     * fill copies the record specific fields of an additional record
+     */
+    template <typename Fill>
+    bool defer(const name_list_t& name, RRType type, const Fill& fill);
+
+    template <typename Encoder>
+    void append_record(const name_list_t& name, RRType type,
+        uint64_t rdata_hash, const Encoder& encode);
+
+    static void write_name(Packet& p, const name_list_t& name);
+    static bool suffix_matches(
+        const Packet& p, uint16_t offset, const name_list_t& name, size_t first);
+};
+
+} // namespace mdns
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace mdns
+{
+/** @brief what mdns may send on one interface, 0 turns a limit off
+ */
+struct MDNS_EgressLimit
+{
+    uint64_t bytes_per_sec = 256 * 1024;
+    uint32_t packets_per_sec = 250;
+
+    // sent back to back after a quiet period
+    uint64_t burst_bytes = 48 * 1024;
+    uint32_t burst_packets = 32;
+
+    // queued packets older than this are dropped, queriers retry after a
+    // second anyway (RFC 6762 §5.2)
+    std::chrono::milliseconds max_queue_delay{ 500 };
+
+    static MDNS_EgressLimit unlimited()
+    {
+        return MDNS_EgressLimit{ .bytes_per_sec = 0, .packets_per_sec = 0 };
+    }
+};
+
+/** @brief token buckets for the bytes and packets mdns sends on an
+ * interface that also carries PTP and media, so a burst of replies can't
+ * crowd the streams out of the NIC queues.
+ *
+ * Packets within the limit go out right away. The excess waits in a
+ * fixed ring (no allocations) until the buckets refill: a packet that is
+ * already queued is not queued again, and packets are dropped when the
+ * ring is full or once they waited longer than max_queue_delay.
+ */
+class MDNS_EgressPacer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_QUEUED = 64;
+    static constexpr size_t MAX_DATAGRAM_SIZE = 1500;
+    // how long to wait when the buckets allowed a packet but sending it
+    // failed, send work items come back as earlier sends complete
+    static constexpr std::chrono::milliseconds SEND_RETRY_INTERVAL{ 1 };
+
+    enum class Result
+    {
+        QUEUED,
+        COALESCED,
+        DROPPED
+    };
+
+    explicit MDNS_EgressPacer(const MDNS_EgressLimit& limit = {})
+        : m_slots(MAX_QUEUED)
+    {
+        set_limit(limit);
+    }
+
+    void set_limit(const MDNS_EgressLimit& limit)
+    {
+        m_limit = limit;
+        m_packet_tokens = limit.burst_packets;
+        m_byte_tokens = static_cast<double>(limit.burst_bytes);
+    }
+
+    /** @return true (and takes the tokens) when a packet of size bytes may
+     * be sent now, never while packets are queued
+     */
+    bool try_send(size_t size, clock::time_point now)
+    {
+        if (m_num_queued > 0)
+        {
+            return false;
+        }
+        refill(now);
+        if (!has_tokens(size))
+        {
+            return false;
+        }
+        take_tokens(size);
+        return true;
+    }
+
+    Result push(size_t listener_ix, std::span<const uint8_t> header,
+        std::span<const uint8_t> payload, clock::time_point now)
+    {
+        const auto size = header.size() + payload.size();
+        if (size > MAX_DATAGRAM_SIZE || m_num_queued == MAX_QUEUED)
+        {
+            add(m_num_dropped);
+            return Result::DROPPED;
+        }
+
+        auto& slot = m_slots[(m_head + m_num_queued) % MAX_QUEUED];
+        std::copy(header.begin(), header.end(), slot.data.begin());
+        std::copy(payload.begin(), payload.end(),
+            slot.data.begin() + header.size());
+        slot.size = size;
+
+        // repeated replies to repeated queries
+        for (size_t i = 0; i < m_num_queued; i++)
+        {
+            const auto& queued = m_slots[(m_head + i) % MAX_QUEUED];
+            if (queued.listener_ix == listener_ix && queued.size == size &&
+                memcmp(queued.data.data(), slot.data.data(), size) == 0)
+            {
+                add(m_num_coalesced);
+                return Result::COALESCED;
+            }
+        }
+
+        slot.listener_ix = listener_ix;
+        slot.queued_at = now;
+        m_num_queued++;
+        add(m_num_paced);
+        return Result::QUEUED;
+    }
+
+    /** @brief sends queued packets while the buckets allow, send(listener_ix,
+     * datagram) returns false to stop (e.g. out of send work items)
+     */
+    template <typename F> void drain(clock::time_point now, const F& send)
+    {
+        refill(now);
+        while (m_num_queued > 0)
+        {
+            const auto& slot = m_slots[m_head];
+            if (now - slot.queued_at > m_limit.max_queue_delay)
+            {
+                add(m_num_dropped);
+                pop();
+                continue;
+            }
+            if (!has_tokens(slot.size))
+            {
+                return;
+            }
+            if (!send(slot.listener_ix,
+                    std::span<const uint8_t>(slot.data.data(), slot.size)))
+            {
+                m_retry_at = now + SEND_RETRY_INTERVAL;
+                return;
+            }
+            take_tokens(slot.size);
+            pop();
+        }
+    }
+
+    /** @brief sends everything queued regardless of the limit, for shutdown
+     */
+    template <typename F> void flush(const F& send)
+    {
+        for (; m_num_queued > 0; pop())
+        {
+            const auto& slot = m_slots[m_head];
+            send(slot.listener_ix,
+                std::span<const uint8_t>(slot.data.data(), slot.size));
+        }
+    }
+
+    /** @brief when the buckets hold enough for the first queued packet
+     * (and a failed send was given SEND_RETRY_INTERVAL), never before now,
+     * time_point::max() when nothing is queued
+     */
+    clock::time_point get_next_send(clock::time_point now) const
+    {
+        if (m_num_queued == 0)
+        {
+            return clock::time_point::max();
+        }
+
+        const auto size = m_slots[m_head].size;
+        double wait_secs = 0;
+        if (m_limit.packets_per_sec > 0)
+        {
+            wait_secs = std::max(
+                wait_secs, (1 - m_packet_tokens) / m_limit.packets_per_sec);
+        }
+        if (m_limit.bytes_per_sec > 0)
+        {
+            const auto needed_bytes = std::min(static_cast<double>(size),
+                static_cast<double>(m_limit.burst_bytes));
+            wait_secs = std::max(wait_secs,
+                (needed_bytes - m_byte_tokens) / m_limit.bytes_per_sec);
+        }
+        const auto refilled = m_last_refill +
+            std::chrono::ceil<clock::duration>(
+                std::chrono::duration<double>(wait_secs));
+        return std::max({ now, refilled, m_retry_at });
+    }
+
+    bool empty() const
+    {
+        return m_num_queued == 0;
+    }
+
+    // the getters may be called from any thread
+    uint64_t get_num_paced() const
+    {
+        return m_num_paced.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_num_coalesced() const
+    {
+        return m_num_coalesced.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_num_dropped() const
+    {
+        return m_num_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::array<uint8_t, MAX_DATAGRAM_SIZE> data;
+        size_t size = 0;
+        size_t listener_ix = 0;
+        clock::time_point queued_at;
+    };
+
+    MDNS_EgressLimit m_limit;
+    double m_packet_tokens = 0;
+    double m_byte_tokens = 0;
+    clock::time_point m_last_refill{};
+    clock::time_point m_retry_at{};
+
+    std::vector<Slot> m_slots;
+    size_t m_head = 0;
+    size_t m_num_queued = 0;
+
+    std::atomic<uint64_t> m_num_paced{ 0 };
+    std::atomic<uint64_t> m_num_coalesced{ 0 };
+    std::atomic<uint64_t> m_num_dropped{ 0 };
+
+    static void add(std::atomic<uint64_t>& counter)
+    {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void refill(clock::time_point now)
+    {
+        const std::chrono::duration<double> elapsed = now - m_last_refill;
+        m_last_refill = now;
+        if (elapsed.count() <= 0)
+        {
+            return;
+        }
+        m_packet_tokens = std::min<double>(m_limit.burst_packets,
+            m_packet_tokens + elapsed.count() * m_limit.packets_per_sec);
+        m_byte_tokens = std::min<double>(
+            static_cast<double>(m_limit.burst_bytes),
+            m_byte_tokens + elapsed.count() * m_limit.bytes_per_sec);
+    }
+
+    bool has_tokens(size_t size) const
+    {
+        // a packet larger than the burst must still get out eventually
+        const auto needed_bytes = std::min(static_cast<double>(size),
+            static_cast<double>(m_limit.burst_bytes));
+        return (m_limit.packets_per_sec == 0 || m_packet_tokens >= 1) &&
+            (m_limit.bytes_per_sec == 0 || m_byte_tokens >= needed_bytes);
+    }
+
+    void take_tokens(size_t size)
+    {
+        m_packet_tokens = std::max(0.0, m_packet_tokens - 1);
+        m_byte_tokens =
+            std::max(0.0, m_byte_tokens - static_cast<double>(size));
+    }
+
+    void pop()
+    {
+        m_head = (m_head + 1) % MAX_QUEUED;
+        m_num_queued--;
+    }
+};
+
+} // namespace mdns
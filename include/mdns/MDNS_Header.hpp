@@ -83,7 +83,7 @@ public:
            // SERVFAIL (2), NXDOMAIN (3, Nonexistent domain), etc.
 
     MDNS_Header(MessageType type, transaction_id_t id, uint16_t num_answers,
-        uint16_t num_questions)
+        uint16_t num_questions, uint16_t num_additional = 0)
     {
         m_transaction_id = ntohs(id);
         switch (type)
@@ -99,7 +99,7 @@ public:
         m_num_questions = ntohs(num_questions);
         m_num_answers = ntohs(num_answers);
         m_num_auth_resource_records = 0;
-        m_num_additional_resource_reconrds = 0;
+        m_num_additional_resource_reconrds = ntohs(num_additional);
     }
 
     transaction_id_t get_transaction_id() const
@@ -118,6 +118,16 @@ public:
         return htons(m_num_answers);
     }
 
+    uint16_t get_num_authority() const
+    {
+        return htons(m_num_auth_resource_records);
+    }
+
+    uint16_t get_num_additional() const
+    {
+        return htons(m_num_additional_resource_reconrds);
+    }
+
     MessageType get_message_type() const
     {
         return (m_flags0 & (1 << BIT_SHIFT_QR)) ? MessageType::REPLY :
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <slogger/ILogger.hpp>
+
+/** @brief logging for the per-packet paths.
+ *
+ * A MDNS_HOT_LOG_* statement costs nothing when its level is compiled out
+ * (MDNS_HOT_LOG_MIN_LEVEL), a relaxed load when it is disabled at run time
+ * and is rate limited per call site otherwise. None of the arguments are
+ * evaluated unless the message is actually emitted.
+ */
+
+// 0 = debug, 1 = info, 2 = error, 3 = off
+#ifndef MDNS_HOT_LOG_MIN_LEVEL
+#define MDNS_HOT_LOG_MIN_LEVEL 0
+#endif
+
+namespace mdns
+{
+enum class MDNS_LogLevel : uint8_t
+{
+    DEBUG = 0,
+    INFO = 1,
+    ERROR = 2,
+    OFF = 3
+};
+
+inline constexpr auto HOT_LOG_MIN_LEVEL =
+    static_cast<MDNS_LogLevel>(MDNS_HOT_LOG_MIN_LEVEL);
+
+constexpr bool is_hot_log_compiled_in(MDNS_LogLevel level)
+{
+    return level >= HOT_LOG_MIN_LEVEL;
+}
+
+inline std::atomic<MDNS_LogLevel>& hot_log_level()
+{
+    static std::atomic<MDNS_LogLevel> level{ MDNS_LogLevel::INFO };
+    return level;
+}
+
+/** @brief run time threshold for the hot path logging, INFO by default
+ */
+inline void set_hot_log_level(MDNS_LogLevel level)
+{
+    hot_log_level().store(level, std::memory_order_relaxed);
+}
+
+inline bool is_hot_log_enabled(MDNS_LogLevel level)
+{
+    return level >= hot_log_level().load(std::memory_order_relaxed);
+}
+
+/** @brief per call site limiter: the first BURST messages of each interval
+ * are emitted, after that only every sample_every'th (0 = none). The next
+ * emitted message reports how many were suppressed in between.
+ */
+class MDNS_LogSite
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds DEFAULT_INTERVAL{ 1 };
+    static constexpr uint32_t DEFAULT_BURST = 5;
+
+    constexpr MDNS_LogSite(
+        std::chrono::nanoseconds interval = DEFAULT_INTERVAL,
+        uint32_t burst = DEFAULT_BURST, uint32_t sample_every = 0)
+        : m_interval(interval.count())
+        , m_burst(burst)
+        , m_sample_every(sample_every)
+    {
+    }
+
+    /** @param num_suppressed set to the messages dropped since the last
+     * emitted one
+     * @return true when this message should be emitted
+     */
+    bool should_log(clock::time_point now, uint64_t& num_suppressed)
+    {
+        const int64_t now_ns = now.time_since_epoch().count();
+        auto window_start = m_window_start.load(std::memory_order_relaxed);
+        if (now_ns - window_start >= m_interval &&
+            m_window_start.compare_exchange_strong(
+                window_start, now_ns, std::memory_order_relaxed))
+        {
+            m_num_in_window.store(0, std::memory_order_relaxed);
+        }
+
+        const auto n = m_num_in_window.fetch_add(1, std::memory_order_relaxed);
+        if (n < m_burst ||
+            (m_sample_every != 0 && (n - m_burst) % m_sample_every == 0))
+        {
+            num_suppressed =
+                m_num_suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        m_num_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+private:
+    const int64_t m_interval;
+    const uint32_t m_burst;
+    const uint32_t m_sample_every;
+
+    // racy between threads by design, the limits are approximate
+    std::atomic<int64_t> m_window_start{ INT64_MIN / 2 };
+    std::atomic<uint64_t> m_num_in_window{ 0 };
+    std::atomic<uint64_t> m_num_suppressed{ 0 };
+};
+
+} // namespace mdns
+
+#define MDNS_HOT_LOG_SITE(site, level, LOG_MACRO, logger, ...)                \
+    do                                                                        \
+    {                                                                         \
+        if constexpr (mdns::is_hot_log_compiled_in(level))                    \
+        {                                                                     \
+            if (mdns::is_hot_log_enabled(level))                              \
+            {                                                                 \
+                uint64_t _mdns_num_suppressed = 0;                            \
+                if ((site).should_log(mdns::MDNS_LogSite::clock::now(),       \
+                        _mdns_num_suppressed))                                \
+                {                                                             \
+                    if (_mdns_num_suppressed > 0)                             \
+                    {                                                         \
+                        LOG_MACRO(logger, "({} similar messages suppressed)", \
+                            _mdns_num_suppressed);                            \
+                    }                                                         \
+                    LOG_MACRO(logger, __VA_ARGS__);                           \
+                }                                                             \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+#define MDNS_HOT_LOG(level, LOG_MACRO, logger, ...)                           \
+    do                                                                        \
+    {                                                                         \
+        static constinit mdns::MDNS_LogSite _mdns_log_site;                   \
+        MDNS_HOT_LOG_SITE(_mdns_log_site, level, LOG_MACRO, logger,           \
+            __VA_ARGS__);                                                     \
+    } while (0)
+
+#define MDNS_HOT_LOG_DEBUG(logger, ...)                                       \
+    MDNS_HOT_LOG(mdns::MDNS_LogLevel::DEBUG, LOG_DEBUG, logger, __VA_ARGS__)
+#define MDNS_HOT_LOG_INFO(logger, ...)                                        \
+    MDNS_HOT_LOG(mdns::MDNS_LogLevel::INFO, LOG_INFO, logger, __VA_ARGS__)
+#define MDNS_HOT_LOG_ERROR(logger, ...)                                       \
+    MDNS_HOT_LOG(mdns::MDNS_LogLevel::ERROR, LOG_ERROR, logger, __VA_ARGS__)
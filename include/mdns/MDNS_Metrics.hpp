@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "MDNS_Header.hpp"
+
+namespace mdns
+{
+/** @brief why an incoming packet was rejected
+ */
+enum class MDNS_MalformedReason
+{
+    HEADER_TOO_SHORT,
+    // a fixed size field runs past the end of the packet
+    TRUNCATED,
+    // a label longer than 63 bytes or of a reserved label type
+    BAD_LABEL,
+    // more than 255 bytes once decompressed
+    NAME_TOO_LONG,
+    // a compression pointer out of the packet or not pointing backwards
+    BAD_POINTER,
+    TOO_MANY_POINTER_HOPS,
+    // RDLENGTH runs past the end of the packet
+    RDATA_OVERRUN,
+    // RDATA that doesn't fit its record type
+    BAD_RDATA,
+    NUM_REASONS
+};
+
+/** @brief the values of all metrics, instantiated with atomics for the live
+ * block and with plain integers for snapshots.
+ */
+template <typename Counter> struct MDNS_MetricValues
+{
+    static constexpr size_t NUM_MESSAGE_TYPES = 2;
+
+    // qtypes 0..255 are counted individually, everything above in the last
+    // slot
+    static constexpr size_t NUM_QTYPE_SLOTS = 257;
+
+    // handlers in the order they were added, later ones share the last slot
+    static constexpr size_t MAX_TRACKED_HANDLERS = 16;
+
+    // upper bounds of the receive-to-send latency buckets, plus +Inf
+    static constexpr std::array<std::chrono::microseconds, 10>
+        LATENCY_BUCKETS{ std::chrono::microseconds(50),
+            std::chrono::microseconds(100), std::chrono::microseconds(250),
+            std::chrono::microseconds(500), std::chrono::microseconds(1000),
+            std::chrono::microseconds(2500), std::chrono::microseconds(5000),
+            std::chrono::microseconds(10000),
+            std::chrono::microseconds(50000),
+            std::chrono::microseconds(100000) };
+
+    std::array<Counter, NUM_MESSAGE_TYPES> packets_in{};
+    std::array<Counter, NUM_MESSAGE_TYPES> bytes_in{};
+    std::array<Counter, NUM_MESSAGE_TYPES> packets_out{};
+    std::array<Counter, NUM_MESSAGE_TYPES> bytes_out{};
+    Counter records_out{};
+
+    std::array<Counter, NUM_QTYPE_SLOTS> questions{};
+    Counter unanswered_questions{};
+
+    std::array<Counter, MAX_TRACKED_HANDLERS> handler_hits{};
+    std::array<Counter, MAX_TRACKED_HANDLERS> handler_misses{};
+    Counter registry_hits{};
+    Counter registry_misses{};
+
+    std::array<Counter,
+        static_cast<size_t>(MDNS_MalformedReason::NUM_REASONS)>
+        malformed{};
+
+    // responses held back by the per-interface rate limiter
+    Counter suppressed_records{};
+    Counter dropped_queries{};
+    Counter dropped_questions{};
+    Counter dropped_datagrams{};
+    Counter deferred_batches{};
+    Counter budget_overruns{};
+
+    // kept by the per-interface egress pacers
+    Counter paced_packets{};
+    Counter coalesced_packets{};
+    Counter paced_drops{};
+
+    // the rate limiter's table is the only cache we keep
+    Counter cache_entries{};
+    Counter cache_evictions{};
+
+    std::array<Counter, LATENCY_BUCKETS.size() + 1> latency_buckets{};
+    Counter latency_sum_ns{};
+    Counter latency_count{};
+};
+
+using MDNS_MetricsSnapshot = MDNS_MetricValues<uint64_t>;
+
+/** @brief lock-free counters updated from the packet paths, relaxed
+ * ordering: a snapshot is consistent per counter, not across counters.
+ */
+class MDNS_Metrics : public MDNS_MetricValues<std::atomic<uint64_t>>
+{
+public:
+    static void add(std::atomic<uint64_t>& counter, uint64_t n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    static size_t message_type_index(MDNS_Header::MessageType type)
+    {
+        return static_cast<size_t>(type);
+    }
+
+    void count_packet_in(MDNS_Header::MessageType type, size_t size)
+    {
+        add(packets_in[message_type_index(type)]);
+        add(bytes_in[message_type_index(type)], size);
+    }
+
+    void count_packet_out(
+        MDNS_Header::MessageType type, size_t size, size_t num_records)
+    {
+        add(packets_out[message_type_index(type)]);
+        add(bytes_out[message_type_index(type)], size);
+        add(records_out, num_records);
+    }
+
+    void count_question(uint16_t qtype)
+    {
+        add(questions[std::min<size_t>(qtype, NUM_QTYPE_SLOTS - 1)]);
+    }
+
+    void count_handler(size_t handler_ix, bool hit)
+    {
+        const auto ix = std::min(handler_ix, MAX_TRACKED_HANDLERS - 1);
+        add(hit ? handler_hits[ix] : handler_misses[ix]);
+    }
+
+    void count_malformed(MDNS_MalformedReason reason)
+    {
+        add(malformed[static_cast<size_t>(reason)]);
+    }
+
+    void record_latency(std::chrono::nanoseconds latency);
+
+    MDNS_MetricsSnapshot snapshot() const;
+};
+
+/** @brief renders a snapshot in the Prometheus text exposition format
+ */
+std::string to_prometheus_text(const MDNS_MetricsSnapshot& metrics);
+
+} // namespace mdns
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <slogger/ILogger.hpp>
 #include <string>
+#include <vector>
 
 #include "mdns/MDNS_Service.hpp"
 
@@ -23,29 +25,92 @@ public:
     virtual size_t num_flows() const = 0;
     virtual size_t num_senders() const = 0;
     virtual size_t num_receivers() const = 0;
+
+    using change_listener_t = std::function<void()>;
+
+    /** @brief called whenever one of the num_*() counters changed, used by
+     * the mdns handler to re-announce the ver_* TXT records.
+     */
+    void set_change_listener(const change_listener_t& listener)
+    {
+        m_change_listener = listener;
+    }
+
+protected:
+    /** @brief implementations call this (on the kernel thread) after one
+     * or more of the num_*() counters changed.
+     */
+    void notify_changed()
+    {
+        if (m_change_listener)
+        {
+            m_change_listener();
+        }
+    }
+
+private:
+    change_listener_t m_change_listener;
 };
 
 
+/** @brief publishes the Node API of an NMOS node (AMWA IS-04) as
+ * <node name>._nmos-node._tcp.local on host <node name>.local, with the
+ * api_* and ver_* keys in its TXT record. Also picks up registration
+ * services from replies.
+ */
 class MDNS_NMOS_HTTP_Handler : public IMDNS_Handler
 {
 public:
     MDNS_NMOS_HTTP_Handler(
         const std::shared_ptr<iuring::IOUringInterface>& network,
         logging::ILogger& logger, INMOS_Service& nmos_service,
-        iuring::NetworkAdapter& adapter)
+        iuring::NetworkAdapter& adapter,
+        const std::string& node_name = get_vendor_node_name(),
+        uint16_t port =
+            static_cast<uint16_t>(iuring::SocketPortID::UNENCRYPTED_WEB_PORT))
         : IMDNS_Handler(network, logger, adapter)
         , m_nmos_service(nmos_service)
+        , m_instance_name(
+              create_list(node_name, "_nmos-node", "_tcp", "local"))
+        , m_hostname(create_list(node_name, "local"))
+        , m_port(port)
+    {
+        render_txt_records();
+        m_nmos_service.set_change_listener([this]() {
+            // the TXT strings are read where the questions are answered
+            run_on_service([this]() {
+                render_txt_records();
+                request_announcement();
+            });
+        });
+    }
+
+    ~MDNS_NMOS_HTTP_Handler()
     {
+        m_nmos_service.set_change_listener(nullptr);
     }
 
 
     MDNS_IsHandled handle_question(
         const QuestionData& q, IAnswerList& answer) override;
     MDNS_IsHandled handle_reply(const std::vector<ReplyData>& reply) override;
+    void append_announcement(IAnswerList& answer) override;
 
 private:
     INMOS_Service& m_nmos_service;
 
+    // built once, answering doesn't allocate
+    name_list_t m_instance_name;
+    name_list_t m_hostname;
+    uint16_t m_port;
+
+    // "key=value" strings of the TXT record, rendered from the
+    // INMOS_Service counters and only refreshed on change
+    std::vector<std::string> m_txt_strings;
+
+    void render_txt_records();
+    void append_records(IAnswerList& answer);
+
     std::optional<iuring::IPAddress> resolve_dns_request(
         const name_list_t& name_list);
 };
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <iuring/IPAddress.hpp>
+#include <iuring/ReceivedMessage.hpp>
+
+#include <slogger/ILogger.hpp>
+
+#include "SPSC_Ring.hpp"
+
+namespace mdns
+{
+/** @brief one mdns datagram as seen on the wire
+ */
+struct MDNS_CapturedDatagram
+{
+    // since the epoch of the capture's clock
+    std::chrono::nanoseconds timestamp;
+    iuring::IPAddress source;
+    uint16_t source_port = 0;
+    std::vector<uint8_t> payload;
+};
+
+/** @brief writes received datagrams to a classic pcap file (nanosecond
+ * timestamps, LINKTYPE_RAW). The IP and UDP headers are synthesised from
+ * the source address and port and the multicast group the datagram arrived
+ * on.
+ *
+ * write() only copies the datagram into a ring allocated up front, so it
+ * can be called on the realtime thread. The pcap records are built and
+ * written to the file by the writer's own thread.
+ */
+class MDNS_PcapWriter
+{
+public:
+    // RFC 6762 §17: we don't expect mdns packets larger than an ethernet frame
+    static constexpr size_t MAX_DATAGRAM_SIZE = 1500;
+    static constexpr size_t RING_SIZE = 256;
+
+    /** @return nullptr when the file can't be created
+     */
+    static std::unique_ptr<MDNS_PcapWriter> create(
+        const std::string& path, logging::ILogger& logger);
+
+    /** @brief writes what is still queued and closes the file
+     */
+    ~MDNS_PcapWriter();
+
+    /** @brief queues a received datagram for the file
+     * @return false when the ring is full or the datagram too large, it is
+     * dropped then
+     */
+    bool write(const iuring::ReceivedMessage& data,
+        const iuring::IPAddress& destination,
+        std::chrono::system_clock::time_point when =
+            std::chrono::system_clock::now());
+
+    /** @brief waits until everything queued so far is in the file, not for
+     * the realtime thread
+     */
+    void flush();
+
+    uint64_t get_num_written() const
+    {
+        return m_num_written.load(std::memory_order_acquire);
+    }
+
+    uint64_t get_num_dropped() const
+    {
+        return m_num_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Datagram
+    {
+        std::array<uint8_t, MAX_DATAGRAM_SIZE> data;
+        size_t size = 0;
+        std::optional<iuring::IPAddress> source;
+        uint16_t source_port = 0;
+        std::optional<iuring::IPAddress> destination;
+        std::chrono::system_clock::time_point when;
+    };
+
+    MDNS_PcapWriter(std::ofstream&& file, logging::ILogger& logger)
+        : m_file(std::move(file))
+        , m_logger(logger)
+        , m_ring(std::make_unique<SPSC_Ring<Datagram, RING_SIZE>>())
+    {
+    }
+
+    std::ofstream m_file;
+    logging::ILogger& m_logger;
+    std::vector<uint8_t> m_record;
+
+    std::unique_ptr<SPSC_Ring<Datagram, RING_SIZE>> m_ring;
+    std::atomic<uint64_t> m_num_queued{ 0 };
+    std::atomic<uint64_t> m_num_written{ 0 };
+    // written and flushed to the file, what flush() waits for
+    std::atomic<uint64_t> m_num_flushed{ 0 };
+    std::atomic<uint64_t> m_num_dropped{ 0 };
+    std::atomic<uint32_t> m_signal{ 0 };
+    std::atomic<bool> m_waiting{ false };
+    std::jthread m_thread;
+
+    void run(std::stop_token stop);
+    void write_record(const Datagram& d);
+};
+
+/** @brief reads the mdns datagrams (UDP port 5353) from a pcap or pcapng
+ * capture. Ethernet (incl. 802.1Q), Linux cooked and raw IP link types are
+ * understood, everything else in the file is skipped.
+ */
+class MDNS_PcapReader
+{
+public:
+    /** @return nullptr when the file can't be opened or isn't a capture
+     */
+    static std::unique_ptr<MDNS_PcapReader> open(
+        const std::string& path, logging::ILogger& logger);
+
+    /** @return the next mdns datagram or nullopt at the end of the file
+     */
+    std::optional<MDNS_CapturedDatagram> next();
+
+    // packets in the file that were not mdns or could not be decoded
+    uint64_t get_num_skipped() const
+    {
+        return m_num_skipped;
+    }
+
+private:
+    enum class Format
+    {
+        PCAP,
+        PCAPNG
+    };
+
+    struct Interface
+    {
+        uint16_t link_type;
+        // timestamp units per second
+        uint64_t ticks_per_second;
+    };
+
+    MDNS_PcapReader(std::ifstream&& file, logging::ILogger& logger)
+        : m_file(std::move(file))
+        , m_logger(logger)
+    {
+    }
+
+    std::ifstream m_file;
+    logging::ILogger& m_logger;
+    Format m_format = Format::PCAP;
+    bool m_swapped = false;
+    std::vector<Interface> m_interfaces;
+    std::vector<uint8_t> m_block;
+    uint64_t m_num_skipped = 0;
+
+    bool read_header();
+    bool read_block(size_t size);
+    uint16_t get16(const uint8_t* p) const;
+    uint32_t get32(const uint8_t* p) const;
+
+    std::optional<MDNS_CapturedDatagram> next_pcap_record();
+    std::optional<MDNS_CapturedDatagram> next_pcapng_block();
+    void read_interface_block();
+
+    std::optional<MDNS_CapturedDatagram> decode(uint16_t link_type,
+        std::chrono::nanoseconds timestamp, const uint8_t* data, size_t size);
+};
+
+enum class MDNS_ReplaySpeed
+{
+    // keep the gaps between the packets as captured
+    ORIGINAL,
+    MAXIMUM
+};
+
+/** @brief hands every datagram of the capture to deliver, e.g. the receive
+ * callback MDNS_Service gave to the (mocked) IOUringInterface.
+ * @return the number of datagrams delivered
+ */
+size_t replay_capture(MDNS_PcapReader& reader, MDNS_ReplaySpeed speed,
+    const std::function<void(const iuring::ReceivedMessage&)>& deliver);
+
+} // namespace mdns
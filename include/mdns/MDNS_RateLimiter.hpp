@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace mdns
+{
+/** @brief RFC 6762 §6: a record must not be multicast on an interface
+ * more than once per second. Keyed on a hash of (name, type), one
+ * instance per interface.
+ *
+ * The table is open addressed with a fixed number of slots, allocated at
+ * construction. A record is looked for in the MAX_PROBE slots from its
+ * home slot on and takes the free or least recently used one of them when
+ * it isn't there, so allow() is O(1) and never allocates. Entries that
+ * expired are simply overwritten; when every slot in reach is still
+ * within its interval the oldest is evicted, at worst sending that record
+ * a second time within the second.
+ */
+class MDNS_RateLimiter
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds MIN_INTERVAL{ 1 };
+
+    // a few records per instance multicast within a second, rounded up to
+    // a power of two
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    // slots looked at per record
+    static constexpr size_t MAX_PROBE = 8;
+
+    explicit MDNS_RateLimiter(size_t capacity = DEFAULT_CAPACITY)
+        : m_slots(std::bit_ceil(std::max(capacity, MAX_PROBE)))
+    {
+    }
+
+    /** @return true (and remembers the time) when the record may be
+     * multicast now
+     */
+    bool allow(uint64_t record_key, clock::time_point now)
+    {
+        // 0 marks a free slot
+        const auto key = record_key == FREE ? 1 : record_key;
+        const auto mask = m_slots.size() - 1;
+        const auto home = static_cast<size_t>(key ^ (key >> 32));
+
+        Slot* victim = nullptr;
+        for (size_t i = 0; i < MAX_PROBE; i++)
+        {
+            auto& slot = m_slots[(home + i) & mask];
+            if (slot.key == key)
+            {
+                if (now - slot.last_multicast < MIN_INTERVAL)
+                {
+                    m_num_suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                slot.last_multicast = now;
+                return true;
+            }
+            if (slot.key == FREE)
+            {
+                // slots are never freed again, the key can't be further on
+                victim = &slot;
+                break;
+            }
+            if (!victim || slot.last_multicast < victim->last_multicast)
+            {
+                victim = &slot;
+            }
+        }
+
+        if (victim->key == FREE)
+        {
+            m_num_entries.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (now - victim->last_multicast < MIN_INTERVAL)
+        {
+            m_num_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+        victim->key = key;
+        victim->last_multicast = now;
+        return true;
+    }
+
+    /** @brief forgets when every record was multicast, as after the link
+     * came back and everything is announced again (RFC 6762 §8.3). The
+     * slots stay allocated, the suppression and eviction counts stay.
+     */
+    void reset()
+    {
+        std::fill(m_slots.begin(), m_slots.end(), Slot{});
+        m_num_entries.store(0, std::memory_order_relaxed);
+    }
+
+    size_t get_capacity() const
+    {
+        return m_slots.size();
+    }
+
+    // the getters may be called from any thread
+    uint64_t get_num_suppressed() const
+    {
+        return m_num_suppressed.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_num_entries() const
+    {
+        return m_num_entries.load(std::memory_order_relaxed);
+    }
+
+    /** @brief entries replaced while their interval was still running
+     */
+    uint64_t get_num_evictions() const
+    {
+        return m_num_evictions.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint64_t FREE = 0;
+
+    struct Slot
+    {
+        uint64_t key = FREE;
+        clock::time_point last_multicast;
+    };
+
+    std::vector<Slot> m_slots;
+    std::atomic<uint64_t> m_num_suppressed{ 0 };
+    std::atomic<uint64_t> m_num_entries{ 0 };
+    std::atomic<uint64_t> m_num_evictions{ 0 };
+};
+
+} // namespace mdns
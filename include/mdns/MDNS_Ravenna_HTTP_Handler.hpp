@@ -1,16 +1,41 @@
 #pragma once
 
+#include <array>
+#include <string>
+
 #include "MDNS_Service.hpp"
 
 namespace mdns
 {
+/** @brief publishes one RAVENNA node. A process hosting many (virtual)
+ * nodes adds node_instances() of each to the service registry instead,
+ * where they are found through its index.
+ */
 class MDNS_Ravenna_HTTP_Handler : public IMDNS_Handler
 {
 public:
-    using IMDNS_Handler::IMDNS_Handler;
+    MDNS_Ravenna_HTTP_Handler(
+        const std::shared_ptr<iuring::IOUringInterface>& network,
+        logging::ILogger& logger, iuring::NetworkAdapter& adapter,
+        const std::string& node_id = get_vendor_node_id(),
+        const std::string& node_name = get_vendor_node_name());
 
     MDNS_IsHandled handle_question(const QuestionData& q, IAnswerList& answer) override;
     MDNS_IsHandled handle_reply(const std::vector<ReplyData>& q) override;
+    void append_announcement(IAnswerList& answer) override;
+
+    /** @brief the HTTP and RTSP services of a node with "ravenna"
+     * subtypes, on host <node name>.local
+     */
+    static std::array<MDNS_ServiceInstance, 2> node_instances(
+        const std::string& node_id, const std::string& node_name);
+
+private:
+    // built once, answering doesn't allocate
+    name_list_t m_hostname;
+    std::array<name_list_t, 4> m_service_names;
+
+    void append_records(const name_list_t& ptr_name, IAnswerList& answer);
 };
 
 } // namespace mdns
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <format>
+#include <functional>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 
 #include <iuring/IOUringInterface.hpp>
@@ -15,11 +22,44 @@
 #include "MDNS_Header.hpp"
 
 #include "IMDNS_Handler.hpp"
+#include "MDNS_EgressPacer.hpp"
+#include "MDNS_Metrics.hpp"
+#include "MDNS_RateLimiter.hpp"
+#include "MDNS_ServiceRegistry.hpp"
+#include "MDNS_TxScheduler.hpp"
+#include "SPSC_Ring.hpp"
 
 namespace mdns
 {
+class MDNS_AnswerList;
+class MDNS_PcapWriter;
+class MDNS_Worker;
+
+/** @brief what to do with a parsed query when the pending-query ring is full
+ */
+enum class MDNS_OverflowPolicy
+{
+    DROP_NEWEST,
+    // only valid when receiving and draining run on the same thread
+    DROP_OLDEST
+};
+
+/** @brief where queries are parsed and answered
+ */
+enum class MDNS_ProcessingMode
+{
+    // on the realtime thread, bounded by the tick budget
+    INLINE,
+    // on a low priority worker thread, the realtime thread only copies
+    // datagrams in and submits the finished replies
+    WORKER_THREAD
+};
+
 class MDNS_Service : public service::Service
 {
+    // white-box access for the benchmarks and tests
+    friend struct MDNS_ServiceProbe;
+
 public:
     static iuring::IPAddress MDNS_MCAST_IPADDR;
     static iuring::IPAddress MDNS_MCAST_IPADDR6;
@@ -27,12 +67,17 @@ public:
     MDNS_Service(const std::shared_ptr<realtime::RealtimeKernel>& rt_kernel,
         const std::shared_ptr<iuring::IOUringInterface>& network,
         logging::ILogger& logger, iuring::NetworkAdapter& adapter,
-        iuring::ISocketFactory& socket_factory)
-        : service::Service(rt_kernel, logger)
-        , m_socket_factory(socket_factory)
-        , m_adapter(adapter)
-        , m_network(network)
+        iuring::ISocketFactory& socket_factory);
+
+    ~MDNS_Service();
+
+    /** @brief serves an additional NIC (e.g. the secondary network of a
+     * ST 2022-7 setup) from the same handlers and registry.
+     * Must be called before init().
+     */
+    void add_interface(iuring::NetworkAdapter& adapter)
     {
+        m_interfaces.emplace_back(adapter);
     }
 
     std::shared_ptr<iuring::IOUringInterface>& get_io()
@@ -42,37 +87,330 @@ public:
 
     [[nodiscard]] error::Error init();
 
-    error::Error finish() override
+    /** @brief multicasts goodbye records (TTL 0) for everything we
+     * published so peers drop us from their caches immediately.
+     */
+    error::Error finish() override;
+
+    // changes within this window are merged into a single announcement
+    static constexpr std::chrono::milliseconds ANNOUNCE_DEBOUNCE{ 250 };
+
+    void add_handler(const std::shared_ptr<IMDNS_Handler>& handler);
+
+    /** @brief publishes a service. Services added within
+     * ANNOUNCE_DEBOUNCE of each other are announced in one burst.
+     * @return false when one of its names doesn't fit in a DNS name
+     */
+    [[nodiscard]] bool add_service(const MDNS_ServiceInstance& instance);
+
+    /** @brief withdraws a service, peers are told via a goodbye packet
+     * batched like the announcements
+     */
+    void remove_service(const name_list_t& instance_name);
+
+    static constexpr size_t MAX_PENDING_QUERIES = 64;
+    static constexpr size_t MAX_QUERY_BATCH = 16;
+
+    // questions answered per query, the rest of a longer one is ignored so
+    // a pending query slot holds at most this many
+    static constexpr size_t MAX_QUESTIONS_PER_QUERY = 16;
+
+    void set_overflow_policy(MDNS_OverflowPolicy policy)
+    {
+        m_overflow_policy = policy;
+    }
+
+    uint64_t get_num_dropped_queries() const
+    {
+        return m_metrics.dropped_queries.load(std::memory_order_relaxed);
+    }
+
+    static constexpr std::chrono::microseconds DEFAULT_TICK_BUDGET{ 200 };
+
+    /** @brief CPU time the query path may use per kernel tick. Once used up
+     * the remaining queries are deferred to the next tick so mdns storms
+     * can't starve the realtime tasks.
+     */
+    void set_tick_budget(std::chrono::nanoseconds budget)
+    {
+        m_tick_budget = budget;
+    }
+
+    /** @brief rate (with random jitter on top of every gap) announcements
+     * and goodbyes are paced to on the interface of adapter. Responses on
+     * it are sent right away and count against it.
+     */
+    void set_announcement_rate(const iuring::NetworkAdapter& adapter,
+        uint32_t packets_per_sec, std::chrono::microseconds max_jitter);
+
+    /** @brief limits the bytes and packets mdns sends on the interface of
+     * adapter, MDNS_EgressLimit's defaults apply until then
+     */
+    void set_egress_limit(
+        const iuring::NetworkAdapter& adapter, const MDNS_EgressLimit& limit);
+
+    // number of times work was left for a later tick
+    uint64_t get_num_deferred_batches() const
+    {
+        return m_metrics.deferred_batches.load(std::memory_order_relaxed);
+    }
+
+    // number of ticks that used more than the budget
+    uint64_t get_num_budget_overruns() const
+    {
+        return m_metrics.budget_overruns.load(std::memory_order_relaxed);
+    }
+
+    /** @brief writes every received datagram to the capture before it is
+     * parsed, e.g. to replay it later. The realtime thread only copies the
+     * datagram into the capture's ring, datagrams arriving while it is
+     * full are left out of the file.
+     */
+    void set_capture(const std::shared_ptr<MDNS_PcapWriter>& capture)
+    {
+        m_capture = capture;
+    }
+
+    /** @brief consistent per counter, safe to call from any thread. Render
+     * with to_prometheus_text() for scraping.
+     */
+    MDNS_MetricsSnapshot get_metrics() const;
+
+    /** @brief must be called before init(). In WORKER_THREAD mode the
+     * handlers, the registry and the announcements are used on the worker
+     * thread only: add_handler(), add_service() and remove_service() hand
+     * their changes to it and must be called from the kernel thread once
+     * init() started it. Handlers change what they answer from through
+     * IMDNS_Handler::run_on_service() and must protect state they share
+     * with the rest of the application themselves.
+     */
+    void set_processing_mode(MDNS_ProcessingMode mode)
+    {
+        m_processing_mode = mode;
+    }
+
+protected:
+    /** @brief the handlers StaticMDNS_Service composes at compile time,
+     * asked before the ones added with add_handler() and the registry.
+     */
+    virtual MDNS_IsHandled dispatch_question(
+        [[maybe_unused]] const QuestionData& q,
+        [[maybe_unused]] MDNS_AnswerList& answer)
+    {
+        return MDNS_IsHandled::NOT_HANDLED_YET;
+    }
+
+    virtual MDNS_IsHandled dispatch_replies(
+        [[maybe_unused]] const std::vector<ReplyData>& replies)
     {
-        return error::Error::OK;
+        return MDNS_IsHandled::NOT_HANDLED_YET;
     }
 
-    void add_handler(const std::shared_ptr<IMDNS_Handler>& handler)
+    virtual void append_static_announcements(
+        [[maybe_unused]] MDNS_AnswerList& answer)
     {
-        m_handlers.push_back(handler);
     }
 
 private:
     iuring::ISocketFactory& m_socket_factory;
-    iuring::NetworkAdapter& m_adapter;
+    // the handlers, the registry and the pending announcements belong to
+    // the thread answering the queries, see change_state()
     std::vector<std::shared_ptr<IMDNS_Handler>> m_handlers;
-    std::shared_ptr<iuring::ISocket> m_listen_socket;
+    MDNS_ServiceRegistry m_registry;
+
+    std::vector<IMDNS_Handler*> m_pending_announcements;
+    // removed services waiting for their goodbye
+    std::vector<MDNS_ServiceInstance> m_pending_goodbyes;
+    bool m_announcement_armed = false;
+    std::chrono::steady_clock::time_point m_last_announce_request;
     std::shared_ptr<iuring::IOUringInterface> m_network;
 
-    iuring::NetworkAdapter& get_adapter()
+    /** @brief per NIC state, everything else is shared between the NICs
+     */
+    struct Interface
     {
-        return m_adapter;
-    }
+        explicit Interface(iuring::NetworkAdapter& _adapter)
+            : adapter(_adapter)
+        {
+        }
 
-    void send_reply(const std::vector<QuestionData>& questions,
-        const iuring::IPAddress& from_address, transaction_id_t id);
+        iuring::NetworkAdapter& adapter;
+        std::optional<in_addr> host_ip4;
+        std::optional<in6_addr> host_ip6;
+        MDNS_RateLimiter rate_limiter;
+        MDNS_EgressPacer egress_pacer;
+        MDNS_TxScheduler tx_scheduler;
+    };
+    std::deque<Interface> m_interfaces;
 
-    void handle_query(
-        const iuring::ReceivedMessage& data, const MDNS_Header* hdr);
+    /** @brief a socket joined to the mdns group of one address family on
+     * one interface, replies go out on the listener the query arrived on.
+     */
+    struct Listener
+    {
+        std::shared_ptr<iuring::ISocket> socket;
+        iuring::IPAddress multicast_group;
+        Interface* iface;
+
+        // answers to queries that arrived in the same tick, sent as one
+        // aggregated response (RFC 6762 §6.4). Lives in m_answer_arena.
+        MDNS_AnswerList* pending_answers = nullptr;
+    };
+    std::vector<Listener> m_listeners;
+
+    // enough for the answer lists of a full batch without going upstream
+    static constexpr size_t ANSWER_ARENA_SIZE = 64 * 1024;
+
+    // the pending answer lists are built in here and the whole arena is
+    // released once they are sent, so answering doesn't touch the heap
+    std::unique_ptr<std::byte[]> m_answer_arena_buffer;
+    std::pmr::monotonic_buffer_resource m_answer_arena;
+
+    /** @brief a parsed query waiting to be answered
+     */
+    struct PendingQuery
+    {
+        // only ever grows up to MAX_QUESTIONS_PER_QUERY, the first
+        // num_questions are this query's
+        std::vector<QuestionData> questions;
+        size_t num_questions = 0;
+        std::optional<iuring::IPAddress> from_address;
+        size_t listener_ix = 0;
+        std::chrono::steady_clock::time_point received_at;
+    };
+    SPSC_Ring<PendingQuery, MAX_PENDING_QUERIES> m_pending_queries;
+
+    /** @brief an answered query whose latency is sampled once a datagram
+     * submitted after its reply was built completed
+     */
+    struct UnsentReply
+    {
+        std::chrono::steady_clock::time_point received_at;
+        std::chrono::steady_clock::time_point built_at;
+    };
+    SPSC_Ring<UnsentReply, MAX_PENDING_QUERIES> m_unsent_replies;
+    MDNS_OverflowPolicy m_overflow_policy = MDNS_OverflowPolicy::DROP_NEWEST;
+
+    std::chrono::nanoseconds m_tick_budget = DEFAULT_TICK_BUDGET;
+
+    bool m_tx_pacing_armed = false;
+    bool m_egress_pacing_armed = false;
+
+    MDNS_Metrics m_metrics;
+    std::shared_ptr<MDNS_PcapWriter> m_capture;
+
+    MDNS_ProcessingMode m_processing_mode = MDNS_ProcessingMode::INLINE;
+    std::unique_ptr<MDNS_Worker> m_worker;
+    bool m_worker_poll_armed = false;
+
+    // set by the worker when a change needs announcing, the realtime
+    // thread arms the announcement when it polls the worker
+    std::atomic<bool> m_announcement_requested{ false };
+
+    [[nodiscard]] error::Error add_listener(Interface& iface,
+        iuring::SocketType type, const iuring::IPAddress& multicast_group,
+        const iuring::IPAddress& interface_ip);
+
+    MDNS_AnswerList& get_pending_answers(Listener& listener);
+    /** @return true when the questions added answers to the reply
+     */
+    bool send_reply(std::span<const QuestionData> questions,
+        const iuring::IPAddress& from_address, Listener& listener);
+    void flush_pending_answers();
+
+    PendingQuery* acquire_pending_query();
+    realtime::TaskStatus drain_pending_queries();
+
+    /** @brief answers up to MAX_QUERY_BATCH pending queries within budget
+     * @return true when queries are left for another round
+     */
+    bool answer_pending_queries(std::chrono::nanoseconds budget);
+
+    /** @brief samples the latency of the replies built before a datagram
+     * submitted at submitted_at, called when that datagram completed
+     */
+    void record_sent_replies(
+        std::chrono::steady_clock::time_point submitted_at);
+
+    void send_answers(const MDNS_AnswerList& answers, transaction_id_t id,
+        const Listener& listener,
+        MDNS_TxPriority priority = MDNS_TxPriority::RESPONSE);
+    /** @brief what became of a datagram handed to submit_datagram()
+     */
+    enum class SubmitResult
+    {
+        SENT,
+        // held back by the egress pacer, it goes out later
+        QUEUED,
+        // the pacer had the same datagram queued already
+        COALESCED,
+        DROPPED,
+        // no send work item, nothing was done
+        FAILED
+    };
+
+    /** @brief sends through the interface's egress pacer
+     */
+    SubmitResult submit_datagram(const Listener& listener,
+        std::span<const uint8_t> header, std::span<const uint8_t> payload);
+    /** @brief hands the datagram to io_uring and counts it as sent, header
+     * may be empty when payload starts with it
+     */
+    bool send_datagram(const Listener& listener,
+        std::span<const uint8_t> header, std::span<const uint8_t> payload);
+    void arm_egress_pacing();
+    realtime::TaskStatus send_egress_queue();
+
+    /** @brief runs task once when deadline is reached, on the next tick
+     * when it already passed. Waiting for a deadline takes a timed task,
+     * idle tasks are only for work that can be done right away.
+     */
+    void run_at(const std::string& name,
+        std::chrono::steady_clock::time_point deadline,
+        const std::function<realtime::TaskStatus(realtime::BaseTask&)>& task);
+
+    // how often the realtime thread collects the worker's replies while it
+    // has datagrams in flight
+    static constexpr std::chrono::microseconds WORKER_POLL_INTERVAL{ 250 };
+
+    void start_worker();
+    void arm_worker_poll();
+    void submit_worker_output();
+    void receive(const iuring::ReceivedMessage& data, size_t listener_ix);
+
+    /** @brief announcements and goodbyes go out on all listeners, each
+     * with the addresses of its own interface.
+     */
+    void send_unsolicited(
+        const std::function<void(MDNS_AnswerList&)>& fill, bool goodbye);
+
+    void arm_tx_pacing();
+    realtime::TaskStatus send_paced();
+
+    /** @brief applies change where the queries are answered: queued for
+     * the worker when it runs, right away on its thread or without one
+     * @return false when the worker's command ring is full and the change
+     * was dropped
+     */
+    [[nodiscard]] bool change_state(std::move_only_function<void()> change);
+
+    void schedule_announcement(IMDNS_Handler& handler);
+    /** @brief arms the announcement, from the worker via the realtime
+     * thread
+     */
+    void announce_later();
+    void arm_announcement();
+    realtime::TaskStatus send_pending_announcements();
+    void announce_pending();
+
+    void handle_query(const iuring::ReceivedMessage& data,
+        const MDNS_Header* hdr, size_t listener_ix,
+        std::chrono::steady_clock::time_point received_at);
     void handle_reply(
         const iuring::ReceivedMessage& data, const MDNS_Header* hdr);
 
-    void process_event(const iuring::ReceivedMessage& data);
+    void process_event(const iuring::ReceivedMessage& data, size_t listener_ix,
+        std::chrono::steady_clock::time_point received_at);
 };
 
 std::string get_vendor_node_id();
@@ -151,6 +489,15 @@ template <> struct std::formatter<mdns::RRType>
         case mdns::RRType::SRV:
             name = "SRV";
             break;
+        case mdns::RRType::NSEC:
+            name = "NSEC";
+            break;
+        case mdns::RRType::ANY:
+            name = "ANY";
+            break;
+        case mdns::RRType::AAAA:
+            name = "AAAA";
+            break;
         default:
             name = "Unknown";
             break;
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "IMDNS_Handler.hpp"
+
+namespace mdns
+{
+/** @brief a DNS-SD service instance (RFC 6763 §4), for example:
+ *
+ *  instance_name: fa_node_id
+ *  service_type:  _http._tcp.local
+ *  subtypes:      _ravenna  (-> _ravenna._sub._http._tcp.local)
+ *  host_name:     fanode.local
+ */
+struct MDNS_ServiceInstance
+{
+    std::string instance_name;
+    name_list_t service_type;
+    std::vector<std::string> subtypes;
+    name_list_t host_name;
+    uint16_t port;
+    std::string txt;
+
+    /** @return std::nullopt when the instance name is empty, longer than
+     * a label or makes the name too long
+     */
+    std::optional<name_list_t> get_instance_name() const
+    {
+        name_list_t ret;
+        if (!ret.push_back(instance_name) || !ret.append(service_type))
+        {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    std::optional<name_list_t> get_subtype_name(
+        const std::string& subtype) const
+    {
+        name_list_t ret;
+        if (!ret.push_back(subtype) || !ret.push_back("_sub") ||
+            !ret.append(service_type))
+        {
+            return std::nullopt;
+        }
+        return ret;
+    }
+
+    /** @brief true when all names of the instance fit in DNS names
+     */
+    bool has_valid_names() const
+    {
+        return !host_name.empty() && host_name.valid() &&
+            get_instance_name().has_value() &&
+            std::ranges::all_of(subtypes, [this](const std::string& subtype) {
+                return get_subtype_name(subtype).has_value();
+            });
+    }
+};
+
+
+/** @brief the services published by this node.
+ * The MDNS_Service answers queries for these and sends goodbye packets
+ * when they are removed.
+ *
+ * Sized for gateways publishing thousands of virtual nodes: every name an
+ * instance answers to (instance, host, service type and subtype names) is
+ * stored once, however many instances share it, and found through a hash
+ * index, so answering a question doesn't depend on the number of
+ * instances. Names are kept as their first label and the name of the
+ * rest, and labels are interned, so "node-1._http._tcp.local" and
+ * "node-1.local" share "node-1" and the suffixes every instance has are
+ * stored once. Service types and subtypes know the instances a browse
+ * finds and the service types answer the enumeration of RFC 6763 §9.
+ */
+class MDNS_ServiceRegistry
+{
+public:
+    /** @return false (and leaves the registry unchanged) when the
+     * instance doesn't have valid names, see has_valid_names()
+     */
+    [[nodiscard]] bool add(const MDNS_ServiceInstance& instance);
+
+    /** @return the removed instance so the caller can send a goodbye for it
+     */
+    std::optional<MDNS_ServiceInstance> remove(const name_list_t& instance_name);
+
+    bool empty() const
+    {
+        return m_num_instances == 0;
+    }
+
+    size_t size() const
+    {
+        return m_num_instances;
+    }
+
+    /** @brief the distinct labels stored for all names
+     */
+    size_t get_num_labels() const
+    {
+        return m_labels.size() - m_free_labels.size();
+    }
+
+    MDNS_IsHandled handle_question(
+        const QuestionData& q, IAnswerList& answer) const;
+
+    /** @brief appends all records of a single instance (announce / goodbye)
+     */
+    static void append_records(
+        const MDNS_ServiceInstance& instance, IAnswerList& answer);
+
+    /** @brief appends all records of all instances
+     */
+    void append_all(IAnswerList& answer) const;
+
+    /** @brief appends the records of the instances added since the last
+     * call, so they are announced together
+     */
+    void append_added(IAnswerList& answer);
+
+private:
+    static constexpr uint32_t NO_ID = UINT32_MAX;
+
+    /** @brief a label shared by all names that have it, case preserved
+     */
+    struct Label
+    {
+        std::string text;
+        uint64_t hash = 0;
+        uint32_t num_refs = 0;
+    };
+
+    /** @brief a name we answer for with the roles it has, or the suffix of
+     * such a name
+     */
+    struct NameEntry
+    {
+        uint32_t label = NO_ID;
+        // the name without its first label, NO_ID for a single label
+        uint32_t parent = NO_ID;
+        uint64_t hash = 0;
+        // instances using the name in any role and names it is the parent of
+        uint32_t num_refs = 0;
+        // the instances a browse finds (service type or subtype name)
+        std::vector<uint32_t> browse;
+        // the instance named so
+        uint32_t instance = NO_ID;
+        // the instances on this host
+        uint32_t num_hosted = 0;
+    };
+
+    /** @brief an instance, its names are ids into m_names
+     */
+    struct Entry
+    {
+        // NO_ID for a free slot
+        uint32_t name = NO_ID;
+        uint32_t service_type = NO_ID;
+        uint32_t host_name = NO_ID;
+        std::vector<uint32_t> subtype_names;
+        uint16_t port = 0;
+        // rendered once on add(), every answer copies it as is
+        std::string txt_rdata;
+    };
+
+    // slots are reused, so ids stay valid while their instance lives
+    std::vector<Label> m_labels;
+    std::vector<uint32_t> m_free_labels;
+    std::unordered_multimap<uint64_t, uint32_t> m_label_index;
+
+    std::vector<NameEntry> m_names;
+    std::vector<uint32_t> m_free_names;
+    std::unordered_multimap<uint64_t, uint32_t> m_name_index;
+
+    std::vector<Entry> m_instances;
+    std::vector<uint32_t> m_free_instances;
+    size_t m_num_instances = 0;
+
+    // the answer to the service type enumeration
+    std::vector<uint32_t> m_service_types;
+    // not announced yet
+    std::vector<uint32_t> m_added;
+
+    // names differing only in case are the same name (RFC 6762 §16)
+    uint32_t find_name(const name_list_t& name) const;
+    bool name_equals(uint32_t id, const name_list_t& name) const;
+    uint32_t acquire_name(const name_list_t& name);
+    void release_name(uint32_t id);
+    uint32_t acquire_label(std::string_view label);
+    void release_label(uint32_t id);
+    void add_browse(uint32_t name, uint32_t ix, bool is_service_type);
+    void remove_browse(uint32_t name, uint32_t ix);
+
+    const std::string& get_label(uint32_t name) const
+    {
+        return m_labels[m_names[name].label].text;
+    }
+
+    /** @brief the name put together from its labels
+     */
+    name_list_t get_name(uint32_t id) const;
+
+    // a name with none of the roles is only the suffix of others
+    static bool has_roles(const NameEntry& name)
+    {
+        return !name.browse.empty() || name.instance != NO_ID ||
+            name.num_hosted > 0;
+    }
+
+    MDNS_ServiceInstance to_instance(const Entry& entry) const;
+    void append_entry_records(const Entry& entry, IAnswerList& answer) const;
+    void append_answers(const Entry& entry, IAnswerList& answer) const;
+};
+
+} // namespace mdns
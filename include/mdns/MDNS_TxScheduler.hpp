@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace mdns
+{
+/** @brief what a packet is for: responses go out right away (through the
+ * egress pacer), announcements and goodbyes are queued on the interface's
+ * MDNS_TxScheduler
+ */
+enum class MDNS_TxPriority : uint8_t
+{
+    RESPONSE,
+    ANNOUNCEMENT
+};
+
+/** @brief paces multicast packets to a packet rate, so bringing up (or
+ * down) hundreds of services doesn't overrun switch multicast queues and
+ * the socket buffers of every receiver on the VLAN. One per interface.
+ *
+ * Queued packets leave one at a time in the order they were queued, spaced
+ * by 1 / packets_per_sec plus a random jitter of up to max_jitter so that
+ * responders starting together don't stay in step. Packets sent right
+ * away (responses) are charged to the same rate: the queued ones keep a
+ * gap behind the last of them. The debt doesn't add up beyond that, so a
+ * response storm doesn't hold back announcements and goodbyes once it is
+ * over.
+ */
+class MDNS_TxScheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t DEFAULT_PACKETS_PER_SEC = 100;
+    static constexpr std::chrono::microseconds DEFAULT_MAX_JITTER{ 10000 };
+    // how long the queue waits after a packet that was due failed to send
+    static constexpr std::chrono::milliseconds SEND_RETRY_INTERVAL{ 1 };
+
+    struct Datagram
+    {
+        size_t listener_ix;
+        std::vector<uint8_t> data;
+    };
+
+    MDNS_TxScheduler()
+        : m_random(std::random_device{}())
+    {
+        set_rate(DEFAULT_PACKETS_PER_SEC, DEFAULT_MAX_JITTER);
+    }
+
+    void set_rate(
+        uint32_t packets_per_sec, std::chrono::microseconds max_jitter)
+    {
+        m_interval = std::chrono::nanoseconds(std::chrono::seconds(1)) /
+            std::max<uint32_t>(packets_per_sec, 1);
+        m_max_jitter = max_jitter;
+    }
+
+    void push(size_t listener_ix, std::span<const uint8_t> header,
+        std::span<const uint8_t> payload)
+    {
+        auto& d = m_queue.emplace_back(Datagram{ listener_ix, {} });
+        d.data.reserve(header.size() + payload.size());
+        d.data.insert(d.data.end(), header.begin(), header.end());
+        d.data.insert(d.data.end(), payload.begin(), payload.end());
+    }
+
+    /** @brief accounts for a packet that was sent without queueing
+     */
+    void charge(clock::time_point now)
+    {
+        m_next_send = std::max(m_next_send, now + next_gap());
+    }
+
+    /** @return the packet to send now, nullptr when none is due
+     */
+    const Datagram* next(clock::time_point now) const
+    {
+        if (now < m_next_send || m_queue.empty())
+        {
+            return nullptr;
+        }
+        return &m_queue.front();
+    }
+
+    /** @brief removes the packet next() returned after it was sent
+     */
+    void pop(clock::time_point now)
+    {
+        m_queue.pop_front();
+        charge(now);
+    }
+
+    /** @brief holds the queue back for SEND_RETRY_INTERVAL after the packet
+     * next() returned couldn't be sent
+     */
+    void retry_later(clock::time_point now)
+    {
+        m_next_send = std::max(m_next_send, now + SEND_RETRY_INTERVAL);
+    }
+
+    /** @brief hands out all queued packets at once, for shutdown
+     */
+    template <typename F> void drain(const F& send)
+    {
+        for (const auto& d : m_queue)
+        {
+            send(d);
+        }
+        m_queue.clear();
+    }
+
+    /** @brief when next() hands out the next packet, if one is queued
+     */
+    clock::time_point get_next_send() const
+    {
+        return m_next_send;
+    }
+
+    bool empty() const
+    {
+        return m_queue.empty();
+    }
+
+    size_t size() const
+    {
+        return m_queue.size();
+    }
+
+private:
+    std::deque<Datagram> m_queue;
+    clock::time_point m_next_send{};
+    std::chrono::nanoseconds m_interval{};
+    std::chrono::nanoseconds m_max_jitter{};
+    std::minstd_rand m_random;
+
+    std::chrono::nanoseconds next_gap()
+    {
+        if (m_max_jitter.count() <= 0)
+        {
+            return m_interval;
+        }
+        std::uniform_int_distribution<int64_t> jitter(0, m_max_jitter.count());
+        return m_interval + std::chrono::nanoseconds(jitter(m_random));
+    }
+};
+
+} // namespace mdns
@@ -1,9 +1,8 @@
 #pragma once
 
-#include <vector>
-#include <string>
 #include <cstdint>
 
+#include "DNSName.hpp"
 #include "MDNS_Header.hpp"
 
 
@@ -11,14 +10,15 @@ namespace mdns
 {
 struct QuestionData
 {
-    std::vector<std::string> name_list;
+    name_list_t name_list;
     uint16_t type;
     MDNS_class clazz;
     bool question_unicast;
 
-    bool equals(const std::vector<std::string>& s) const
+    // names are matched case insensitively (RFC 6762 §16)
+    bool equals(const name_list_t& s) const
     {
-        return name_list == s;
+        return name_list.equals_canonical(s);
     }
 };
 
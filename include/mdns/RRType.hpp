@@ -18,7 +18,9 @@ enum class RRType : uint8_t
     PTR = 12,   // Domain name pointer
     TXT = 16,   // Text strings
     AAAA = 28,  // IPv6 address
-    SRV = 33    // Server Selection
+    SRV = 33,   // Server Selection
+    NSEC = 47,  // Next Secure, which types exist for a name
+    ANY = 255   // all records, only as QTYPE
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+
+namespace mdns
+{
+/** @brief bounded single-producer/single-consumer ring.
+ *
+ * Slots are reused in place: the producer fills the slot returned by
+ * acquire() and publishes it with commit(), the consumer reads front()
+ * and releases it with pop(). Whatever the slot owns (e.g. vector
+ * capacity) is kept for the next round, so a warm ring doesn't allocate.
+ */
+template <typename T, size_t Capacity> class SPSC_Ring
+{
+    static_assert(std::has_single_bit(Capacity), "capacity must be 2^n");
+
+public:
+    /** @return the next free slot or nullptr when the ring is full
+     */
+    T* acquire()
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return nullptr;
+        }
+        return &m_items[tail & (Capacity - 1)];
+    }
+
+    void commit()
+    {
+        m_tail.fetch_add(1, std::memory_order_release);
+    }
+
+    /** @return the oldest filled slot or nullptr when the ring is empty
+     */
+    T* front()
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &m_items[head & (Capacity - 1)];
+    }
+
+    void pop()
+    {
+        m_head.fetch_add(1, std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) -
+            m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    std::array<T, Capacity> m_items{};
+    alignas(64) std::atomic<size_t> m_head{ 0 };
+    alignas(64) std::atomic<size_t> m_tail{ 0 };
+};
+
+} // namespace mdns
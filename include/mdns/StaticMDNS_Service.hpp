@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DNSName.hpp"
+#include "MDNS_AnswerList.hpp"
+#include "MDNS_Service.hpp"
+
+namespace mdns
+{
+/** @brief a handler StaticMDNS_Service can compose: it declares the names
+ * it answers as mdns_name literals and writes straight into the (final)
+ * MDNS_AnswerList, e.g.
+ *
+ *  struct MyHandler
+ *  {
+ *      static constexpr std::array question_names{
+ *          mdns_name<"_my-service._tcp.local"> };
+ *
+ *      MDNS_IsHandled handle_question(
+ *          const QuestionData& q, MDNS_AnswerList& answer);
+ *
+ *      // optional
+ *      static constexpr std::array question_types{ RRType::PTR };
+ *      MDNS_IsHandled handle_reply(const std::vector<ReplyData>& replies);
+ *      void append_announcement(MDNS_AnswerList& answer);
+ *  };
+ *
+ * handle_question() is only called for questions whose name is one of
+ * question_names and, if declared, whose type is ANY or one of
+ * question_types.
+ */
+template <typename H>
+concept StaticMDNS_Handler =
+    requires(H& h, const QuestionData& q, MDNS_AnswerList& answer) {
+        requires std::same_as<
+            std::remove_cvref_t<decltype(H::question_names[0])>,
+            DNSNameLiteral>;
+        { std::size(H::question_names) } -> std::convertible_to<size_t>;
+        { h.handle_question(q, answer) } -> std::same_as<MDNS_IsHandled>;
+    };
+
+/** @brief MDNS_Service with a handler set fixed at compile time.
+ *
+ * The handlers are held by value and called directly, so their name
+ * matching and record encoding can be inlined. A question's name is hashed
+ * once and looked up in a table of all declared names that is sorted at
+ * compile time, only the handler declaring the name is called (handlers
+ * declaring the same name are tried in template argument order). That
+ * costs one virtual call per question however many handlers there are.
+ *
+ * A declared name belongs to the static handlers: its questions are
+ * settled by them, even when none has records of the asked type, and never
+ * reach the handlers added with add_handler() or the service registry,
+ * which answer all other names. Static handlers are part of the goodbye
+ * packet but can't request announcements.
+ */
+template <StaticMDNS_Handler... Handlers>
+class StaticMDNS_Service : public MDNS_Service
+{
+public:
+    StaticMDNS_Service(
+        const std::shared_ptr<realtime::RealtimeKernel>& rt_kernel,
+        const std::shared_ptr<iuring::IOUringInterface>& network,
+        logging::ILogger& logger, iuring::NetworkAdapter& adapter,
+        iuring::ISocketFactory& socket_factory, Handlers... handlers)
+        : MDNS_Service(rt_kernel, network, logger, adapter, socket_factory)
+        , m_static_handlers(std::move(handlers)...)
+    {
+    }
+
+    template <typename H> H& get_handler()
+    {
+        return std::get<H>(m_static_handlers);
+    }
+
+protected:
+    MDNS_IsHandled dispatch_question(
+        const QuestionData& q, MDNS_AnswerList& answer) override
+    {
+        const auto hash = q.name_list.get_canonical_hash();
+        auto route = std::ranges::lower_bound(ROUTES, hash, {}, &Route::hash);
+        bool routed = false;
+        for (; route != ROUTES.end() && route->hash == hash; route++)
+        {
+            if (!q.name_list.equals_canonical(*route->name))
+            {
+                continue;
+            }
+            routed = true;
+            if (call_handle_question(route->handler_ix, q, answer,
+                    std::index_sequence_for<Handlers...>{}) ==
+                MDNS_IsHandled::IS_HANDLED)
+            {
+                break;
+            }
+        }
+        // the dynamic handlers and the registry don't see routed names
+        return routed ? MDNS_IsHandled::IS_HANDLED
+                      : MDNS_IsHandled::NOT_HANDLED_YET;
+    }
+
+    MDNS_IsHandled dispatch_replies(
+        const std::vector<ReplyData>& replies) override
+    {
+        return std::apply(
+            [&replies](auto&... h) {
+                const bool handled = (handle_reply(h, replies) || ...);
+                return handled ? MDNS_IsHandled::IS_HANDLED
+                               : MDNS_IsHandled::NOT_HANDLED_YET;
+            },
+            m_static_handlers);
+    }
+
+    void append_static_announcements(MDNS_AnswerList& answer) override
+    {
+        std::apply(
+            [&answer](auto&... h) { (append_announcement(h, answer), ...); },
+            m_static_handlers);
+    }
+
+private:
+    std::tuple<Handlers...> m_static_handlers;
+
+    template <size_t Ix>
+    using handler_t = std::tuple_element_t<Ix, std::tuple<Handlers...>>;
+
+    struct Route
+    {
+        uint64_t hash;
+        const DNSName* name;
+        size_t handler_ix;
+    };
+
+    static consteval auto make_routes()
+    {
+        std::array<Route, (std::size(Handlers::question_names) + ... + 0)>
+            routes{};
+        size_t num_routes = 0;
+        size_t handler_ix = 0;
+        (
+            [&] {
+                for (const auto& literal : Handlers::question_names)
+                {
+                    routes[num_routes++] = Route{ literal.canonical_hash,
+                        &literal.name, handler_ix };
+                }
+                handler_ix++;
+            }(),
+            ...);
+        // a name declared twice keeps the handler order
+        std::ranges::sort(routes, [](const Route& a, const Route& b) {
+            return a.hash != b.hash ? a.hash < b.hash
+                                    : a.handler_ix < b.handler_ix;
+        });
+        return routes;
+    }
+
+    static constexpr auto ROUTES = make_routes();
+
+    template <size_t... Ix>
+    MDNS_IsHandled call_handle_question(size_t handler_ix,
+        const QuestionData& q, MDNS_AnswerList& answer,
+        std::index_sequence<Ix...>)
+    {
+        auto ret = MDNS_IsHandled::NOT_HANDLED_YET;
+        (void) ((handler_ix == Ix &&
+                    owns_type<handler_t<Ix>>(q.type) &&
+                    (ret = std::get<Ix>(m_static_handlers).handle_question(
+                         q, answer),
+                        true)) ||
+            ...);
+        return ret;
+    }
+
+    template <typename H> static constexpr bool owns_type(uint16_t qtype)
+    {
+        if constexpr (requires { H::question_types; })
+        {
+            return qtype == static_cast<uint16_t>(RRType::ANY) ||
+                std::ranges::any_of(H::question_types, [qtype](RRType type) {
+                    return static_cast<uint16_t>(type) == qtype;
+                });
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    template <typename H>
+    static bool handle_reply(H& h, const std::vector<ReplyData>& replies)
+    {
+        if constexpr (requires { h.handle_reply(replies); })
+        {
+            return h.handle_reply(replies) == MDNS_IsHandled::IS_HANDLED;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    template <typename H>
+    static void append_announcement(H& h, MDNS_AnswerList& answer)
+    {
+        if constexpr (requires { h.append_announcement(answer); })
+        {
+            h.append_announcement(answer);
+        }
+    }
+};
+
+} // namespace mdns
@@ -0,0 +1,607 @@
+#include <algorithm>
+#include <cstring>
+
+#include <mdns/MDNS_AnswerList.hpp>
+#include <mdns/MDNS_Header.hpp>
+
+namespace mdns
+{
+static constexpr uint8_t CACHE_FLASH_SHIFT = 15;
+static constexpr uint16_t COMPRESSION_POINTER = 0b1100000000000000;
+static constexpr uint16_t MAX_COMPRESSION_OFFSET = 0b0011111111111111;
+
+namespace
+{
+    void put_uint16(std::pmr::vector<uint8_t>& buf, uint16_t v)
+    {
+        buf.push_back(static_cast<uint8_t>(v >> 8));
+        buf.push_back(static_cast<uint8_t>(v));
+    }
+
+    void put_uint32(std::pmr::vector<uint8_t>& buf, uint32_t v)
+    {
+        put_uint16(buf, static_cast<uint16_t>(v >> 16));
+        put_uint16(buf, static_cast<uint16_t>(v));
+    }
+
+    void set_uint16(std::pmr::vector<uint8_t>& buf, size_t pos, uint16_t v)
+    {
+        buf[pos] = static_cast<uint8_t>(v >> 8);
+        buf[pos + 1] = static_cast<uint8_t>(v);
+    }
+
+    /** @brief writes the fixed part of a resource record and returns
+     * the position of the rdlength field so it can be patched afterwards.
+     */
+    size_t put_record_header(std::pmr::vector<uint8_t>& buf, RRType type,
+        bool cache_flush, uint32_t ttl_secs)
+    {
+        put_uint16(buf, static_cast<uint16_t>(type));
+        put_uint16(buf,
+            static_cast<uint16_t>(MDNS_class::IN) |
+                ((cache_flush ? 1 : 0) << CACHE_FLASH_SHIFT));
+        put_uint32(buf, ttl_secs);
+        const auto rdlen_pos = buf.size();
+        put_uint16(buf, 0);
+        return rdlen_pos;
+    }
+
+    void patch_rdlength(std::pmr::vector<uint8_t>& buf, size_t rdlen_pos)
+    {
+        set_uint16(buf, rdlen_pos, buf.size() - rdlen_pos - sizeof(uint16_t));
+    }
+
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    uint64_t hash_bytes(uint64_t h, const void* data, size_t len)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++)
+        {
+            h = (h ^ bytes[i]) * FNV_PRIME;
+        }
+        return h;
+    }
+
+    uint64_t hash_name(uint64_t h, const name_list_t& name)
+    {
+        for (const auto& label : name)
+        {
+            const uint8_t len = label.size();
+            h = hash_bytes(h, &len, 1);
+            h = hash_bytes(h, label.data(), label.size());
+        }
+        return h;
+    }
+} // namespace
+
+
+bool MDNS_AnswerList::suffix_matches(
+    const Packet& p, uint16_t offset, const name_list_t& name, size_t first)
+{
+    // the table only refers to names we wrote ourselves, so every label is
+    // in bounds and pointers only lead backwards
+    size_t pos = offset - sizeof(MDNS_Header);
+    size_t k = first;
+    while (true)
+    {
+        const uint8_t len = p.payload[pos];
+        if ((len & (COMPRESSION_POINTER >> 8)) == (COMPRESSION_POINTER >> 8))
+        {
+            pos = (((len & (MAX_COMPRESSION_OFFSET >> 8)) << 8) |
+                      p.payload[pos + 1]) -
+                sizeof(MDNS_Header);
+            continue;
+        }
+        if (len == 0)
+        {
+            return k == name.size();
+        }
+        if (k == name.size() || name[k].size() != len ||
+            memcmp(&p.payload[pos + 1], name[k].data(), len) != 0)
+        {
+            return false;
+        }
+        pos += len + 1;
+        k++;
+    }
+}
+
+void MDNS_AnswerList::write_name(Packet& p, const name_list_t& name)
+{
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        for (const auto offset : p.names)
+        {
+            if (suffix_matches(p, offset, name, i))
+            {
+                put_uint16(p.payload, COMPRESSION_POINTER | offset);
+                return;
+            }
+        }
+
+        const auto offset = sizeof(MDNS_Header) + p.payload.size();
+        if (offset <= MAX_COMPRESSION_OFFSET)
+        {
+            p.names.push_back(static_cast<uint16_t>(offset));
+        }
+
+        p.payload.push_back(static_cast<uint8_t>(name[i].size()));
+        p.payload.insert(p.payload.end(), name[i].begin(), name[i].end());
+    }
+    p.payload.push_back(0);
+}
+
+
+void MDNS_AnswerList::set_question(const QuestionData* q)
+{
+    m_question = q;
+}
+
+MDNS_AnswerList::Section MDNS_AnswerList::get_section(
+    const name_list_t& name, RRType type) const
+{
+    if (!m_question)
+    {
+        return Section::ANSWER;
+    }
+    if (!name.equals_canonical(m_question->name_list))
+    {
+        return Section::ADDITIONAL;
+    }
+
+    const auto qtype = m_question->type;
+    if (type == RRType::NSEC && qtype != static_cast<uint16_t>(type))
+    {
+        return Section::ADDITIONAL;
+    }
+    if (qtype == static_cast<uint16_t>(RRType::ANY) ||
+        qtype == static_cast<uint16_t>(type))
+    {
+        return Section::ANSWER;
+    }
+
+    const auto is_address = [](uint16_t t) {
+        return t == static_cast<uint16_t>(RRType::A) ||
+            t == static_cast<uint16_t>(RRType::AAAA);
+    };
+    if (is_address(qtype) && is_address(static_cast<uint16_t>(type)))
+    {
+        return Section::ADDITIONAL;
+    }
+    return Section::NONE;
+}
+
+uint32_t MDNS_AnswerList::intern_additional_name(const name_list_t& name)
+{
+    const auto hash = name.get_canonical_hash();
+    const auto [first, last] = m_additional_name_index.equal_range(hash);
+    for (auto it = first; it != last; it++)
+    {
+        if (m_additional_names[it->second].equals_canonical(name))
+        {
+            return it->second;
+        }
+    }
+
+    const auto ix = static_cast<uint32_t>(m_additional_names.size());
+    m_additional_names.push_back(name);
+    m_referenced_names.push_back(false);
+    m_additional_name_index.emplace(hash, ix);
+    return ix;
+}
+
+void MDNS_AnswerList::add_reference(const name_list_t& name)
+{
+    // announcements have no additional section
+    if (!m_question)
+    {
+        return;
+    }
+    m_referenced_names[intern_additional_name(name)] = true;
+}
+
+bool MDNS_AnswerList::is_referenced(uint32_t name) const
+{
+    return m_referenced_names[name];
+}
+
+template <typename Fill>
+bool MDNS_AnswerList::defer(
+    const name_list_t& name, RRType type, const Fill& fill)
+{
+    if (m_writing_additional)
+    {
+        return false;
+    }
+
+    switch (get_section(name, type))
+    {
+    case Section::ANSWER:
+        return false;
+    case Section::ADDITIONAL: {
+        auto& record = m_additional.emplace_back();
+        record.type = type;
+        record.name = intern_additional_name(name);
+        fill(record);
+        // the other address family and NSEC of the name asked for are sent
+        // even when nothing else is
+        if (name.equals_canonical(m_question->name_list))
+        {
+            add_reference(name);
+        }
+        return true;
+    }
+    case Section::NONE:
+        break;
+    }
+    return true;
+}
+
+void MDNS_AnswerList::write_additional_records()
+{
+    set_question(nullptr);
+    m_writing_additional = true;
+
+    // an additional record may point at further ones (PTR -> SRV -> A),
+    // repeat until nothing new is referenced
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (auto& record : m_additional)
+        {
+            if (record.written || !is_referenced(record.name))
+            {
+                continue;
+            }
+            record.written = true;
+            progress = true;
+
+            const auto& name = m_additional_names[record.name];
+            switch (record.type)
+            {
+            case RRType::PTR:
+            case RRType::SRV:
+                m_referenced_names[record.target] = true;
+                if (record.type == RRType::PTR)
+                {
+                    append_PTR(name, m_additional_names[record.target]);
+                }
+                else
+                {
+                    append_SRV(
+                        name, m_additional_names[record.target], record.port);
+                }
+                break;
+            case RRType::TXT:
+                write_TXT(name, record.txt);
+                break;
+            case RRType::A:
+                append_A(name, record.addr4);
+                break;
+            case RRType::AAAA:
+                append_AAAA(name, record.addr6);
+                break;
+            case RRType::NSEC:
+                write_NSEC(name, record.types);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    m_writing_additional = false;
+    m_additional.clear();
+    m_additional_names.clear();
+    m_additional_name_index.clear();
+    m_referenced_names.clear();
+}
+
+
+template <typename Encoder>
+void MDNS_AnswerList::append_record(const name_list_t& name, RRType type,
+    uint64_t rdata_hash, const Encoder& encode)
+{
+    auto key = hash_name(rdata_hash, name);
+    key = hash_bytes(key, &type, sizeof(type));
+
+    // an additional record is only worth sending once
+    if (m_writing_additional && m_record_keys.contains(key))
+    {
+        return;
+    }
+
+    auto* p = &m_packets.back();
+    auto old_size = p->payload.size();
+    auto old_num_names = p->names.size();
+    bool new_packet = false;
+
+    encode(*p);
+
+    if (sizeof(MDNS_Header) + p->payload.size() > MAX_PACKET_SIZE &&
+        (p->num_answers > 0 || m_writing_additional))
+    {
+        // doesn't fit anymore: roll back and start a new packet
+        p->payload.resize(old_size);
+        p->names.resize(old_num_names);
+
+        // additional records are optional (RFC 6762 §7.2), they go with
+        // the last answers or not at all
+        if (m_writing_additional)
+        {
+            return;
+        }
+
+        p = &m_packets.emplace_back();
+        old_size = 0;
+        old_num_names = 0;
+        new_packet = true;
+        encode(*p);
+    }
+
+    // only a record that goes out counts as multicast, one dropped for
+    // lack of room must not hold back the next attempt
+    if (m_rate_limiter && !m_rate_limiter->allow(key, m_now))
+    {
+        if (new_packet)
+        {
+            m_packets.pop_back();
+        }
+        else
+        {
+            p->payload.resize(old_size);
+            p->names.resize(old_num_names);
+        }
+        return;
+    }
+
+    m_record_keys.insert(key);
+    if (m_writing_additional)
+    {
+        p->num_additional++;
+        m_num_additional++;
+    }
+    else
+    {
+        p->num_answers++;
+        m_num_answers++;
+    }
+}
+
+
+void MDNS_AnswerList::append_PTR(
+    const name_list_t& name, const name_list_t& value)
+{
+    if (defer(name, RRType::PTR,
+            [&](AdditionalRecord& record) {
+                record.target = intern_additional_name(value);
+            }))
+    {
+        return;
+    }
+    add_reference(value);
+
+    const auto rdata_hash = hash_name(FNV_OFFSET, value);
+    append_record(name, RRType::PTR, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::PTR, false, ttl(TTL_OTHER_RECORD_SECS));
+        write_name(p, value);
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_TXT(const name_list_t& name, const std::string& txt)
+{
+    append_TXT(name, std::span(&txt, 1));
+}
+
+void MDNS_AnswerList::append_TXT(
+    const name_list_t& name, std::span<const std::string> strings)
+{
+    if (defer(name, RRType::TXT, [&](AdditionalRecord& record) {
+            for (const auto& s : strings)
+            {
+                record.txt.push_back(static_cast<char>(s.size()));
+                record.txt.append(s);
+            }
+        }))
+    {
+        return;
+    }
+
+    uint64_t rdata_hash = FNV_OFFSET;
+    for (const auto& s : strings)
+    {
+        const uint8_t len = s.size();
+        rdata_hash = hash_bytes(rdata_hash, &len, 1);
+        rdata_hash = hash_bytes(rdata_hash, s.data(), s.size());
+    }
+    append_record(name, RRType::TXT, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::TXT, false, ttl(TTL_OTHER_RECORD_SECS));
+        for (const auto& s : strings)
+        {
+            p.payload.push_back(static_cast<uint8_t>(s.size()));
+            p.payload.insert(p.payload.end(), s.begin(), s.end());
+        }
+        // RFC 6763 §6.1: no strings is a single empty one
+        if (strings.empty())
+        {
+            p.payload.push_back(0);
+        }
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_TXT_rdata(
+    const name_list_t& name, std::string_view rdata)
+{
+    if (defer(name, RRType::TXT,
+            [&](AdditionalRecord& record) { record.txt.assign(rdata); }))
+    {
+        return;
+    }
+    write_TXT(name, rdata);
+}
+
+void MDNS_AnswerList::write_TXT(const name_list_t& name, std::string_view rdata)
+{
+    // hashes as append_TXT(), over the same bytes
+    const auto rdata_hash = hash_bytes(FNV_OFFSET, rdata.data(), rdata.size());
+    append_record(name, RRType::TXT, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::TXT, false, ttl(TTL_OTHER_RECORD_SECS));
+        p.payload.insert(p.payload.end(), rdata.begin(), rdata.end());
+        if (rdata.empty())
+        {
+            p.payload.push_back(0);
+        }
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_SRV(
+    const name_list_t& name, const name_list_t& hostname_list, uint16_t port)
+{
+    if (defer(name, RRType::SRV, [&](AdditionalRecord& record) {
+            record.target = intern_additional_name(hostname_list);
+            record.port = port;
+        }))
+    {
+        return;
+    }
+    add_reference(hostname_list);
+
+    const uint16_t priority = 0;
+    const uint16_t weight = 0;
+
+    const auto rdata_hash =
+        hash_bytes(hash_name(FNV_OFFSET, hostname_list), &port, sizeof(port));
+    append_record(name, RRType::SRV, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::SRV, true, ttl(TTL_HOST_RECORD_SECS));
+        put_uint16(p.payload, priority);
+        put_uint16(p.payload, weight);
+        put_uint16(p.payload, port);
+        write_name(p, hostname_list);
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_A(const name_list_t& name, const in_addr& addr)
+{
+    if (defer(name, RRType::A,
+            [&](AdditionalRecord& record) { record.addr4 = addr; }))
+    {
+        return;
+    }
+
+    const auto rdata_hash =
+        hash_bytes(FNV_OFFSET, &addr.s_addr, sizeof(addr.s_addr));
+    append_record(name, RRType::A, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::A, true, ttl(TTL_HOST_RECORD_SECS));
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&addr.s_addr);
+        p.payload.insert(p.payload.end(), bytes, bytes + sizeof(addr.s_addr));
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_AAAA(const name_list_t& name, const in6_addr& addr)
+{
+    if (defer(name, RRType::AAAA,
+            [&](AdditionalRecord& record) { record.addr6 = addr; }))
+    {
+        return;
+    }
+
+    const auto rdata_hash =
+        hash_bytes(FNV_OFFSET, addr.s6_addr, sizeof(addr.s6_addr));
+    append_record(name, RRType::AAAA, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::AAAA, true, ttl(TTL_HOST_RECORD_SECS));
+        p.payload.insert(
+            p.payload.end(), addr.s6_addr, addr.s6_addr + sizeof(addr.s6_addr));
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+void MDNS_AnswerList::append_host_addresses(const name_list_t& name)
+{
+    if (m_host_ip4)
+    {
+        append_A(name, m_host_ip4.value());
+    }
+    if (m_host_ip6)
+    {
+        append_AAAA(name, m_host_ip6.value());
+    }
+}
+
+void MDNS_AnswerList::append_NSEC(
+    const name_list_t& name, std::span<const RRType> types)
+{
+    TypeBitmap bitmap;
+    for (const auto type : types)
+    {
+        bitmap.set(type);
+    }
+    write_NSEC(name, bitmap);
+}
+
+void MDNS_AnswerList::append_host_NSEC(const name_list_t& name)
+{
+    TypeBitmap bitmap;
+    if (m_host_ip4)
+    {
+        bitmap.set(RRType::A);
+    }
+    if (m_host_ip6)
+    {
+        bitmap.set(RRType::AAAA);
+    }
+    write_NSEC(name, bitmap);
+}
+
+void MDNS_AnswerList::write_NSEC(
+    const name_list_t& name, const TypeBitmap& types)
+{
+    // a window block can't be empty, e.g. for a host without addresses
+    if (types.length == 0)
+    {
+        return;
+    }
+    if (defer(name, RRType::NSEC,
+            [&](AdditionalRecord& record) { record.types = types; }))
+    {
+        return;
+    }
+
+    // RFC 6762 §6.1: the next domain name is the record's own name and the
+    // bit map has a single window block
+    const uint8_t window_block = 0;
+    const auto rdata_hash =
+        hash_bytes(FNV_OFFSET, types.bits.data(), types.length);
+    append_record(name, RRType::NSEC, rdata_hash, [&](Packet& p) {
+        write_name(p, name);
+        const auto rdlen_pos = put_record_header(
+            p.payload, RRType::NSEC, true, ttl(TTL_HOST_RECORD_SECS));
+        write_name(p, name);
+        p.payload.push_back(window_block);
+        p.payload.push_back(types.length);
+        p.payload.insert(p.payload.end(), types.bits.begin(),
+            types.bits.begin() + types.length);
+        patch_rdlength(p.payload, rdlen_pos);
+    });
+}
+
+} // namespace mdns
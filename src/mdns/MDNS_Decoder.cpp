@@ -0,0 +1,351 @@
+#include <cstring>
+
+#include <netinet/in.h>
+
+#include <mdns/MDNS_HotLog.hpp>
+
+#include "MDNS_Decoder.hpp"
+#include "MDNS_Parse.hpp"
+
+namespace mdns
+{
+namespace
+{
+constexpr uint8_t LABEL_TYPE_MASK = 0b11000000;
+constexpr uint8_t LABEL_TYPE_POINTER = 0b11000000;
+constexpr uint8_t LABEL_TYPE_NORMAL = 0b00000000;
+
+uint16_t load_u16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t load_u32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) |
+        (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+} // anonymous namespace
+
+const uint8_t* MDNS_Decoder::decode_name(const uint8_t* begin,
+    const uint8_t* end, const uint8_t* ptr, name_list_t& name,
+    MDNS_MalformedReason& error)
+{
+    // where the caller continues, set at the first pointer
+    const uint8_t* after = nullptr;
+    // RFC 1035 §4.1.4: pointers refer to a prior occurrence of a name, we
+    // require every jump to land before the previous one so they can't loop
+    const uint8_t* jump_limit = ptr;
+    size_t num_hops = 0;
+    // the terminating root label
+    size_t length = 1;
+
+    name.clear();
+
+    while (true)
+    {
+        if (ptr >= end)
+        {
+            error = MDNS_MalformedReason::TRUNCATED;
+            return nullptr;
+        }
+
+        const uint8_t len = *ptr;
+        if ((len & LABEL_TYPE_MASK) == LABEL_TYPE_POINTER)
+        {
+            if (end - ptr < 2)
+            {
+                error = MDNS_MalformedReason::TRUNCATED;
+                return nullptr;
+            }
+            if (++num_hops > MAX_POINTER_HOPS)
+            {
+                error = MDNS_MalformedReason::TOO_MANY_POINTER_HOPS;
+                return nullptr;
+            }
+
+            const size_t offset = ((len & ~LABEL_TYPE_MASK) << 8) | ptr[1];
+            if (offset >= static_cast<size_t>(jump_limit - begin))
+            {
+                error = MDNS_MalformedReason::BAD_POINTER;
+                return nullptr;
+            }
+
+            if (!after)
+            {
+                after = ptr + 2;
+            }
+            ptr = begin + offset;
+            jump_limit = ptr;
+            continue;
+        }
+
+        if ((len & LABEL_TYPE_MASK) != LABEL_TYPE_NORMAL)
+        {
+            // 01 and 10 are the obsolete extended label types
+            error = MDNS_MalformedReason::BAD_LABEL;
+            return nullptr;
+        }
+
+        if (len == 0)
+        {
+            return after ? after : ptr + 1;
+        }
+
+        length += len + 1;
+        if (length > MAX_NAME_LENGTH)
+        {
+            error = MDNS_MalformedReason::NAME_TOO_LONG;
+            return nullptr;
+        }
+        if (end - ptr - 1 < len)
+        {
+            error = MDNS_MalformedReason::TRUNCATED;
+            return nullptr;
+        }
+
+        // the length checks above are DNSName's, this only fails if they
+        // ever drift apart
+        if (!name.push_back(std::string_view(
+                reinterpret_cast<const char*>(ptr + 1), len)))
+        {
+            error = MDNS_MalformedReason::NAME_TOO_LONG;
+            return nullptr;
+        }
+        ptr += len + 1;
+    }
+}
+
+bool MDNS_Decoder::read_u16(uint16_t& value)
+{
+    if (m_end - m_pos < 2)
+    {
+        return fail(MDNS_MalformedReason::TRUNCATED);
+    }
+    value = load_u16(m_pos);
+    m_pos += 2;
+    return true;
+}
+
+bool MDNS_Decoder::read_u32(uint32_t& value)
+{
+    if (m_end - m_pos < 4)
+    {
+        return fail(MDNS_MalformedReason::TRUNCATED);
+    }
+    value = load_u32(m_pos);
+    m_pos += 4;
+    return true;
+}
+
+bool MDNS_Decoder::read_name(name_list_t& name)
+{
+    MDNS_MalformedReason error = MDNS_MalformedReason::TRUNCATED;
+    const auto* after = decode_name(m_begin, m_end, m_pos, name, error);
+    if (!after)
+    {
+        return fail(error);
+    }
+    m_pos = after;
+    return true;
+}
+
+bool MDNS_Decoder::read_question(QuestionData& question)
+{
+    uint16_t clazz_flags = 0;
+    if (!read_name(question.name_list) || !read_u16(question.type) ||
+        !read_u16(clazz_flags))
+    {
+        return false;
+    }
+
+    // RFC 6762 §5.4: the top bit of the class asks for a unicast response
+    question.clazz = static_cast<MDNS_class>(clazz_flags & 0x7fff);
+    question.question_unicast = (clazz_flags & 0x8000) != 0;
+    return true;
+}
+
+std::optional<ReplyData> MDNS_Decoder::read_record()
+{
+    name_list_t name;
+    uint16_t type = 0;
+    uint16_t clazz_flags = 0;
+    uint32_t ttl = 0;
+    uint16_t rdlen = 0;
+    if (!read_name(name) || !read_u16(type) || !read_u16(clazz_flags) ||
+        !read_u32(ttl) || !read_u16(rdlen))
+    {
+        return std::nullopt;
+    }
+
+    if (m_end - m_pos < rdlen)
+    {
+        fail(MDNS_MalformedReason::RDATA_OVERRUN);
+        return std::nullopt;
+    }
+    const auto* rdata = m_pos;
+    m_pos += rdlen;
+
+    // RFC 6762 §10.2: the top bit of the class is the cache-flush bit
+    ReplyData record(name, type, static_cast<MDNS_class>(clazz_flags & 0x7fff),
+        std::string(reinterpret_cast<const char*>(rdata), rdlen),
+        std::nullopt, std::nullopt, std::nullopt, std::nullopt, ttl);
+    if (!decode_rdata(record, rdata, rdlen))
+    {
+        return std::nullopt;
+    }
+    return record;
+}
+
+bool MDNS_Decoder::decode_rdata(
+    ReplyData& record, const uint8_t* rdata, size_t rdlen)
+{
+    const auto* rdata_end = rdata + rdlen;
+
+    switch (record.get_type())
+    {
+    case RRType::SRV: {
+        // priority, weight and port, then at least the root label
+        if (rdlen < 7)
+        {
+            return fail(MDNS_MalformedReason::BAD_RDATA);
+        }
+
+        SRV_payload srv{ .prio = load_u16(rdata),
+            .weight = load_u16(rdata + 2),
+            .port = load_u16(rdata + 4),
+            .name_list = {} };
+        MDNS_MalformedReason error = MDNS_MalformedReason::BAD_RDATA;
+        // the target may be compressed so may point anywhere before it
+        const auto* after =
+            decode_name(m_begin, m_end, rdata + 6, srv.name_list, error);
+        if (!after)
+        {
+            return fail(error);
+        }
+        if (after > rdata_end)
+        {
+            return fail(MDNS_MalformedReason::BAD_RDATA);
+        }
+        record.SRV = std::move(srv);
+        return true;
+    }
+
+    case RRType::PTR: {
+        name_list_t target;
+        MDNS_MalformedReason error = MDNS_MalformedReason::BAD_RDATA;
+        const auto* after = decode_name(m_begin, m_end, rdata, target, error);
+        if (!after)
+        {
+            return fail(error);
+        }
+        if (after > rdata_end)
+        {
+            return fail(MDNS_MalformedReason::BAD_RDATA);
+        }
+        record.PTR = std::move(target);
+        return true;
+    }
+
+    case RRType::TXT: {
+        // RFC 6763 §6.1: a sequence of length prefixed strings
+        std::map<std::string, std::string> map;
+        const auto* ptr = rdata;
+        while (ptr < rdata_end)
+        {
+            const uint8_t len = *ptr++;
+            if (len == 0)
+            {
+                break;
+            }
+            if (rdata_end - ptr < len)
+            {
+                return fail(MDNS_MalformedReason::BAD_RDATA);
+            }
+
+            std::string s(reinterpret_cast<const char*>(ptr), len);
+            ptr += len;
+            if (const auto eq_sign = s.find('='); eq_sign != std::string::npos)
+            {
+                map[s.substr(0, eq_sign)] = s.substr(eq_sign + 1);
+            }
+            else
+            {
+                map[s] = "";
+            }
+        }
+        record.TXT = std::move(map);
+        return true;
+    }
+
+    case RRType::A: {
+        if (rdlen != sizeof(in_addr))
+        {
+            return fail(MDNS_MalformedReason::BAD_RDATA);
+        }
+        in_addr sa;
+        memcpy(&sa, rdata, sizeof(sa));
+        record.A = iuring::IPAddress(sa, iuring::SocketPortID::UNKNOWN);
+        return true;
+    }
+
+    case RRType::AAAA: {
+        if (rdlen != sizeof(in6_addr))
+        {
+            return fail(MDNS_MalformedReason::BAD_RDATA);
+        }
+        in6_addr sa6;
+        memcpy(&sa6, rdata, sizeof(sa6));
+        record.A = iuring::IPAddress(sa6, iuring::SocketPortID::UNKNOWN);
+        return true;
+    }
+
+    default:
+        return true;
+    }
+}
+
+const char* MDNS_Decoder::to_string(MDNS_MalformedReason reason)
+{
+    switch (reason)
+    {
+    case MDNS_MalformedReason::HEADER_TOO_SHORT:
+        return "header too short";
+    case MDNS_MalformedReason::TRUNCATED:
+        return "truncated";
+    case MDNS_MalformedReason::BAD_LABEL:
+        return "bad label";
+    case MDNS_MalformedReason::NAME_TOO_LONG:
+        return "name too long";
+    case MDNS_MalformedReason::BAD_POINTER:
+        return "bad compression pointer";
+    case MDNS_MalformedReason::TOO_MANY_POINTER_HOPS:
+        return "too many compression pointers";
+    case MDNS_MalformedReason::RDATA_OVERRUN:
+        return "rdata runs past the packet";
+    case MDNS_MalformedReason::BAD_RDATA:
+        return "bad rdata";
+    case MDNS_MalformedReason::NUM_REASONS:
+        break;
+    }
+    return "unknown";
+}
+
+const uint8_t* extract_name(const uint8_t* start_of_packet,
+    const uint8_t* end_of_packet, name_list_t& name_list,
+    const uint8_t* ptr, logging::ILogger& logger)
+{
+    MDNS_MalformedReason error = MDNS_MalformedReason::TRUNCATED;
+    const auto* after = MDNS_Decoder::decode_name(
+        start_of_packet, end_of_packet, ptr, name_list, error);
+    if (!after)
+    {
+        MDNS_HOT_LOG_ERROR(logger, "MDNS name extraction: {} at offset {}",
+            MDNS_Decoder::to_string(error), ptr - start_of_packet);
+    }
+    return after;
+}
+
+} // namespace mdns
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <mdns/IMDNS_Handler.hpp>
+#include <mdns/MDNS_Metrics.hpp>
+#include <mdns/QuestionData.hpp>
+
+namespace mdns
+{
+/** @brief bounds checked reader for received mdns packets.
+ *
+ * Every fixed size field is checked against the end of the packet and
+ * RDLENGTH against what is left of it. A name follows at most
+ * MAX_POINTER_HOPS compression pointers, each of which has to point before
+ * the one that led to it, and decodes to at most MAX_NAME_LENGTH bytes. A
+ * question or record takes at least 5 bytes of the packet and a bounded
+ * amount of work, so decoding a packet is O(its size) whatever it contains
+ * (fuzz/fuzz_mdns_decoder.cpp checks the cycles per byte).
+ */
+class MDNS_Decoder
+{
+public:
+    static constexpr size_t MAX_LABEL_LENGTH = DNSName::MAX_LABEL_LENGTH;
+    static constexpr size_t MAX_NAME_LENGTH = DNSName::MAX_WIRE_LENGTH;
+
+    // a legitimate name needs one pointer, a few for nested compression
+    static constexpr size_t MAX_POINTER_HOPS = 16;
+
+    /** @param pos where decoding starts, usually right after the header
+     */
+    MDNS_Decoder(const uint8_t* begin, const uint8_t* end, const uint8_t* pos)
+        : m_begin(begin)
+        , m_end(end)
+        , m_pos(pos)
+    {
+    }
+
+    bool read_u16(uint16_t& value);
+    bool read_u32(uint32_t& value);
+
+    /** @brief replaces the contents of name
+     */
+    bool read_name(name_list_t& name);
+
+    bool read_question(QuestionData& question);
+
+    /** @brief a resource record with its RDATA decoded for SRV, TXT, A,
+     * AAAA and PTR
+     */
+    std::optional<ReplyData> read_record();
+
+    const uint8_t* get_position() const
+    {
+        return m_pos;
+    }
+
+    /** @return why the first failed read failed
+     */
+    MDNS_MalformedReason get_error() const
+    {
+        return m_error.value_or(MDNS_MalformedReason::TRUNCATED);
+    }
+
+    /** @brief decodes the name at ptr into name (as read_name()) without
+     * moving any cursor
+     * @return the first byte after the name as stored at ptr or nullptr
+     */
+    static const uint8_t* decode_name(const uint8_t* begin, const uint8_t* end,
+        const uint8_t* ptr, name_list_t& name, MDNS_MalformedReason& error);
+
+    static const char* to_string(MDNS_MalformedReason reason);
+
+private:
+    const uint8_t* const m_begin;
+    const uint8_t* const m_end;
+    const uint8_t* m_pos;
+    std::optional<MDNS_MalformedReason> m_error;
+
+    bool fail(MDNS_MalformedReason reason)
+    {
+        if (!m_error)
+        {
+            m_error = reason;
+        }
+        return false;
+    }
+
+    bool decode_rdata(ReplyData& record, const uint8_t* rdata, size_t rdlen);
+};
+
+} // namespace mdns
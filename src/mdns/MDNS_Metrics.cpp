@@ -0,0 +1,242 @@
+#include <format>
+#include <iterator>
+
+#include <mdns/MDNS_Metrics.hpp>
+
+namespace mdns
+{
+namespace
+{
+template <size_t N>
+void copy_counters(std::array<uint64_t, N>& dst,
+    const std::array<std::atomic<uint64_t>, N>& src)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        dst[i] = src[i].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t load(const std::atomic<uint64_t>& counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+constexpr std::array<const char*, MDNS_MetricsSnapshot::NUM_MESSAGE_TYPES>
+    message_type_names{ "query", "reply" };
+
+constexpr std::array<const char*,
+    static_cast<size_t>(MDNS_MalformedReason::NUM_REASONS)>
+    malformed_reason_names{ "header_too_short", "truncated", "bad_label",
+        "name_too_long", "bad_pointer", "too_many_pointer_hops",
+        "rdata_overrun", "bad_rdata" };
+
+void write_type(std::string& out, const char* name, const char* type,
+    const char* help)
+{
+    std::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n",
+        name, help, name, type);
+}
+
+void write_value(std::string& out, const char* name, uint64_t value)
+{
+    std::format_to(std::back_inserter(out), "{} {}\n", name, value);
+}
+
+template <size_t N>
+void write_per_message_type(std::string& out, const char* name,
+    const char* help, const std::array<uint64_t, N>& values)
+{
+    write_type(out, name, "counter", help);
+    for (size_t i = 0; i < N; i++)
+    {
+        std::format_to(std::back_inserter(out), "{}{{type=\"{}\"}} {}\n", name,
+            message_type_names[i], values[i]);
+    }
+}
+
+} // anonymous namespace
+
+void MDNS_Metrics::record_latency(std::chrono::nanoseconds latency)
+{
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS.size() && latency > LATENCY_BUCKETS[bucket])
+    {
+        bucket++;
+    }
+    add(latency_buckets[bucket]);
+    add(latency_sum_ns, latency.count());
+    add(latency_count);
+}
+
+MDNS_MetricsSnapshot MDNS_Metrics::snapshot() const
+{
+    MDNS_MetricsSnapshot ret;
+    copy_counters(ret.packets_in, packets_in);
+    copy_counters(ret.bytes_in, bytes_in);
+    copy_counters(ret.packets_out, packets_out);
+    copy_counters(ret.bytes_out, bytes_out);
+    ret.records_out = load(records_out);
+
+    copy_counters(ret.questions, questions);
+    ret.unanswered_questions = load(unanswered_questions);
+
+    copy_counters(ret.handler_hits, handler_hits);
+    copy_counters(ret.handler_misses, handler_misses);
+    ret.registry_hits = load(registry_hits);
+    ret.registry_misses = load(registry_misses);
+
+    copy_counters(ret.malformed, malformed);
+
+    ret.suppressed_records = load(suppressed_records);
+    ret.dropped_queries = load(dropped_queries);
+    ret.dropped_questions = load(dropped_questions);
+    ret.dropped_datagrams = load(dropped_datagrams);
+    ret.deferred_batches = load(deferred_batches);
+    ret.budget_overruns = load(budget_overruns);
+    ret.paced_packets = load(paced_packets);
+    ret.coalesced_packets = load(coalesced_packets);
+    ret.paced_drops = load(paced_drops);
+
+    ret.cache_entries = load(cache_entries);
+    ret.cache_evictions = load(cache_evictions);
+
+    copy_counters(ret.latency_buckets, latency_buckets);
+    ret.latency_sum_ns = load(latency_sum_ns);
+    ret.latency_count = load(latency_count);
+    return ret;
+}
+
+std::string to_prometheus_text(const MDNS_MetricsSnapshot& m)
+{
+    std::string out;
+
+    write_per_message_type(out, "mdns_packets_in_total",
+        "mdns packets received", m.packets_in);
+    write_per_message_type(
+        out, "mdns_bytes_in_total", "mdns bytes received", m.bytes_in);
+    write_per_message_type(
+        out, "mdns_packets_out_total", "mdns packets sent", m.packets_out);
+    write_per_message_type(
+        out, "mdns_bytes_out_total", "mdns bytes sent", m.bytes_out);
+
+    write_type(out, "mdns_records_out_total", "counter",
+        "resource records sent");
+    write_value(out, "mdns_records_out_total", m.records_out);
+
+    write_type(out, "mdns_questions_total", "counter",
+        "questions received per qtype");
+    for (size_t i = 0; i < m.questions.size(); i++)
+    {
+        if (m.questions[i] == 0)
+        {
+            continue;
+        }
+        if (i == m.questions.size() - 1)
+        {
+            std::format_to(std::back_inserter(out),
+                "mdns_questions_total{{qtype=\"other\"}} {}\n", m.questions[i]);
+        }
+        else
+        {
+            std::format_to(std::back_inserter(out),
+                "mdns_questions_total{{qtype=\"{}\"}} {}\n", i, m.questions[i]);
+        }
+    }
+
+    write_type(out, "mdns_unanswered_questions_total", "counter",
+        "questions no handler answered");
+    write_value(
+        out, "mdns_unanswered_questions_total", m.unanswered_questions);
+
+    write_type(out, "mdns_handler_questions_total", "counter",
+        "questions offered to each handler");
+    for (size_t i = 0; i < m.handler_hits.size(); i++)
+    {
+        if (m.handler_hits[i] == 0 && m.handler_misses[i] == 0)
+        {
+            continue;
+        }
+        std::format_to(std::back_inserter(out),
+            "mdns_handler_questions_total{{handler=\"{}\",result=\"hit\"}} "
+            "{}\n"
+            "mdns_handler_questions_total{{handler=\"{}\",result=\"miss\"}} "
+            "{}\n",
+            i, m.handler_hits[i], i, m.handler_misses[i]);
+    }
+    std::format_to(std::back_inserter(out),
+        "mdns_handler_questions_total{{handler=\"registry\",result=\"hit\"}} "
+        "{}\n"
+        "mdns_handler_questions_total{{handler=\"registry\",result=\"miss\"}} "
+        "{}\n",
+        m.registry_hits, m.registry_misses);
+
+    write_type(out, "mdns_malformed_packets_total", "counter",
+        "packets rejected by the parser");
+    for (size_t i = 0; i < m.malformed.size(); i++)
+    {
+        std::format_to(std::back_inserter(out),
+            "mdns_malformed_packets_total{{reason=\"{}\"}} {}\n",
+            malformed_reason_names[i], m.malformed[i]);
+    }
+
+    write_type(out, "mdns_suppressed_records_total", "counter",
+        "records held back by the 1s multicast rate limit");
+    write_value(out, "mdns_suppressed_records_total", m.suppressed_records);
+    write_type(out, "mdns_dropped_queries_total", "counter",
+        "queries dropped because the pending ring was full");
+    write_value(out, "mdns_dropped_queries_total", m.dropped_queries);
+    write_type(out, "mdns_dropped_questions_total", "counter",
+        "questions past the per-query limit left unanswered");
+    write_value(out, "mdns_dropped_questions_total", m.dropped_questions);
+    write_type(out, "mdns_dropped_datagrams_total", "counter",
+        "datagrams dropped between the realtime and the worker thread");
+    write_value(out, "mdns_dropped_datagrams_total", m.dropped_datagrams);
+    write_type(out, "mdns_deferred_batches_total", "counter",
+        "query batches deferred to a later tick");
+    write_value(out, "mdns_deferred_batches_total", m.deferred_batches);
+    write_type(out, "mdns_budget_overruns_total", "counter",
+        "ticks that used more than the query budget");
+    write_value(out, "mdns_budget_overruns_total", m.budget_overruns);
+    write_type(out, "mdns_paced_packets_total", "counter",
+        "packets held back by the egress limit");
+    write_value(out, "mdns_paced_packets_total", m.paced_packets);
+    write_type(out, "mdns_coalesced_packets_total", "counter",
+        "packets not sent as they were already waiting for the egress limit");
+    write_value(out, "mdns_coalesced_packets_total", m.coalesced_packets);
+    write_type(out, "mdns_paced_drops_total", "counter",
+        "packets dropped waiting for the egress limit");
+    write_value(out, "mdns_paced_drops_total", m.paced_drops);
+
+    write_type(out, "mdns_cache_entries", "gauge",
+        "entries in the rate limiter table");
+    write_value(out, "mdns_cache_entries", m.cache_entries);
+    write_type(out, "mdns_cache_evictions_total", "counter",
+        "rate limiter entries replaced within their interval");
+    write_value(out, "mdns_cache_evictions_total", m.cache_evictions);
+
+    write_type(out, "mdns_response_latency_seconds", "histogram",
+        "time from receiving a query to sending its answer");
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < MDNS_MetricsSnapshot::LATENCY_BUCKETS.size(); i++)
+    {
+        cumulative += m.latency_buckets[i];
+        std::format_to(std::back_inserter(out),
+            "mdns_response_latency_seconds_bucket{{le=\"{}\"}} {}\n",
+            std::chrono::duration<double>(
+                MDNS_MetricsSnapshot::LATENCY_BUCKETS[i])
+                .count(),
+            cumulative);
+    }
+    cumulative += m.latency_buckets.back();
+    std::format_to(std::back_inserter(out),
+        "mdns_response_latency_seconds_bucket{{le=\"+Inf\"}} {}\n"
+        "mdns_response_latency_seconds_sum {}\n"
+        "mdns_response_latency_seconds_count {}\n",
+        cumulative, static_cast<double>(m.latency_sum_ns) / 1e9,
+        m.latency_count);
+
+    return out;
+}
+
+} // namespace mdns
@@ -1,58 +1,88 @@
+#include <array>
+#include <cassert>
 #include <expected>
 
 #include <slogger/ILogger.hpp>
 
+#include <mdns/MDNS_HotLog.hpp>
+
 #include "mdns/MDNS_NMOS_HTTP_Handler.hpp"
 #include "mdns/MDNS_Service.hpp"
 
 namespace mdns
 {
+constexpr const auto& nmos_node_service_name =
+    mdns_name<"_nmos-node._tcp.local">;
+
+// what the node instance name has, for its NSEC
+constexpr std::array nmos_instance_types{ RRType::TXT, RRType::SRV };
+
 std::string toString_8bit(uint8_t v)
 {
     return std::format("{}", v);
 }
 
+void MDNS_NMOS_HTTP_Handler::render_txt_records()
+{
+    // the AMWA IS-04 node advertisement keys, ver_* wrap at 255
+    m_txt_strings = {
+        "api_proto=http",
+        "api_ver=v1.3",
+        "api_auth=false",
+        "ver_slf=" + toString_8bit(m_nmos_service.num_self()),
+        "ver_src=" + toString_8bit(m_nmos_service.num_source()),
+        "ver_flw=" + toString_8bit(m_nmos_service.num_flows()),
+        "ver_dvc=" + toString_8bit(m_nmos_service.num_devices()),
+        "ver_snd=" + toString_8bit(m_nmos_service.num_senders()),
+        "ver_rcv=" + toString_8bit(m_nmos_service.num_receivers()),
+    };
+}
+
+void MDNS_NMOS_HTTP_Handler::append_records(IAnswerList& answer)
+{
+    answer.append_PTR(nmos_node_service_name, m_instance_name);
+    answer.append_SRV(m_instance_name, m_hostname, m_port);
+    answer.append_TXT(m_instance_name, m_txt_strings);
+    answer.append_host_addresses(m_hostname);
+}
+
+void MDNS_NMOS_HTTP_Handler::append_announcement(IAnswerList& answer)
+{
+    append_records(answer);
+}
+
 MDNS_IsHandled MDNS_NMOS_HTTP_Handler::handle_question(
-    const QuestionData& q, [[maybe_unused]] IAnswerList& answer)
+    const QuestionData& q, IAnswerList& answer)
 {
     /*
     _nmos-node._tcp: A logical host which advertises a Node API.
     _nmos-registration._tcp A logical host which advertises a Registration API.
     _nmos-query._tcp A logical host which advertises a Query API.
     */
-    if (q.equals(std::vector<std::string>{ "_nmos-node", "_tcp", "local" }))
+    // the answer list picks what the question asks for out of the records
+    if (q.equals(nmos_node_service_name) || q.equals(m_instance_name) ||
+        q.equals(m_hostname))
     {
-        LOG_INFO(get_logger(),
-            "MDNS_NMOS_HTTP_Handler handling nmos node "
-            "query????????????????????");
-        answer.append_TXT(create_list("api_proto"), "http");
-        answer.append_TXT(create_list("api_var"), "v1.3");
-        answer.append_TXT(create_list("api_auth"), "false");
-
-        answer.append_TXT(
-            create_list("ver_slf"), toString_8bit(m_nmos_service.num_self()));
-        answer.append_TXT(
-            create_list("ver_src"), toString_8bit(m_nmos_service.num_source()));
-        answer.append_TXT(
-            create_list("ver_flw"), toString_8bit(m_nmos_service.num_flows()));
-        answer.append_TXT(create_list("ver_dvc"),
-            toString_8bit(m_nmos_service.num_devices()));
-        answer.append_TXT(create_list("ver_snd"),
-            toString_8bit(m_nmos_service.num_senders()));
-        answer.append_TXT(create_list("ver_rcv"),
-            toString_8bit(m_nmos_service.num_receivers()));
+        MDNS_HOT_LOG_DEBUG(
+            get_logger(), "MDNS_NMOS_HTTP_Handler handling nmos node query");
+        append_records(answer);
+
+        // the instance and host names are ours alone, so a question for a
+        // type they don't have gets a negative answer (RFC 6762 §6.1)
+        answer.append_NSEC(m_instance_name, nmos_instance_types);
+        answer.append_host_NSEC(m_hostname);
         return MDNS_IsHandled::IS_HANDLED;
     }
 
-    if (q.equals(std::vector<std::string>{ "_nmos-register", "_tcp", "local" }))
+    if (q.equals(mdns_name<"_nmos-register._tcp.local">))
     {
-        LOG_INFO(get_logger(),
+        MDNS_HOT_LOG_DEBUG(get_logger(),
             "MDNS_NMOS_HTTP_Handler handling nmos registration query");
         return MDNS_IsHandled::IS_HANDLED;
     }
-    if (q.equals(std::vector<std::string>{ "_nmos-query", "_tcp", "local" }))
+    if (q.equals(mdns_name<"_nmos-query._tcp.local">))
     {
-        LOG_INFO(
+        MDNS_HOT_LOG_DEBUG(
             get_logger(), "MDNS_NMOS_HTTP_Handler handling nmos query query");
         return MDNS_IsHandled::IS_HANDLED;
     }
@@ -69,18 +99,19 @@ std::optional<iuring::IPAddress> MDNS_NMOS_HTTP_Handler::resolve_dns_request(
         return std::nullopt;
     }
     std::string hostname;
-    if (StringUtils::last_item_equals(name_list, "local"))
+    if (name_list.back() == "local")
     {
-        hostname =
-            StringUtils::to_string(name_list.begin(), name_list.end() - 1, ".");
+        auto without_domain = name_list;
+        without_domain.pop_back();
+        hostname = without_domain.to_string();
     }
     else
     {
-        hostname = StringUtils::to_string(name_list, ".");
+        hostname = name_list.to_string();
     }
 
     LOG_INFO(get_logger(), "resolving hostname {} from name list: {}", hostname,
-        StringUtils::to_string(name_list));
+        name_list.to_string());
 
     get_io()->resolve_hostname(hostname,
         [this, hostname](std::expected<std::vector<iuring::IPAddress>, error::Error>
@@ -119,16 +150,14 @@ MDNS_IsHandled MDNS_NMOS_HTTP_Handler::handle_reply(
     bool found = false;
     for (auto reply : replies)
     {
-        if (reply.equals(std::vector<std::string>{
-                "*", "_nmos-registration", "_tcp", "local" }))
+        if (reply.equals(mdns_name<"*._nmos-registration._tcp.local">))
         {
             LOG_INFO(get_logger(),
                 "RECOGNIZED - going to contact server for registration!");
             found = true;
         }
 
-        if (reply.equals(std::vector<std::string>{
-                "*", "_nmos-register", "_tcp", "local" }))
+        if (reply.equals(mdns_name<"*._nmos-register._tcp.local">))
         {
             LOG_INFO(get_logger(),
                 "RECOGNIZED - going to contact server for registration!");
@@ -171,7 +200,7 @@ MDNS_IsHandled MDNS_NMOS_HTTP_Handler::handle_reply(
             if (reply.PTR.has_value())
             {
                 LOG_INFO(get_logger(), "service in PTR: {}",
-                    StringUtils::to_string(reply.PTR.value()));
+                    reply.PTR.value().to_string());
             }
             else
             {
@@ -185,7 +214,7 @@ MDNS_IsHandled MDNS_NMOS_HTTP_Handler::handle_reply(
             port_of_registration_server = reply.SRV->port;
             LOG_INFO(get_logger(), "PORT OF SERVER AT {}, namelist: {}",
                 port_of_registration_server.value(),
-                StringUtils::to_string(reply.SRV->name_list));
+                reply.SRV->name_list.to_string());
 
             if (!ip_address_of_nmos_registration_server)
             {
@@ -225,7 +254,7 @@ MDNS_IsHandled MDNS_NMOS_HTTP_Handler::handle_reply(
         {
             LOG_INFO(get_logger(),
                 "need to resolve registration server name: {}",
-                StringUtils::to_string(registration_srv_name.value()));
+                registration_srv_name.value().to_string());
             ip_address_of_nmos_registration_server =
                 resolve_dns_request(registration_srv_name.value());
         }
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#include <mdns/DNSName.hpp>
+#include <slogger/ILogger.hpp>
+
+namespace mdns
+{
+/** @brief decodes the (possibly compressed) name at ptr into name_list,
+ * replacing its contents
+ * @return the first byte after the name or nullptr when it is malformed
+ */
+const uint8_t* extract_name(const uint8_t* start_of_packet,
+    const uint8_t* end_of_packet, name_list_t& name_list,
+    const uint8_t* ptr, logging::ILogger& logger);
+
+} // namespace mdns
@@ -0,0 +1,607 @@
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <thread>
+
+#include <mdns/MDNS_Pcap.hpp>
+
+namespace mdns
+{
+namespace
+{
+constexpr uint32_t PCAP_MAGIC_USEC = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NSEC = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 6;
+constexpr uint16_t PCAPNG_OPTION_TSRESOL = 9;
+
+constexpr size_t PCAP_FILE_HEADER_SIZE = 24;
+constexpr size_t PCAP_RECORD_HEADER_SIZE = 16;
+
+// sanity limit for a single record/block
+constexpr size_t MAX_RECORD_SIZE = 256 * 1024;
+
+constexpr uint16_t LINKTYPE_ETHERNET = 1;
+constexpr uint16_t LINKTYPE_RAW = 101;
+constexpr uint16_t LINKTYPE_LINUX_SLL = 113;
+constexpr uint16_t LINKTYPE_IPV4 = 228;
+constexpr uint16_t LINKTYPE_IPV6 = 229;
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86dd;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+
+constexpr uint8_t IPPROTO_UDP_ID = 17;
+constexpr uint16_t MDNS_UDP_PORT = 5353;
+
+constexpr size_t IPV4_HEADER_SIZE = 20;
+constexpr size_t IPV6_HEADER_SIZE = 40;
+constexpr size_t UDP_HEADER_SIZE = 8;
+
+uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+void put_be16(std::vector<uint8_t>& out, uint16_t v)
+{
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+template <typename T> void put_native(std::vector<uint8_t>& out, T v)
+{
+    const auto* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + sizeof(v));
+}
+
+uint16_t ipv4_header_checksum(const uint8_t* hdr)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < IPV4_HEADER_SIZE; i += 2)
+    {
+        sum += load_be16(hdr + i);
+    }
+    while (sum >> 16)
+    {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+std::optional<iuring::IPAddress> to_ip_address(int family, const void* addr)
+{
+    char buf[INET6_ADDRSTRLEN];
+    if (!inet_ntop(family, addr, buf, sizeof(buf)))
+    {
+        return std::nullopt;
+    }
+    return iuring::IPAddress::parse(buf);
+}
+
+} // anonymous namespace
+
+std::unique_ptr<MDNS_PcapWriter> MDNS_PcapWriter::create(
+    const std::string& path, logging::ILogger& logger)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        LOG_ERROR(logger, "MDNS: failed to create capture file {}", path);
+        return nullptr;
+    }
+
+    std::vector<uint8_t> hdr;
+    put_native<uint32_t>(hdr, PCAP_MAGIC_NSEC);
+    put_native<uint16_t>(hdr, 2);
+    put_native<uint16_t>(hdr, 4);
+    put_native<int32_t>(hdr, 0);
+    put_native<uint32_t>(hdr, 0);
+    put_native<uint32_t>(hdr, 65535);
+    put_native<uint32_t>(hdr, LINKTYPE_RAW);
+    file.write(reinterpret_cast<const char*>(hdr.data()), hdr.size());
+
+    auto writer = std::unique_ptr<MDNS_PcapWriter>(
+        new MDNS_PcapWriter(std::move(file), logger));
+    writer->m_thread = std::jthread(
+        [w = writer.get()](std::stop_token stop) { w->run(stop); });
+    return writer;
+}
+
+MDNS_PcapWriter::~MDNS_PcapWriter()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    // the thread writes what is left before it exits
+    m_thread.request_stop();
+    m_signal.fetch_add(1);
+    m_signal.notify_one();
+    m_thread.join();
+}
+
+bool MDNS_PcapWriter::write(const iuring::ReceivedMessage& data,
+    const iuring::IPAddress& destination,
+    std::chrono::system_clock::time_point when)
+{
+    auto* d = m_ring->acquire();
+    if (!d || data.get_size() > MAX_DATAGRAM_SIZE)
+    {
+        m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    memcpy(d->data.data(), data.begin(), data.get_size());
+    d->size = data.get_size();
+    d->source = data.get_source_address();
+    d->source_port =
+        static_cast<uint16_t>(data.get_source_address().get_port());
+    d->destination = destination;
+    d->when = when;
+    m_ring->commit();
+    m_num_queued.fetch_add(1, std::memory_order_release);
+
+    // only pay for the futex wake when the writer is actually asleep
+    m_signal.fetch_add(1);
+    if (m_waiting.load())
+    {
+        m_signal.notify_one();
+    }
+    return true;
+}
+
+void MDNS_PcapWriter::flush()
+{
+    const auto num_queued = m_num_queued.load(std::memory_order_acquire);
+    for (auto num_flushed = m_num_flushed.load(std::memory_order_acquire);
+        num_flushed < num_queued;
+        num_flushed = m_num_flushed.load(std::memory_order_acquire))
+    {
+        m_num_flushed.wait(num_flushed);
+    }
+}
+
+void MDNS_PcapWriter::run(std::stop_token stop)
+{
+    uint64_t num_done = 0;
+    while (true)
+    {
+        const auto signal = m_signal.load();
+
+        while (const auto* d = m_ring->front())
+        {
+            write_record(*d);
+            m_ring->pop();
+            num_done++;
+        }
+
+        // caught up, hand what we have to the kernel
+        if (num_done != m_num_flushed.load(std::memory_order_relaxed))
+        {
+            m_file.flush();
+            m_num_flushed.store(num_done, std::memory_order_release);
+            m_num_flushed.notify_all();
+        }
+
+        if (stop.stop_requested())
+        {
+            return;
+        }
+
+        m_waiting.store(true);
+        if (m_ring->empty() && !stop.stop_requested())
+        {
+            m_signal.wait(signal);
+        }
+        m_waiting.store(false);
+    }
+}
+
+void MDNS_PcapWriter::write_record(const Datagram& d)
+{
+    const auto src = d.source->to_human_readable_ip_string();
+    const auto dst = d.destination->to_human_readable_ip_string();
+
+    // synthesised IP + UDP headers
+    m_record.clear();
+    const auto udp_size = UDP_HEADER_SIZE + d.size;
+    in_addr src4, dst4;
+    in6_addr src6, dst6;
+    if (inet_pton(AF_INET, src.c_str(), &src4) == 1 &&
+        inet_pton(AF_INET, dst.c_str(), &dst4) == 1)
+    {
+        put_be16(m_record, 0x4500);
+        put_be16(
+            m_record, static_cast<uint16_t>(IPV4_HEADER_SIZE + udp_size));
+        put_be16(m_record, 0);
+        put_be16(m_record, 0x4000); // don't fragment
+        m_record.push_back(255);
+        m_record.push_back(IPPROTO_UDP_ID);
+        put_be16(m_record, 0);
+        put_native(m_record, src4);
+        put_native(m_record, dst4);
+
+        const auto checksum = ipv4_header_checksum(m_record.data());
+        m_record[10] = static_cast<uint8_t>(checksum >> 8);
+        m_record[11] = static_cast<uint8_t>(checksum);
+    }
+    else if (inet_pton(AF_INET6, src.c_str(), &src6) == 1 &&
+        inet_pton(AF_INET6, dst.c_str(), &dst6) == 1)
+    {
+        put_be16(m_record, 0x6000);
+        put_be16(m_record, 0);
+        put_be16(m_record, static_cast<uint16_t>(udp_size));
+        m_record.push_back(IPPROTO_UDP_ID);
+        m_record.push_back(255);
+        put_native(m_record, src6);
+        put_native(m_record, dst6);
+    }
+    else
+    {
+        LOG_ERROR(m_logger, "MDNS: can't capture datagram from {} to {}", src,
+            dst);
+        return;
+    }
+
+    put_be16(m_record, d.source_port);
+    put_be16(m_record, MDNS_UDP_PORT);
+    put_be16(m_record, static_cast<uint16_t>(udp_size));
+    put_be16(m_record, 0); // no checksum
+    m_record.insert(m_record.end(), d.data.begin(), d.data.begin() + d.size);
+
+    const auto since_epoch =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            d.when.time_since_epoch());
+    const auto secs =
+        std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+
+    std::vector<uint8_t> rec_hdr;
+    put_native<uint32_t>(rec_hdr, static_cast<uint32_t>(secs.count()));
+    put_native<uint32_t>(
+        rec_hdr, static_cast<uint32_t>((since_epoch - secs).count()));
+    put_native<uint32_t>(rec_hdr, static_cast<uint32_t>(m_record.size()));
+    put_native<uint32_t>(rec_hdr, static_cast<uint32_t>(m_record.size()));
+
+    m_file.write(
+        reinterpret_cast<const char*>(rec_hdr.data()), rec_hdr.size());
+    m_file.write(
+        reinterpret_cast<const char*>(m_record.data()), m_record.size());
+    m_num_written.fetch_add(1, std::memory_order_release);
+}
+
+std::unique_ptr<MDNS_PcapReader> MDNS_PcapReader::open(
+    const std::string& path, logging::ILogger& logger)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        LOG_ERROR(logger, "MDNS: failed to open capture file {}", path);
+        return nullptr;
+    }
+
+    auto reader = std::unique_ptr<MDNS_PcapReader>(
+        new MDNS_PcapReader(std::move(file), logger));
+    if (!reader->read_header())
+    {
+        LOG_ERROR(logger, "MDNS: {} is not a pcap or pcapng file", path);
+        return nullptr;
+    }
+    return reader;
+}
+
+bool MDNS_PcapReader::read_block(size_t size)
+{
+    if (size > MAX_RECORD_SIZE)
+    {
+        return false;
+    }
+    m_block.resize(size);
+    return static_cast<bool>(
+        m_file.read(reinterpret_cast<char*>(m_block.data()), size));
+}
+
+uint16_t MDNS_PcapReader::get16(const uint8_t* p) const
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return m_swapped ? __builtin_bswap16(v) : v;
+}
+
+uint32_t MDNS_PcapReader::get32(const uint8_t* p) const
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return m_swapped ? __builtin_bswap32(v) : v;
+}
+
+bool MDNS_PcapReader::read_header()
+{
+    if (!read_block(sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, m_block.data(), sizeof(magic));
+
+    if (magic == PCAPNG_SECTION_HEADER)
+    {
+        // block length + byte order magic
+        m_format = Format::PCAPNG;
+        if (!read_block(2 * sizeof(uint32_t)))
+        {
+            return false;
+        }
+        uint32_t bom;
+        memcpy(&bom, m_block.data() + 4, sizeof(bom));
+        m_swapped = bom != PCAPNG_BYTE_ORDER_MAGIC;
+        if (m_swapped && __builtin_bswap32(bom) != PCAPNG_BYTE_ORDER_MAGIC)
+        {
+            return false;
+        }
+
+        // skip the rest of the section header
+        const auto block_len = get32(m_block.data());
+        return block_len >= 12 && read_block(block_len - 12);
+    }
+
+    uint64_t ticks_per_second = 0;
+    for (const bool swapped : { false, true })
+    {
+        const auto m = swapped ? __builtin_bswap32(magic) : magic;
+        if (m == PCAP_MAGIC_USEC || m == PCAP_MAGIC_NSEC)
+        {
+            m_swapped = swapped;
+            ticks_per_second = m == PCAP_MAGIC_NSEC ? 1000000000 : 1000000;
+        }
+    }
+    if (ticks_per_second == 0 ||
+        !read_block(PCAP_FILE_HEADER_SIZE - sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    m_format = Format::PCAP;
+    m_interfaces.push_back(Interface{
+        .link_type = static_cast<uint16_t>(get32(m_block.data() + 16)),
+        .ticks_per_second = ticks_per_second });
+    return true;
+}
+
+std::optional<MDNS_CapturedDatagram> MDNS_PcapReader::next()
+{
+    return m_format == Format::PCAP ? next_pcap_record() : next_pcapng_block();
+}
+
+std::optional<MDNS_CapturedDatagram> MDNS_PcapReader::next_pcap_record()
+{
+    const auto& iface = m_interfaces.front();
+    while (read_block(PCAP_RECORD_HEADER_SIZE))
+    {
+        const auto secs = get32(m_block.data());
+        const auto frac = get32(m_block.data() + 4);
+        const auto incl_len = get32(m_block.data() + 8);
+        if (!read_block(incl_len))
+        {
+            break;
+        }
+
+        const auto timestamp = std::chrono::seconds(secs) +
+            std::chrono::nanoseconds(
+                frac * (1000000000 / iface.ticks_per_second));
+        if (auto d = decode(
+                iface.link_type, timestamp, m_block.data(), m_block.size()))
+        {
+            return d;
+        }
+    }
+    return std::nullopt;
+}
+
+void MDNS_PcapReader::read_interface_block()
+{
+    Interface iface{ .link_type = get16(m_block.data()),
+        .ticks_per_second = 1000000 };
+
+    // options follow link type, reserved and snaplen
+    size_t pos = 8;
+    while (pos + 4 <= m_block.size())
+    {
+        const auto code = get16(m_block.data() + pos);
+        const auto len = get16(m_block.data() + pos + 2);
+        pos += 4;
+        if (code == 0 || pos + len > m_block.size())
+        {
+            break;
+        }
+        if (code == PCAPNG_OPTION_TSRESOL && len >= 1)
+        {
+            const auto resol = m_block[pos];
+            const auto exp = resol & 0x7f;
+            uint64_t ticks = 1;
+            for (int i = 0; i < exp && ticks < 1000000000000000000ULL; i++)
+            {
+                ticks *= (resol & 0x80) ? 2 : 10;
+            }
+            iface.ticks_per_second = ticks;
+        }
+        pos += (len + 3) & ~size_t(3);
+    }
+    m_interfaces.push_back(iface);
+}
+
+std::optional<MDNS_CapturedDatagram> MDNS_PcapReader::next_pcapng_block()
+{
+    while (read_block(2 * sizeof(uint32_t)))
+    {
+        const auto type = get32(m_block.data());
+        const auto len = get32(m_block.data() + 4);
+        if (len < 12 || !read_block(len - 8))
+        {
+            break;
+        }
+        // body without the trailing length
+        m_block.resize(m_block.size() - sizeof(uint32_t));
+
+        if (type == PCAPNG_SECTION_HEADER)
+        {
+            // a new section restarts the interface numbering
+            m_interfaces.clear();
+            continue;
+        }
+        if (type == PCAPNG_INTERFACE_DESCRIPTION && m_block.size() >= 8)
+        {
+            read_interface_block();
+            continue;
+        }
+        if (type != PCAPNG_ENHANCED_PACKET || m_block.size() < 20)
+        {
+            continue;
+        }
+
+        const auto iface_id = get32(m_block.data());
+        const auto cap_len = get32(m_block.data() + 12);
+        if (iface_id >= m_interfaces.size() || 20 + cap_len > m_block.size())
+        {
+            m_num_skipped++;
+            continue;
+        }
+        const auto& iface = m_interfaces[iface_id];
+
+        const uint64_t ticks =
+            (uint64_t(get32(m_block.data() + 4)) << 32) |
+            get32(m_block.data() + 8);
+        const auto secs = ticks / iface.ticks_per_second;
+        const auto rest = ticks % iface.ticks_per_second;
+        const auto timestamp = std::chrono::seconds(secs) +
+            std::chrono::nanoseconds(
+                rest * 1000000000 / iface.ticks_per_second);
+
+        if (auto d = decode(
+                iface.link_type, timestamp, m_block.data() + 20, cap_len))
+        {
+            return d;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<MDNS_CapturedDatagram> MDNS_PcapReader::decode(
+    uint16_t link_type, std::chrono::nanoseconds timestamp,
+    const uint8_t* data, size_t size)
+{
+    const auto* end = data + size;
+    const uint8_t* ip = nullptr;
+
+    switch (link_type)
+    {
+    case LINKTYPE_ETHERNET: {
+        size_t offset = 12;
+        while (offset + 2 <= size &&
+            load_be16(data + offset) == ETHERTYPE_VLAN)
+        {
+            offset += 4;
+        }
+        if (offset + 2 <= size &&
+            (load_be16(data + offset) == ETHERTYPE_IPV4 ||
+                load_be16(data + offset) == ETHERTYPE_IPV6))
+        {
+            ip = data + offset + 2;
+        }
+        break;
+    }
+    case LINKTYPE_LINUX_SLL:
+        if (size >= 16)
+        {
+            ip = data + 16;
+        }
+        break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        ip = data;
+        break;
+    default:
+        break;
+    }
+
+    const uint8_t* udp = nullptr;
+    std::optional<iuring::IPAddress> source;
+    if (ip && ip + IPV4_HEADER_SIZE <= end && (ip[0] >> 4) == 4)
+    {
+        const size_t ihl = (ip[0] & 0x0f) * 4;
+        // fragments are not reassembled
+        const bool fragment = (load_be16(ip + 6) & 0x3fff) != 0;
+        if (ihl >= IPV4_HEADER_SIZE && ip[9] == IPPROTO_UDP_ID && !fragment)
+        {
+            udp = ip + ihl;
+            source = to_ip_address(AF_INET, ip + 12);
+        }
+    }
+    else if (ip && ip + IPV6_HEADER_SIZE <= end && (ip[0] >> 4) == 6)
+    {
+        // extension headers are not walked
+        if (ip[6] == IPPROTO_UDP_ID)
+        {
+            udp = ip + IPV6_HEADER_SIZE;
+            source = to_ip_address(AF_INET6, ip + 8);
+        }
+    }
+
+    if (!udp || !source || udp + UDP_HEADER_SIZE > end ||
+        (load_be16(udp) != MDNS_UDP_PORT &&
+            load_be16(udp + 2) != MDNS_UDP_PORT))
+    {
+        m_num_skipped++;
+        return std::nullopt;
+    }
+
+    const auto udp_len = load_be16(udp + 4);
+    const auto* payload = udp + UDP_HEADER_SIZE;
+    if (udp_len < UDP_HEADER_SIZE ||
+        payload + (udp_len - UDP_HEADER_SIZE) > end)
+    {
+        LOG_DEBUG(m_logger, "MDNS: skipping truncated datagram in capture");
+        m_num_skipped++;
+        return std::nullopt;
+    }
+
+    return MDNS_CapturedDatagram{ .timestamp = timestamp,
+        .source = source.value(),
+        .source_port = load_be16(udp),
+        .payload = std::vector<uint8_t>(
+            payload, payload + (udp_len - UDP_HEADER_SIZE)) };
+}
+
+size_t replay_capture(MDNS_PcapReader& reader, MDNS_ReplaySpeed speed,
+    const std::function<void(const iuring::ReceivedMessage&)>& deliver)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::nanoseconds> first_timestamp;
+
+    size_t n = 0;
+    while (auto d = reader.next())
+    {
+        if (!first_timestamp)
+        {
+            first_timestamp = d->timestamp;
+        }
+        if (speed == MDNS_ReplaySpeed::ORIGINAL)
+        {
+            std::this_thread::sleep_until(
+                start + (d->timestamp - first_timestamp.value()));
+        }
+
+        iuring::ReceivedMessage msg(
+            d->payload.data(), d->payload.size(), d->source);
+        deliver(msg);
+        n++;
+    }
+    return n;
+}
+
+} // namespace mdns
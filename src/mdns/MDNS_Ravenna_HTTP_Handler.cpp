@@ -1,59 +1,81 @@
+#include <array>
+
 #include "mdns/MDNS_Service.hpp"
 #include "mdns/MDNS_Ravenna_HTTP_Handler.hpp"
 
 namespace mdns
 {
+    constexpr const auto& ravenna_http_service_name =
+        mdns_name<"_ravenna._sub._http._tcp.local">;
+
+    MDNS_Ravenna_HTTP_Handler::MDNS_Ravenna_HTTP_Handler(
+        const std::shared_ptr<iuring::IOUringInterface>& network,
+        logging::ILogger& logger, iuring::NetworkAdapter& adapter,
+        const std::string& node_id, const std::string& node_name)
+        : IMDNS_Handler(network, logger, adapter)
+        , m_hostname(create_list(node_name, "local"))
+        , m_service_names{
+            create_list(node_id, "_http", "_tcp"),
+            create_list(node_id, "_ravenna", "_sub", "_http", "_tcp"),
+            create_list(node_id, "_rtsp", "_tcp"),
+            create_list(node_id, "_ravenna", "_sub", "_rtsp", "_tcp"),
+        }
+    {
+    }
+
+    std::array<MDNS_ServiceInstance, 2>
+    MDNS_Ravenna_HTTP_Handler::node_instances(
+        const std::string& node_id, const std::string& node_name)
+    {
+        const auto port =
+            static_cast<uint16_t>(iuring::SocketPortID::UNENCRYPTED_WEB_PORT);
+        const name_list_t host_name{ node_name, "local" };
+        return {
+            MDNS_ServiceInstance{ .instance_name = node_id,
+                .service_type = { "_http", "_tcp", "local" },
+                .subtypes = { "_ravenna" },
+                .host_name = host_name,
+                .port = port,
+                .txt = "" },
+            MDNS_ServiceInstance{ .instance_name = node_id,
+                .service_type = { "_rtsp", "_tcp", "local" },
+                .subtypes = { "_ravenna" },
+                .host_name = host_name,
+                .port = port,
+                .txt = "" },
+        };
+    }
+
     MDNS_IsHandled MDNS_Ravenna_HTTP_Handler::handle_question(const QuestionData& q, IAnswerList& answer)
     {
-        if (!q.equals(std::vector<std::string>{
-                "_ravenna", "_sub", "_http", "_tcp", "local" }))
+        if (!q.equals(ravenna_http_service_name))
         {
             return MDNS_IsHandled::NOT_HANDLED_YET;
         }
 
+        append_records(q.name_list, answer);
+        return MDNS_IsHandled::IS_HANDLED;
+    }
+
+    void MDNS_Ravenna_HTTP_Handler::append_announcement(IAnswerList& answer)
+    {
+        append_records(ravenna_http_service_name, answer);
+    }
+
+    void MDNS_Ravenna_HTTP_Handler::append_records(const name_list_t& ptr_name, IAnswerList& answer)
+    {
         // <vendor node id>._http._tcp
         // <user defined node name>._http._tcp
         // <vendor node id>._ravenna._sub._http._tcp
         //
-
-        const auto hostname = create_list(get_vendor_node_name(), "local");
-
-        const auto ipv4_string_opt = get_adapter().get_interface_ip4();
-        assert(ipv4_string_opt.has_value());
-        auto& ipv4_string = ipv4_string_opt.value();
-
-        // // <vendor node id>._ravenna._sub._http._tcp.
-
-        const auto normal_name_http =
-            create_list(get_vendor_node_id(), "_http", "_tcp");
-        const auto ravenna_name_http = create_list(
-            get_vendor_node_id(), "_ravenna", "_sub", "_http", "_tcp");
-
-        const auto normal_name_rtsp =
-            create_list(get_vendor_node_id(), "_rtsp", "_tcp");
-        const auto ravenna_name_rtsp = create_list(
-            get_vendor_node_id(), "_ravenna", "_sub", "_rtsp", "_tcp");
-
-        const auto vec = std::vector<name_list_t>{
-            normal_name_http,
-            ravenna_name_http,
-            normal_name_rtsp,
-            ravenna_name_rtsp,
-        };
-
-        for (auto it : vec)
+        for (const auto& it : m_service_names)
         {
-            answer.append_PTR(q.name_list, it);
+            answer.append_PTR(ptr_name, it);
             answer.append_TXT(it, "");
-            answer.append_SRV(it, hostname);
-
-            const auto addr_general =
-                iuring::IPAddress::string_to_ipv4_address(
-                    ipv4_string.to_human_readable_ip_string(), get_logger());
-            answer.append_A(it, addr_general);
+            answer.append_SRV(it, m_hostname,
+                static_cast<uint16_t>(iuring::SocketPortID::UNENCRYPTED_WEB_PORT));
+            answer.append_host_addresses(it);
         }
-
-        return MDNS_IsHandled::IS_HANDLED;
     }
 
     MDNS_IsHandled MDNS_Ravenna_HTTP_Handler::handle_reply(const std::vector<ReplyData>& )
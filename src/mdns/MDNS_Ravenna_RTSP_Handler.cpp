@@ -5,8 +5,7 @@ namespace mdns
 {
     MDNS_IsHandled MDNS_Ravenna_RTSP_Handler::handle_question(const QuestionData& q, [[maybe_unused]] IAnswerList& answer)
     {
-        if (! q.equals(std::vector<std::string>{
-                "_ravenna", "_sub", "_rtsp", "_tcp", "local" }))
+        if (! q.equals(mdns_name<"_ravenna._sub._rtsp._tcp.local">))
         {
             return MDNS_IsHandled::NOT_HANDLED_YET;
         }
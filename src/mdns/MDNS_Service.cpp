@@ -1,13 +1,19 @@
+#include <algorithm>
+#include <cassert>
 #include <sstream>
 
 #include <iuring/IPAddress.hpp>
 
+#include <mdns/MDNS_AnswerList.hpp>
+#include <mdns/MDNS_HotLog.hpp>
+#include <mdns/MDNS_Pcap.hpp>
 #include <mdns/MDNS_Service.hpp>
 
+#include "MDNS_Decoder.hpp"
+#include "MDNS_Worker.hpp"
+
 namespace mdns
 {
-static constexpr uint8_t CACHE_FLASH_SHIFT = 15;
-
 static constexpr const char* _MDNS_MCAST_IPADDR = "224.0.0.251";
 static constexpr const char* _MDNS_MCAST_IPADDR6 = "FF02::FB";
 
@@ -44,493 +50,913 @@ std::string get_vendor_node_name()
 }
 
 
-void append(iuring::SendPacket& payload, const name_list_t& name)
+MDNS_Service::MDNS_Service(
+    const std::shared_ptr<realtime::RealtimeKernel>& rt_kernel,
+    const std::shared_ptr<iuring::IOUringInterface>& network,
+    logging::ILogger& logger, iuring::NetworkAdapter& adapter,
+    iuring::ISocketFactory& socket_factory)
+    : service::Service(rt_kernel, logger)
+    , m_socket_factory(socket_factory)
+    , m_network(network)
+    , m_answer_arena_buffer(std::make_unique<std::byte[]>(ANSWER_ARENA_SIZE))
+    , m_answer_arena(m_answer_arena_buffer.get(), ANSWER_ARENA_SIZE)
 {
-    const auto mdns_name = StringUtils::to_mdns_string(name);
-    payload.append(mdns_name);
+    add_interface(adapter);
 }
 
+MDNS_Service::~MDNS_Service() = default;
 
-void append_record_PTR(iuring::SendPacket& payload, const name_list_t& name,
-    const name_list_t& value, uint16_t& num_answers)
+MDNS_MetricsSnapshot MDNS_Service::get_metrics() const
 {
-    num_answers++;
-    const uint32_t ttl_secs = 4500;
-
-    const auto v = StringUtils::to_mdns_string(value);
-
-    append(payload, name);
-    payload.append_uint16(static_cast<uint16_t>(DNS_RecordType::PTR));
-    payload.append_uint16(
-        static_cast<uint16_t>(MDNS_class::IN) | (0 << CACHE_FLASH_SHIFT));
-    payload.append_uint32(ttl_secs);
-    payload.append_uint16(v.length());
-    payload.append(v);
+    auto ret = m_metrics.snapshot();
+    for (const auto& iface : m_interfaces)
+    {
+        ret.suppressed_records += iface.rate_limiter.get_num_suppressed();
+        ret.cache_entries += iface.rate_limiter.get_num_entries();
+        ret.cache_evictions += iface.rate_limiter.get_num_evictions();
+        ret.paced_packets += iface.egress_pacer.get_num_paced();
+        ret.coalesced_packets += iface.egress_pacer.get_num_coalesced();
+        ret.paced_drops += iface.egress_pacer.get_num_dropped();
+    }
+    // m_worker is not looked at: finish() may reset it meanwhile, the
+    // datagrams its rings dropped are counted by the callers
+    return ret;
 }
 
-void append_record_TXT(iuring::SendPacket& payload, const name_list_t& name,
-    const std::string& txt, uint16_t& num_answers)
+MDNS_AnswerList& MDNS_Service::get_pending_answers(Listener& listener)
 {
-    num_answers++;
-    const uint32_t ttl_secs = 4500;
-
-    append(payload, name);
-    payload.append_uint16(static_cast<uint16_t>(DNS_RecordType::TXT));
-    payload.append_uint16(
-        static_cast<uint16_t>(MDNS_class::IN) | (0 << CACHE_FLASH_SHIFT));
-    payload.append_uint32(ttl_secs);
-
-
-    const uint16_t data_length = 1 + txt.length();
-    payload.append_uint16(data_length);
-    payload.append_byte(txt.length()); // string terminator
-    payload.append(txt);
+    if (!listener.pending_answers)
+    {
+        auto& iface = *listener.iface;
+        std::pmr::polymorphic_allocator<> alloc(&m_answer_arena);
+        listener.pending_answers = alloc.new_object<MDNS_AnswerList>(
+            iface.host_ip4, iface.host_ip6, &m_answer_arena);
+        listener.pending_answers->set_rate_limiter(
+            &iface.rate_limiter, MDNS_RateLimiter::clock::now());
+    }
+    return *listener.pending_answers;
 }
 
-void append_record_SRV(iuring::SendPacket& payload, const name_list_t& name,
-    const name_list_t& hostname_list, uint16_t& num_answers)
+bool MDNS_Service::send_reply(std::span<const QuestionData> questions,
+    const iuring::IPAddress& from_address, Listener& listener)
 {
-    num_answers++;
-    const uint32_t ttl_secs = 120;
-    const uint16_t priority = 0;
-    const uint16_t weight = 0;
-    const uint16_t port =
-        static_cast<uint16_t>(iuring::SocketPortID::UNENCRYPTED_WEB_PORT);
+    auto& answerlist = get_pending_answers(listener);
 
-    append(payload, name);
-    payload.append_uint16(static_cast<uint16_t>(DNS_RecordType::SRV));
-    payload.append_uint16(
-        static_cast<uint16_t>(MDNS_class::IN) | (1 << CACHE_FLASH_SHIFT));
-    payload.append_uint32(ttl_secs);
+    const auto num_answers_before = answerlist.get_num_answers();
+    for (auto& q : questions)
+    {
+        answerlist.set_question(&q);
+        bool handled =
+            dispatch_question(q, answerlist) == MDNS_IsHandled::IS_HANDLED;
+        for (size_t ix = 0; ix < m_handlers.size() && !handled; ix++)
+        {
+            handled = m_handlers[ix]->handle_question(q, answerlist) ==
+                MDNS_IsHandled::IS_HANDLED;
+            m_metrics.count_handler(ix, handled);
+        }
+
+        if (!handled)
+        {
+            handled = m_registry.handle_question(q, answerlist) ==
+                MDNS_IsHandled::IS_HANDLED;
+            MDNS_Metrics::add(
+                handled ? m_metrics.registry_hits : m_metrics.registry_misses);
+        }
+
+        if (!handled)
+        {
+            MDNS_Metrics::add(m_metrics.unanswered_questions);
+            MDNS_HOT_LOG_DEBUG(get_logger(), "ignoring: {} from {}",
+                q.name_list.to_string(),
+                from_address.to_human_readable_ip_string());
+        }
+    }
+    answerlist.set_question(nullptr);
 
-    const auto hostname = StringUtils::to_mdns_string(hostname_list);
+    if (answerlist.get_num_answers() == num_answers_before)
+    {
+        MDNS_HOT_LOG_DEBUG(get_logger(), "mdns query not for us: no answers");
+        return false;
+    }
 
-    const uint16_t data_length = 6 + hostname.length();
-    payload.append_uint16(data_length);
-    payload.append_uint16(priority);
-    payload.append_uint16(weight);
-    payload.append_uint16(port);
-    payload.append(hostname);
+    MDNS_HOT_LOG_DEBUG(get_logger(),
+        "REPLYING TO MDNS QUERY!!! ({}:{}) - from {}",
+        listener.multicast_group, listener.socket->get_port(),
+        from_address.to_human_readable_ip_string());
+    return true;
 }
 
-void append_record_A(iuring::SendPacket& payload, const name_list_t& name,
-    const in_addr& addr, uint16_t& num_answers)
+void MDNS_Service::flush_pending_answers()
 {
-    num_answers++;
-    const uint32_t ttl_secs = 120;
-
-    append(payload, name);
-    payload.append_uint16(static_cast<uint16_t>(DNS_RecordType::A));
-    payload.append_uint16(
-        static_cast<uint16_t>(MDNS_class::IN) | (1 << CACHE_FLASH_SHIFT));
-    payload.append_uint32(ttl_secs);
+    for (auto& listener : m_listeners)
+    {
+        if (listener.pending_answers)
+        {
+            listener.pending_answers->write_additional_records();
+            // RFC 6762 §18.1: multicast responses carry id 0
+            send_answers(*listener.pending_answers, 0, listener);
+            std::destroy_at(listener.pending_answers);
+            listener.pending_answers = nullptr;
+        }
+    }
 
-    constexpr uint16_t data_length = sizeof(addr.s_addr);
-    payload.append_uint16(data_length);
-    static_assert(data_length == 4);
-    payload.append((const uint8_t*) &addr.s_addr, sizeof(addr.s_addr));
+    // nothing else lives in the arena
+    m_answer_arena.release();
 }
 
-class MyAnswerList : public IAnswerList
+MDNS_Service::PendingQuery* MDNS_Service::acquire_pending_query()
 {
-public:
-    void append_PTR(const name_list_t& name, const name_list_t& value) override
+    auto* pending = m_pending_queries.acquire();
+    if (pending)
     {
-        append_record_PTR(payload, name, value, num_answers);
+        return pending;
     }
-    void append_TXT(const name_list_t& name, const std::string& txt) override
+
+    MDNS_Metrics::add(m_metrics.dropped_queries);
+    if (m_overflow_policy == MDNS_OverflowPolicy::DROP_OLDEST)
     {
-        append_record_TXT(payload, name, txt, num_answers);
+        m_pending_queries.pop();
+        return m_pending_queries.acquire();
     }
-    void append_SRV(
-        const name_list_t& name, const name_list_t& hostname_list) override
+    return nullptr;
+}
+
+realtime::TaskStatus MDNS_Service::drain_pending_queries()
+{
+    // runs on every idle pass of the kernel, most of which find nothing
+    if (m_pending_queries.front())
     {
-        append_record_SRV(payload, name, hostname_list, num_answers);
+        answer_pending_queries(m_tick_budget);
     }
-    void append_A(const name_list_t& name, const in_addr& addr) override
+    return realtime::TaskStatus::TASK_OK;
+}
+
+bool MDNS_Service::answer_pending_queries(std::chrono::nanoseconds budget)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::array<std::chrono::steady_clock::time_point, MAX_QUERY_BATCH>
+        received_at;
+    size_t num_replied = 0;
+    for (size_t num_answered = 0; num_answered < MAX_QUERY_BATCH;
+        num_answered++)
     {
-        append_record_A(payload, name, addr, num_answers);
+        auto* pending = m_pending_queries.front();
+        if (!pending)
+        {
+            break;
+        }
+
+        // always make progress, but yield once the budget is used up
+        if (num_answered > 0 &&
+            std::chrono::steady_clock::now() - start >= budget)
+        {
+            MDNS_Metrics::add(m_metrics.deferred_batches);
+            break;
+        }
+
+        const auto& questions = pending->questions;
+        if (send_reply(std::span(questions).first(pending->num_questions),
+                pending->from_address.value(),
+                m_listeners[pending->listener_ix]))
+        {
+            received_at[num_replied++] = pending->received_at;
+        }
+        m_pending_queries.pop();
     }
 
-    uint16_t get_num_answers() const
+    // sampled when the datagrams carrying the replies completed
+    const auto built_at = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_replied; i++)
     {
-        return num_answers;
+        // full while sends don't complete, those replies go unsampled
+        auto* unsent = m_unsent_replies.acquire();
+        if (!unsent)
+        {
+            break;
+        }
+        *unsent = UnsentReply{ received_at[i], built_at };
+        m_unsent_replies.commit();
     }
 
-    const uint8_t* data() const
+    // everything answered in this batch goes out aggregated
+    flush_pending_answers();
+
+    if (std::chrono::steady_clock::now() - start > budget)
     {
-        return payload.data();
+        MDNS_Metrics::add(m_metrics.budget_overruns);
     }
-    size_t size() const
+
+    return !m_pending_queries.empty();
+}
+
+void MDNS_Service::send_unsolicited(
+    const std::function<void(MDNS_AnswerList&)>& fill, bool goodbye)
+{
+    for (const auto& listener : m_listeners)
     {
-        return payload.size();
+        MDNS_AnswerList answers(
+            listener.iface->host_ip4, listener.iface->host_ip6);
+        answers.set_goodbye(goodbye);
+        fill(answers);
+        send_answers(answers, 0, listener, MDNS_TxPriority::ANNOUNCEMENT);
     }
+}
 
-private:
-    iuring::SendPacket payload;
-    uint16_t num_answers = 0;
-};
-
-void MDNS_Service::send_reply(const std::vector<QuestionData>& questions,
-    const iuring::IPAddress& from_address, transaction_id_t id)
+void MDNS_Service::send_answers(const MDNS_AnswerList& answers,
+    transaction_id_t id, const Listener& listener, MDNS_TxPriority priority)
 {
-    MyAnswerList answerlist;
-    for (auto& q : questions)
+    const bool on_worker = m_worker && m_worker->is_worker_thread();
+
+    for (size_t i = 0; i < answers.get_num_packets(); i++)
     {
-        bool handled = false;
-        for (auto& h : m_handlers)
+        const auto& answer_packet = answers.get_packet(i);
+        // a negative response is made of NSEC records in the additional
+        // section only
+        if (answer_packet.num_answers == 0 && answer_packet.num_additional == 0)
+        {
+            continue;
+        }
+
+        MDNS_Header hdr(MDNS_Header::MessageType::REPLY, id,
+            answer_packet.num_answers, 0, answer_packet.num_additional);
+        const std::span<const uint8_t> header(
+            reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr));
+
+        // io_uring and the tx scheduler are only touched from the realtime
+        // thread
+        if (on_worker)
         {
-            if (h->handle_question(q, answerlist) == MDNS_IsHandled::IS_HANDLED)
+            if (!m_worker->push_outgoing(&listener - m_listeners.data(),
+                    header, answer_packet.payload, priority))
             {
-                handled = true;
-                break;
+                MDNS_Metrics::add(m_metrics.dropped_datagrams);
+                MDNS_HOT_LOG_ERROR(
+                    get_logger(), "mdns tx ring full, dropping reply");
+                return;
             }
         }
-
-        if (!handled)
+        else if (priority == MDNS_TxPriority::ANNOUNCEMENT)
         {
-            LOG_INFO(get_logger(), "ignoring: {} from {}",
-                StringUtils::to_string(q.name_list),
-                from_address.to_human_readable_ip_string());
+            listener.iface->tx_scheduler.push(
+                &listener - m_listeners.data(), header, answer_packet.payload);
+            arm_tx_pacing();
+        }
+        else
+        {
+            const auto result =
+                submit_datagram(listener, header, answer_packet.payload);
+            if (result == SubmitResult::SENT)
+            {
+                listener.iface->tx_scheduler.charge(
+                    std::chrono::steady_clock::now());
+            }
+            else if (result == SubmitResult::FAILED)
+            {
+                return;
+            }
         }
     }
+}
 
-    if (answerlist.get_num_answers() == 0)
+MDNS_Service::SubmitResult MDNS_Service::submit_datagram(
+    const Listener& listener, std::span<const uint8_t> header,
+    std::span<const uint8_t> payload)
+{
+    auto& pacer = listener.iface->egress_pacer;
+    if (pacer.try_send(
+            header.size() + payload.size(), std::chrono::steady_clock::now()))
     {
-        LOG_DEBUG(get_logger(), "mdns query not for us: no answers");
-        return;
+        return send_datagram(listener, header, payload) ? SubmitResult::SENT
+                                                         : SubmitResult::FAILED;
     }
 
-    LOG_INFO(get_logger(), "REPLYING TO MDNS QUERY!!! ({}:{}) - from {}",
-        MDNS_MCAST_IPADDR, m_listen_socket->get_port(),
-        from_address.to_human_readable_ip_string());
-
-    const auto dest_addr = iuring::create_sock_addr_in(
-        MDNS_MCAST_IPADDR, m_listen_socket->get_port(), get_logger());
+    switch (pacer.push(&listener - m_listeners.data(), header, payload,
+        std::chrono::steady_clock::now()))
+    {
+    case MDNS_EgressPacer::Result::QUEUED:
+        arm_egress_pacing();
+        return SubmitResult::QUEUED;
+    case MDNS_EgressPacer::Result::COALESCED:
+        return SubmitResult::COALESCED;
+    case MDNS_EgressPacer::Result::DROPPED:
+        break;
+    }
+    return SubmitResult::DROPPED;
+}
 
-    auto wi = get_io()->ackuire_send_workitem(m_listen_socket);
+bool MDNS_Service::send_datagram(const Listener& listener,
+    std::span<const uint8_t> header, std::span<const uint8_t> payload)
+{
+    auto wi = get_io()->ackuire_send_workitem(listener.socket);
+    if (!wi)
+    {
+        MDNS_HOT_LOG_ERROR(
+            get_logger(), "no send workitem available for mdns reply");
+        return false;
+    }
 
     auto& pkt = wi->get_send_packet();
-    MDNS_Header hdr(
-        MDNS_Header::MessageType::REPLY, id, answerlist.get_num_answers(), 0);
-    pkt.append(hdr);
-    pkt.append(answerlist.data(), answerlist.size());
+    if (!header.empty())
+    {
+        pkt.append(header.data(), header.size());
+    }
+    pkt.append(payload.data(), payload.size());
 
+    const auto dest_addr = iuring::create_sock_addr_in(
+        listener.multicast_group, listener.socket->get_port(), get_logger());
     wi->submit_packet(
         iuring::DatagramSendParameters{ .destination_address = dest_addr,
             .dscp = iuring::dscp_t::BEST_EFFORT,
             .ttl = iuring::timetolive_t::MDNS_TTL },
-        [](const iuring::SendResult&) {});
+        [this, submitted_at = std::chrono::steady_clock::now()](
+            const iuring::SendResult&) { record_sent_replies(submitted_at); });
+
+    const auto* hdr = reinterpret_cast<const MDNS_Header*>(
+        header.empty() ? payload.data() : header.data());
+    m_metrics.count_packet_out(MDNS_Header::MessageType::REPLY,
+        header.size() + payload.size(),
+        hdr->get_num_answers() + hdr->get_num_additional());
+    return true;
 }
 
-const uint8_t* extract_name(const uint8_t* start_of_packet,
-    const uint8_t* end_of_packet, std::vector<std::string>& name_list,
-    const uint8_t* ptr, logging::ILogger& logger)
+void MDNS_Service::record_sent_replies(
+    std::chrono::steady_clock::time_point submitted_at)
 {
-    const auto size_of_packet = (end_of_packet - start_of_packet);
-    constexpr auto mask_11 = 0b11000000;
-
-    while (true)
+    const auto now = std::chrono::steady_clock::now();
+    while (const auto* unsent = m_unsent_replies.front())
     {
-        // Check bounds before reading length byte
-        if (ptr >= end_of_packet)
+        // built after this datagram went out, it waits for a later one
+        if (unsent->built_at > submitted_at)
         {
-            LOG_ERROR(logger, "MDNS name extraction: pointer out of bounds");
-            return nullptr;
+            break;
         }
+        m_metrics.record_latency(now - unsent->received_at);
+        m_unsent_replies.pop();
+    }
+}
 
-        const uint8_t len = *ptr++;
+void MDNS_Service::run_at(const std::string& name,
+    std::chrono::steady_clock::time_point deadline,
+    const std::function<realtime::TaskStatus(realtime::BaseTask&)>& task)
+{
+    const auto delay = deadline - std::chrono::steady_clock::now();
+    if (delay <= std::chrono::steady_clock::duration::zero())
+    {
+        run_oneshot_idle_task(name, task);
+        return;
+    }
+    run_oneshot_timed_task(name,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(delay), task);
+}
 
-        // Length of 0 marks end of name
-        if (len == 0)
-        {
-            break;
-        }
+void MDNS_Service::arm_egress_pacing()
+{
+    if (m_egress_pacing_armed)
+    {
+        return;
+    }
+
+    // wake up when the first interface may send again
+    const auto now = std::chrono::steady_clock::now();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    for (const auto& iface : m_interfaces)
+    {
+        deadline = std::min(deadline, iface.egress_pacer.get_next_send(now));
+    }
+    if (deadline == std::chrono::steady_clock::time_point::max())
+    {
+        return;
+    }
+
+    m_egress_pacing_armed = true;
+    run_at("mdns-egress-pacing", deadline,
+        [this](realtime::BaseTask&) { return send_egress_queue(); });
+}
+
+realtime::TaskStatus MDNS_Service::send_egress_queue()
+{
+    m_egress_pacing_armed = false;
+
+    const auto now = std::chrono::steady_clock::now();
+    bool queued = false;
+    for (auto& iface : m_interfaces)
+    {
+        iface.egress_pacer.drain(now,
+            [this, now, &iface](
+                size_t listener_ix, std::span<const uint8_t> datagram) {
+                if (!send_datagram(m_listeners[listener_ix], {}, datagram))
+                {
+                    return false;
+                }
+                iface.tx_scheduler.charge(now);
+                return true;
+            });
+        queued = queued || !iface.egress_pacer.empty();
+    }
+
+    if (queued)
+    {
+        arm_egress_pacing();
+    }
+    return realtime::TaskStatus::TASK_OK;
+}
 
-        // Check we still have room after reading the length byte
-        if (ptr >= end_of_packet)
+void MDNS_Service::set_announcement_rate(const iuring::NetworkAdapter& adapter,
+    uint32_t packets_per_sec, std::chrono::microseconds max_jitter)
+{
+    for (auto& iface : m_interfaces)
+    {
+        if (&iface.adapter == &adapter)
         {
-            LOG_ERROR(logger, "MDNS name extraction: unexpected end after length byte");
-            return nullptr;
+            iface.tx_scheduler.set_rate(packets_per_sec, max_jitter);
         }
+    }
+}
 
-        if ((len & mask_11) == mask_11)
+void MDNS_Service::set_egress_limit(
+    const iuring::NetworkAdapter& adapter, const MDNS_EgressLimit& limit)
+{
+    for (auto& iface : m_interfaces)
+    {
+        if (&iface.adapter == &adapter)
         {
-            // Compressed name pointer
-            const auto offset_high = len & ~mask_11;
-            const auto offset_low = *ptr;
-            const auto offset = (offset_high << 8) | offset_low;
-            ptr++;
-
-            LOG_DEBUG(logger,
-                "len 0x{:x}, offset = {} ({:x} {:x}), pkt size = {}\n", len,
-                offset, offset_high, offset_low, size_of_packet);
+            iface.egress_pacer.set_limit(limit);
+        }
+    }
+}
 
-            if (offset >= size_of_packet)
+void MDNS_Service::start_worker()
+{
+    m_worker = std::make_unique<MDNS_Worker>(
+        get_logger(),
+        [this](const iuring::ReceivedMessage& data, size_t listener_ix,
+            std::chrono::steady_clock::time_point received_at) {
+            process_event(data, listener_ix, received_at);
+        },
+        [this]() {
+            // no realtime deadline on this thread, answer everything
+            while (answer_pending_queries(std::chrono::nanoseconds::max()))
             {
-                LOG_ERROR(logger, "MDNS name extraction: invalid offset {} >= packet size {}",
-                    offset, size_of_packet);
-                return nullptr;
             }
+        });
+    m_worker->start();
+}
 
-            extract_name(start_of_packet, end_of_packet, name_list,
-                start_of_packet + offset, logger);
-            break;
-        }
-        else
-        {
-            // Regular label - check if we have enough bytes
-            if (ptr + len > end_of_packet)
+void MDNS_Service::arm_worker_poll()
+{
+    if (m_worker_poll_armed)
+    {
+        return;
+    }
+    m_worker_poll_armed = true;
+    run_at("mdns-worker-poll",
+        std::chrono::steady_clock::now() + WORKER_POLL_INTERVAL,
+        [this](realtime::BaseTask&) {
+            m_worker_poll_armed = false;
+            if (!m_worker)
             {
-                LOG_ERROR(logger, "MDNS name extraction: label length {} exceeds packet boundary", len);
-                return nullptr;
+                // stopped by finish()
+                return realtime::TaskStatus::TASK_OK;
+            }
+            // asked first: once idle, everything it did is visible below
+            const bool busy = m_worker->is_busy();
+            submit_worker_output();
+            if (m_announcement_requested.exchange(false))
+            {
+                arm_announcement();
             }
 
-            std::string s((const char*) ptr, len);
+            // keep polling until the worker has nothing left in flight
+            if (busy)
+            {
+                arm_worker_poll();
+            }
+            return realtime::TaskStatus::TASK_OK;
+        });
+}
 
-            // fprintf(stderr, "found string[0x{:x}, off 0x%lx]: {}\n", len,
-            // (ptr
-            // - start_of_packet), s.c_str());
+void MDNS_Service::submit_worker_output()
+{
+    m_worker->drain_outgoing([this](const MDNS_Worker::Datagram& d) {
+        const std::span<const uint8_t> datagram(d.data.data(), d.size);
+        auto& listener = m_listeners[d.listener_ix];
+        if (d.priority == MDNS_TxPriority::ANNOUNCEMENT)
+        {
+            listener.iface->tx_scheduler.push(d.listener_ix, {}, datagram);
+            arm_tx_pacing();
+        }
+        else if (submit_datagram(listener, {}, datagram) == SubmitResult::SENT)
+        {
+            listener.iface->tx_scheduler.charge(
+                std::chrono::steady_clock::now());
+        }
+    });
+}
 
-            name_list.push_back(s);
-            ptr += len;
+void MDNS_Service::arm_tx_pacing()
+{
+    if (m_tx_pacing_armed)
+    {
+        return;
+    }
+    // the first interface with a packet due
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    for (const auto& iface : m_interfaces)
+    {
+        if (!iface.tx_scheduler.empty())
+        {
+            deadline = std::min(deadline, iface.tx_scheduler.get_next_send());
         }
     }
-    return ptr;
-}
+    if (deadline == std::chrono::steady_clock::time_point::max())
+    {
+        return;
+    }
 
+    m_tx_pacing_armed = true;
+    run_at("mdns-tx-pacing", deadline,
+        [this](realtime::BaseTask&) { return send_paced(); });
+}
 
-void MDNS_Service::handle_query(
-    const iuring::ReceivedMessage& data, const MDNS_Header* hdr)
+realtime::TaskStatus MDNS_Service::send_paced()
 {
-    std::vector<QuestionData> questions;
+    m_tx_pacing_armed = false;
 
-    const auto id = hdr->get_transaction_id();
-
-    const uint8_t* ptr = (const uint8_t*) (hdr + 1);
-    assert(ptr < data.end());
-    for (int i = 0; i < hdr->get_num_questions(); i++)
+    const auto now = std::chrono::steady_clock::now();
+    bool queued = false;
+    for (auto& iface : m_interfaces)
     {
-        std::vector<std::string> name_list;
-        ptr = extract_name(
-            data.begin(), data.end(), name_list, ptr, get_logger());
-        if (!ptr)
+        auto& scheduler = iface.tx_scheduler;
+        while (const auto* d = scheduler.next(now))
         {
-            LOG_ERROR(get_logger(), "malformed mdns packet??");
-            return;
+            // out of work items, try again later
+            if (submit_datagram(m_listeners[d->listener_ix], {}, d->data) ==
+                SubmitResult::FAILED)
+            {
+                scheduler.retry_later(now);
+                break;
+            }
+            scheduler.pop(now);
         }
+        queued = queued || !scheduler.empty();
+    }
 
-        uint16_t type = ntohs(*(uint16_t*) ptr);
-        ptr += sizeof(type);
+    if (queued)
+    {
+        arm_tx_pacing();
+    }
+    return realtime::TaskStatus::TASK_OK;
+}
 
-        uint16_t clazz_flags = ntohs(*(uint16_t*) ptr);
-        ptr += sizeof(clazz_flags);
+void MDNS_Service::receive(
+    const iuring::ReceivedMessage& data, size_t listener_ix)
+{
+    if (m_capture &&
+        !m_capture->write(data, m_listeners[listener_ix].multicast_group))
+    {
+        MDNS_HOT_LOG_DEBUG(
+            get_logger(), "mdns capture ring full, datagram not captured");
+    }
 
-        const auto clazz_id =
-            static_cast<MDNS_class>(0b0111111111111111 & clazz_flags);
-        const auto question_unicast = (0b1000000000000000 & clazz_flags) != 0;
+    if (!m_worker)
+    {
+        process_event(data, listener_ix, std::chrono::steady_clock::now());
+        return;
+    }
 
-        LOG_DEBUG(get_logger(),
-            "XXXXXXXXXXXXXX received MDNS QUESTION[{}]: (type:{:x}, "
-            "clazz:{:x}) {}",
-            i, type, clazz_flags, StringUtils::to_string(name_list).c_str());
+    if (!m_worker->push_received(data, listener_ix))
+    {
+        MDNS_Metrics::add(m_metrics.dropped_datagrams);
+        MDNS_HOT_LOG_DEBUG(
+            get_logger(), "mdns rx ring full, dropping datagram");
+    }
+    arm_worker_poll();
+}
 
+void MDNS_Service::add_handler(const std::shared_ptr<IMDNS_Handler>& handler)
+{
+    handler->set_announcer(
+        [this](IMDNS_Handler& h) { schedule_announcement(h); });
+    handler->set_executor([this](std::move_only_function<void()> task) {
+        if (!change_state(std::move(task)))
+        {
+            MDNS_HOT_LOG_ERROR(
+                get_logger(), "mdns worker busy, dropping a handler update");
+        }
+    });
 
-        // name = _services._dns-sd._udp.local
-        // type = 0x00ff (ANY)
-        // clazz_fl
-        questions.push_back(QuestionData{ .name_list = name_list,
-            .type = type,
-            .clazz = clazz_id,
-            .question_unicast = question_unicast });
+    if (!change_state([this, handler]() { m_handlers.push_back(handler); }))
+    {
+        LOG_ERROR(get_logger(), "MDNS: worker busy, handler not added");
     }
-
-    run_oneshot_idle_task("send-mdns-reply",
-        [this, questions, addr = data.get_source_address(), id](
-            realtime::BaseTask&) {
-            send_reply(questions, addr, id);
-            return realtime::TaskStatus::TASK_OK;
-        });
 }
 
-void MDNS_Service::handle_reply(
-    const iuring::ReceivedMessage& data, const MDNS_Header* hdr)
+bool MDNS_Service::change_state(std::move_only_function<void()> change)
 {
-    std::vector<ReplyData> replies;
+    if (!m_worker || m_worker->is_worker_thread())
+    {
+        change();
+        return true;
+    }
 
-    const uint8_t* ptr = (const uint8_t*) (hdr + 1);
-    assert(ptr < data.end());
-    LOG_INFO(get_logger(), "MDNS_HANDLE REPLY: handle {} answers",
-        hdr->get_num_answers());
-    for (int i = 0; i < hdr->get_num_answers(); i++)
+    if (!m_worker->push_command(std::move(change)))
     {
-        std::vector<std::string> name_list;
-        ptr = extract_name(
-            data.begin(), data.end(), name_list, ptr, get_logger());
-        if (!ptr)
+        return false;
+    }
+    arm_worker_poll();
+    return true;
+}
+
+void MDNS_Service::schedule_announcement(IMDNS_Handler& handler)
+{
+    const bool queued = change_state([this, &handler]() {
+        if (std::find(m_pending_announcements.begin(),
+                m_pending_announcements.end(),
+                &handler) == m_pending_announcements.end())
         {
-            LOG_ERROR(get_logger(), "malformed mdns packet??");
-            return;
+            m_pending_announcements.push_back(&handler);
         }
+        announce_later();
+    });
+    if (!queued)
+    {
+        MDNS_HOT_LOG_ERROR(
+            get_logger(), "mdns worker busy, dropping an announcement");
+    }
+}
 
+void MDNS_Service::announce_later()
+{
+    if (m_worker && m_worker->is_worker_thread())
+    {
+        m_announcement_requested.store(true, std::memory_order_release);
+        return;
+    }
+    arm_announcement();
+}
 
-        uint16_t type = ntohs(*(uint16_t*) ptr);
-        ptr += sizeof(type);
-
-        uint16_t clazz_flags = ntohs(*(uint16_t*) ptr);
-        ptr += sizeof(clazz_flags);
-
-        const auto clazz_id =
-            static_cast<MDNS_class>(0b0111111111111111 & clazz_flags);
+void MDNS_Service::arm_announcement()
+{
+    m_last_announce_request = std::chrono::steady_clock::now();
 
-        uint32_t ttl = ntohl(*(uint32_t*) ptr);
-        ptr += sizeof(ttl);
+    if (m_announcement_armed)
+    {
+        return;
+    }
+    m_announcement_armed = true;
+    run_at("send-mdns-announcement",
+        m_last_announce_request + ANNOUNCE_DEBOUNCE,
+        [this](realtime::BaseTask&) { return send_pending_announcements(); });
+}
 
-        uint16_t rdlen = ntohs(*(uint16_t*) ptr);
-        ptr += sizeof(rdlen);
+realtime::TaskStatus MDNS_Service::send_pending_announcements()
+{
+    // wait until the changes settled, then send one announcement
+    const auto settled = m_last_announce_request + ANNOUNCE_DEBOUNCE;
+    if (std::chrono::steady_clock::now() < settled)
+    {
+        run_at("send-mdns-announcement", settled,
+            [this](realtime::BaseTask&) { return send_pending_announcements(); });
+        return realtime::TaskStatus::TASK_OK;
+    }
 
-        const auto* payload_ptr = ptr;
-        std::string payload((const char*) ptr, rdlen);
-        ptr += rdlen;
-        assert(rdlen >= 0);
-        assert(rdlen < 32000);
+    m_announcement_armed = false;
+    if (!change_state([this]() { announce_pending(); }))
+    {
+        // try again once the worker caught up
+        arm_announcement();
+    }
+    return realtime::TaskStatus::TASK_OK;
+}
 
-        LOG_DEBUG(get_logger(),
-            "XXXXXXXXXXXXXX received MDNS REPLY[{}]: (type:{}/0x{:x}, "
-            "clazz:{}, ttl {}) {} <{}>",
-            i, type, type, clazz_flags, ttl,
-            StringUtils::to_string(name_list).c_str(), payload.c_str());
+void MDNS_Service::announce_pending()
+{
+    LOG_INFO(get_logger(),
+        "MDNS: announcing updates of {} handlers, {} services withdrawn",
+        m_pending_announcements.size(), m_pending_goodbyes.size());
+    if (!m_pending_goodbyes.empty())
+    {
+        send_unsolicited(
+            [this](MDNS_AnswerList& goodbye) {
+                for (const auto& instance : m_pending_goodbyes)
+                {
+                    MDNS_ServiceRegistry::append_records(instance, goodbye);
+                }
+            },
+            true);
+        m_pending_goodbyes.clear();
+    }
+    send_unsolicited(
+        [this](MDNS_AnswerList& announcement) {
+            for (auto* h : m_pending_announcements)
+            {
+                h->append_announcement(announcement);
+            }
+            m_registry.append_added(announcement);
+        },
+        false);
+    m_pending_announcements.clear();
+}
 
-        std::optional<SRV_payload> SRV;
-        std::optional<iuring::IPAddress> A;
-        std::optional<name_list_t> PTR;
-        std::optional<std::map<std::string, std::string>> TXT;
+error::Error MDNS_Service::finish()
+{
+    if (m_worker)
+    {
+        m_worker->stop();
+        // the changes it didn't get to, the goodbye has to cover them
+        m_worker->run_commands();
+        submit_worker_output();
+        m_worker.reset();
+    }
 
-        switch (type)
-        {
-        case static_cast<int>(RRType::SRV): {
-            const uint8_t* ptr = (const uint8_t*) payload_ptr;
-            uint16_t prio = ntohs(*(uint16_t*) ptr);
-            ptr += sizeof(prio);
+    // RFC 6762 §10.1: all our records in a single goodbye burst
+    LOG_INFO(get_logger(), "MDNS: sending goodbye");
+    send_unsolicited(
+        [this](MDNS_AnswerList& goodbye) {
+            append_static_announcements(goodbye);
+            for (auto& h : m_handlers)
+            {
+                h->append_announcement(goodbye);
+            }
+            m_registry.append_all(goodbye);
+            for (const auto& instance : m_pending_goodbyes)
+            {
+                MDNS_ServiceRegistry::append_records(instance, goodbye);
+            }
+        },
+        true);
+    m_pending_goodbyes.clear();
 
-            uint16_t weight = ntohs(*(uint16_t*) ptr);
-            ptr += sizeof(weight);
+    // nothing paces the packets once we are gone, send what is queued
+    for (auto& iface : m_interfaces)
+    {
+        iface.tx_scheduler.drain([this](const MDNS_TxScheduler::Datagram& d) {
+            send_datagram(m_listeners[d.listener_ix], {}, d.data);
+        });
+        iface.egress_pacer.flush(
+            [this](size_t listener_ix, std::span<const uint8_t> datagram) {
+                send_datagram(m_listeners[listener_ix], {}, datagram);
+            });
+    }
+    return error::Error::OK;
+}
 
-            uint16_t port = ntohs(*(uint16_t*) ptr);
-            ptr += sizeof(port);
+bool MDNS_Service::add_service(const MDNS_ServiceInstance& instance)
+{
+    // checked here as the registry may be changed on the worker
+    if (!instance.has_valid_names())
+    {
+        LOG_ERROR(get_logger(),
+            "MDNS: not publishing {}: a label or the name is too long",
+            instance.instance_name);
+        return false;
+    }
 
-            name_list_t name_list;
-            ptr = extract_name(
-                data.begin(), data.end(), name_list, ptr, get_logger());
-            if (!ptr)
-            {
-                LOG_ERROR(get_logger(), "malformed mdns packet??");
-                return;
-            }
+    const bool queued = change_state([this, instance]() {
+        [[maybe_unused]] const bool added = m_registry.add(instance);
+        announce_later();
+    });
+    if (!queued)
+    {
+        LOG_ERROR(get_logger(), "MDNS: not publishing {}: worker busy",
+            instance.instance_name);
+    }
+    return queued;
+}
 
-            SRV = SRV_payload{ .prio = prio,
-                .weight = weight,
-                .port = port,
-                .name_list = name_list };
-            break;
+void MDNS_Service::remove_service(const name_list_t& instance_name)
+{
+    const bool queued = change_state([this, instance_name]() {
+        auto instance = m_registry.remove(instance_name);
+        if (!instance)
+        {
+            return;
         }
 
-        case static_cast<int>(RRType::TXT): {
-            std::map<std::string, std::string> map;
-            const uint8_t* ptr = (const uint8_t*) payload_ptr;
-            const uint8_t* end = ptr + rdlen;
+        m_pending_goodbyes.push_back(std::move(instance.value()));
+        announce_later();
+    });
+    if (!queued)
+    {
+        LOG_ERROR(get_logger(), "MDNS: not withdrawing {}: worker busy",
+            instance_name.to_string());
+    }
+}
 
-            while (ptr < end)
-            {
-                uint8_t len = *ptr;
-                if (len == 0)
-                {
-                    break;
-                }
-                ptr++;
-                std::string s((const char*) ptr, len);
-                if (const auto eq_sign = s.find('=');
-                    eq_sign != std::string::npos)
-                {
-                    const auto k = s.substr(0, eq_sign);
-                    const auto v = s.substr(eq_sign + 1);
-                    map[k] = v;
-                }
-                else
-                {
-                    map[s] = "";
-                }
-                ptr += len;
-            }
+void MDNS_Service::handle_query(const iuring::ReceivedMessage& data,
+    const MDNS_Header* hdr, size_t listener_ix,
+    std::chrono::steady_clock::time_point received_at)
+{
+    auto* pending = acquire_pending_query();
+    if (!pending)
+    {
+        MDNS_HOT_LOG_DEBUG(
+            get_logger(), "pending query ring full, dropping query");
+        return;
+    }
 
-            TXT = map;
-            break;
-        }
+    auto& questions = pending->questions;
 
-        case static_cast<int>(RRType::A): {
-            assert(payload.size() == 4);
-            in_addr sa;
-            memcpy(&sa, payload.data(), payload.size());
-            iuring::IPAddress ip(sa, iuring::SocketPortID::UNKNOWN);
-            A = ip;
-            break;
-        }
+    const size_t num_questions =
+        std::min<size_t>(hdr->get_num_questions(), MAX_QUESTIONS_PER_QUERY);
+    if (num_questions < hdr->get_num_questions())
+    {
+        MDNS_Metrics::add(m_metrics.dropped_questions,
+            hdr->get_num_questions() - num_questions);
+        MDNS_HOT_LOG_DEBUG(get_logger(),
+            "answering {} of the {} questions from {}", num_questions,
+            hdr->get_num_questions(),
+            data.get_source_address().to_human_readable_ip_string());
+    }
 
-        case static_cast<int>(RRType::AAAA): {
-            assert(payload.size() == 16);
-            in6_addr sa6;
-            memcpy(&sa6, payload.data(), payload.size());
-            iuring::IPAddress ip(sa6, iuring::SocketPortID::UNKNOWN);
-            A = ip;
-            break;
+    MDNS_Decoder decoder(
+        data.begin(), data.end(), reinterpret_cast<const uint8_t*>(hdr + 1));
+    for (size_t i = 0; i < num_questions; i++)
+    {
+        // grown one question at a time as each needs at least 5 bytes of
+        // the packet, whatever the header claims
+        if (i == questions.size())
+        {
+            questions.emplace_back();
         }
+        auto& question = questions[i];
+        if (!decoder.read_question(question))
+        {
+            m_metrics.count_malformed(decoder.get_error());
+            MDNS_HOT_LOG_ERROR(get_logger(),
+                "malformed mdns query from {}: {}",
+                data.get_source_address().to_human_readable_ip_string(),
+                MDNS_Decoder::to_string(decoder.get_error()));
+            return;
+        }
+        m_metrics.count_question(question.type);
 
-        case static_cast<int>(RRType::PTR): {
-            const uint8_t* ptr = (const uint8_t*) payload_ptr;
-            name_list_t name_list;
-            ptr = extract_name(
-                data.begin(), data.end(), name_list, ptr, get_logger());
-            if (!ptr)
-            {
-                LOG_ERROR(get_logger(), "malformed mdns packet??");
-                return;
-            }
+        MDNS_HOT_LOG_DEBUG(get_logger(),
+            "received MDNS QUESTION[{}]: (type:{:x}, unicast:{}) {}", i,
+            question.type, question.question_unicast,
+            question.name_list.to_string());
+    }
 
-            PTR = name_list;
-            break;
-        }
+    pending->num_questions = num_questions;
+    pending->from_address = data.get_source_address();
+    pending->listener_ix = listener_ix;
+    pending->received_at = received_at;
+    m_pending_queries.commit();
+}
 
+void MDNS_Service::handle_reply(
+    const iuring::ReceivedMessage& data, const MDNS_Header* hdr)
+{
+    std::vector<ReplyData> replies;
 
-        default:
-            break;
+    MDNS_HOT_LOG_INFO(get_logger(), "MDNS_HANDLE REPLY: handle {} answers",
+        hdr->get_num_answers());
+    MDNS_Decoder decoder(
+        data.begin(), data.end(), reinterpret_cast<const uint8_t*>(hdr + 1));
+    for (int i = 0; i < hdr->get_num_answers(); i++)
+    {
+        auto record = decoder.read_record();
+        if (!record)
+        {
+            m_metrics.count_malformed(decoder.get_error());
+            MDNS_HOT_LOG_ERROR(get_logger(),
+                "malformed mdns reply from {}: {}",
+                data.get_source_address().to_human_readable_ip_string(),
+                MDNS_Decoder::to_string(decoder.get_error()));
+            return;
         }
 
-        replies.push_back(
-            ReplyData{ name_list, type, clazz_id, payload, SRV, A, PTR, TXT });
+        MDNS_HOT_LOG_DEBUG(get_logger(),
+            "received MDNS REPLY[{}]: (type:{}/0x{:x}, clazz:{}, ttl {}) {}",
+            i, record->type, record->type,
+            static_cast<int>(record->clazz), record->ttl,
+            record->name_list.to_string());
+        replies.push_back(std::move(record.value()));
     }
 
-    bool handled = false;
-    for (auto& h : m_handlers)
+    bool handled =
+        dispatch_replies(replies) == MDNS_IsHandled::IS_HANDLED;
+    for (size_t ix = 0; ix < m_handlers.size() && !handled; ix++)
     {
-        if (h->handle_reply(replies) == MDNS_IsHandled::IS_HANDLED)
-        {
-            handled = true;
-            break;
-        }
+        handled = m_handlers[ix]->handle_reply(replies) ==
+            MDNS_IsHandled::IS_HANDLED;
     }
 
     if (!handled)
     {
-        LOG_INFO(get_logger(), "ignoring: {}", StringUtils::to_string(replies));
+        MDNS_HOT_LOG_INFO(
+            get_logger(), "ignoring: {}", StringUtils::to_string(replies));
     }
 }
 
 
-void MDNS_Service::process_event(const iuring::ReceivedMessage& data)
+void MDNS_Service::process_event(const iuring::ReceivedMessage& data,
+    size_t listener_ix, std::chrono::steady_clock::time_point received_at)
 {
     if (sizeof(MDNS_Header) > data.get_size())
     {
-        LOG_ERROR(get_logger(),
+        m_metrics.count_malformed(MDNS_MalformedReason::HEADER_TOO_SHORT);
+        MDNS_HOT_LOG_ERROR(get_logger(),
             "ignoring request, packet too small for mdns header ({} bytes)",
             data.get_size());
         return;
@@ -539,10 +965,12 @@ void MDNS_Service::process_event(const iuring::ReceivedMessage& data)
     auto* ptr = data.begin();
     auto* hdr = (MDNS_Header*) ptr;
 
+    m_metrics.count_packet_in(hdr->get_message_type(), data.get_size());
+
     switch (hdr->get_message_type())
     {
     case MDNS_Header::MessageType::QUERY:
-        handle_query(data, hdr);
+        handle_query(data, hdr, listener_ix, received_at);
         break;
     case MDNS_Header::MessageType::REPLY:
         handle_reply(data, hdr);
@@ -550,31 +978,90 @@ void MDNS_Service::process_event(const iuring::ReceivedMessage& data)
     }
 }
 
-[[nodiscard]] error::Error MDNS_Service::init()
+[[nodiscard]] error::Error MDNS_Service::add_listener(Interface& iface,
+    iuring::SocketType type, const iuring::IPAddress& multicast_group,
+    const iuring::IPAddress& interface_ip)
 {
     const auto port = iuring::SocketPortID::MDNS_PORT;
 
-    m_listen_socket = m_socket_factory.create_impl(iuring::SocketType::IPV4_UDP,
-        port, get_logger(), iuring::SocketKind::MULTICAST_PACKET_SOCKET);
+    auto socket = m_socket_factory.create_impl(type, port, get_logger(),
+        iuring::SocketKind::MULTICAST_PACKET_SOCKET);
+    if (!socket)
+    {
+        return error::Error::FAILED_TO_CREATE_SOCKET;
+    }
+
+    socket->join_multicast_group(multicast_group, interface_ip);
 
-    const auto interface_ip_opt = get_adapter().get_interface_ip4();
-    assert(interface_ip_opt.has_value());
-    const auto interface_ip = interface_ip_opt.value();
+    LOG_INFO(get_logger(), "MDNS: listening on [{}]:{}, interface {}",
+        multicast_group, static_cast<int>(port), interface_ip);
 
-    m_listen_socket->join_multicast_group(MDNS_MCAST_IPADDR, interface_ip);
-    if (!m_listen_socket)
+    m_listeners.push_back(Listener{ .socket = socket,
+        .multicast_group = multicast_group,
+        .iface = &iface,
+        .pending_answers = nullptr });
+    return error::Error::OK;
+}
+
+[[nodiscard]] error::Error MDNS_Service::init()
+{
+    for (auto& iface : m_interfaces)
     {
-        return error::Error::FAILED_TO_CREATE_SOCKET;
+        const auto interface_ip_opt = iface.adapter.get_interface_ip4();
+        assert(interface_ip_opt.has_value());
+        const auto interface_ip = interface_ip_opt.value();
+
+        iface.host_ip4 = iuring::IPAddress::string_to_ipv4_address(
+            interface_ip.to_human_readable_ip_string(), get_logger());
+        if (const auto err = add_listener(iface, iuring::SocketType::IPV4_UDP,
+                MDNS_MCAST_IPADDR, interface_ip);
+            err != error::Error::OK)
+        {
+            return err;
+        }
+
+        // IPv6 is optional: only when the adapter has an address for it
+        if (const auto interface_ip6_opt = iface.adapter.get_interface_ip6())
+        {
+            in6_addr addr6;
+            if (inet_pton(AF_INET6,
+                    interface_ip6_opt->to_human_readable_ip_string().c_str(),
+                    &addr6) == 1)
+            {
+                iface.host_ip6 = addr6;
+            }
+
+            if (const auto err = add_listener(iface,
+                    iuring::SocketType::IPV6_UDP, MDNS_MCAST_IPADDR6,
+                    interface_ip6_opt.value());
+                err != error::Error::OK)
+            {
+                return err;
+            }
+        }
     }
 
-    LOG_INFO(get_logger(), "MDNS: listening on port {}, interface {}",
-        static_cast<int>(port), interface_ip);
+    // the worker answers from its own idle callback, inline mode from one
+    // idle task that lives as long as the service, so a query costs no
+    // task or closure allocation
+    if (m_processing_mode == MDNS_ProcessingMode::WORKER_THREAD)
+    {
+        start_worker();
+    }
+    else
+    {
+        add_idle_task("send-mdns-reply",
+            [this](realtime::BaseTask&) { return drain_pending_queries(); });
+    }
 
-    get_io()->submit_recv(
-        m_listen_socket, [this](const iuring::ReceivedMessage& data) {
-            process_event(data);
-            return iuring::ReceivePostAction::RE_SUBMIT;
-        });
+    for (size_t ix = 0; ix < m_listeners.size(); ix++)
+    {
+        get_io()->submit_recv(m_listeners[ix].socket,
+            [this, ix](const iuring::ReceivedMessage& data) {
+                receive(data, ix);
+                return iuring::ReceivePostAction::RE_SUBMIT;
+            });
+    }
     return error::Error::OK;
 }
 
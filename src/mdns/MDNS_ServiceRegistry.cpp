@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+
+#include "mdns/MDNS_ServiceRegistry.hpp"
+
+namespace mdns
+{
+static constexpr std::array INSTANCE_TYPES{ RRType::TXT, RRType::SRV };
+
+// RFC 6762 §16, only ASCII letters fold
+static bool labels_equal_canonical(std::string_view a, std::string_view b)
+{
+    const auto to_lower = [](char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    };
+    return std::ranges::equal(
+        a, b, [&](char x, char y) { return to_lower(x) == to_lower(y); });
+}
+
+// RFC 6763 §9
+static constexpr auto SERVICE_TYPE_ENUMERATION =
+    mdns_name<"_services._dns-sd._udp.local">;
+
+bool MDNS_ServiceRegistry::add(const MDNS_ServiceInstance& instance)
+{
+    if (!instance.has_valid_names())
+    {
+        return false;
+    }
+    const auto instance_name = instance.get_instance_name().value();
+    remove(instance_name);
+
+    uint32_t ix;
+    if (m_free_instances.empty())
+    {
+        ix = static_cast<uint32_t>(m_instances.size());
+        m_instances.emplace_back();
+    }
+    else
+    {
+        ix = m_free_instances.back();
+        m_free_instances.pop_back();
+    }
+    m_num_instances++;
+
+    auto& entry = m_instances[ix];
+    entry.name = acquire_name(instance_name);
+    entry.service_type = acquire_name(instance.service_type);
+    entry.host_name = acquire_name(instance.host_name);
+    for (const auto& subtype : instance.subtypes)
+    {
+        entry.subtype_names.push_back(
+            acquire_name(instance.get_subtype_name(subtype).value()));
+    }
+    entry.port = instance.port;
+    entry.txt_rdata.push_back(static_cast<char>(instance.txt.size()));
+    entry.txt_rdata.append(instance.txt);
+
+    m_names[entry.name].instance = ix;
+    m_names[entry.host_name].num_hosted++;
+    add_browse(entry.service_type, ix, true);
+    for (const auto subtype_name : entry.subtype_names)
+    {
+        add_browse(subtype_name, ix, false);
+    }
+    m_added.push_back(ix);
+    return true;
+}
+
+std::optional<MDNS_ServiceInstance> MDNS_ServiceRegistry::remove(
+    const name_list_t& instance_name)
+{
+    const auto name = find_name(instance_name);
+    if (name == NO_ID || m_names[name].instance == NO_ID)
+    {
+        return std::nullopt;
+    }
+
+    const auto ix = m_names[name].instance;
+    auto& entry = m_instances[ix];
+    auto ret = to_instance(entry);
+
+    m_names[entry.name].instance = NO_ID;
+    m_names[entry.host_name].num_hosted--;
+    remove_browse(entry.service_type, ix);
+    for (const auto subtype_name : entry.subtype_names)
+    {
+        remove_browse(subtype_name, ix);
+    }
+
+    release_name(entry.name);
+    release_name(entry.service_type);
+    release_name(entry.host_name);
+    for (const auto subtype_name : entry.subtype_names)
+    {
+        release_name(subtype_name);
+    }
+
+    entry = Entry{};
+    m_free_instances.push_back(ix);
+    m_num_instances--;
+    std::erase(m_added, ix);
+    return ret;
+}
+
+uint32_t MDNS_ServiceRegistry::find_name(const name_list_t& name) const
+{
+    const auto [first, last] =
+        m_name_index.equal_range(name.get_canonical_hash());
+    for (auto it = first; it != last; it++)
+    {
+        if (name_equals(it->second, name))
+        {
+            return it->second;
+        }
+    }
+    return NO_ID;
+}
+
+bool MDNS_ServiceRegistry::name_equals(
+    uint32_t id, const name_list_t& name) const
+{
+    for (const auto label : name)
+    {
+        if (id == NO_ID || !labels_equal_canonical(get_label(id), label))
+        {
+            return false;
+        }
+        id = m_names[id].parent;
+    }
+    return id == NO_ID;
+}
+
+name_list_t MDNS_ServiceRegistry::get_name(uint32_t id) const
+{
+    name_list_t ret;
+    for (; id != NO_ID; id = m_names[id].parent)
+    {
+        // the name fitted when it was acquired
+        [[maybe_unused]] const bool ok = ret.push_back(get_label(id));
+        assert(ok);
+    }
+    return ret;
+}
+
+uint32_t MDNS_ServiceRegistry::acquire_name(const name_list_t& name)
+{
+    auto id = find_name(name);
+    if (id == NO_ID)
+    {
+        auto parent = NO_ID;
+        if (name.size() > 1)
+        {
+            name_list_t rest;
+            for (auto it = name.begin() + 1; it != name.end(); it++)
+            {
+                [[maybe_unused]] const bool ok = rest.push_back(*it);
+                assert(ok);
+            }
+            parent = acquire_name(rest);
+        }
+
+        if (m_free_names.empty())
+        {
+            id = static_cast<uint32_t>(m_names.size());
+            m_names.emplace_back();
+        }
+        else
+        {
+            id = m_free_names.back();
+            m_free_names.pop_back();
+        }
+        m_names[id].label = acquire_label(name.front());
+        m_names[id].parent = parent;
+        m_names[id].hash = name.get_canonical_hash();
+        m_name_index.emplace(m_names[id].hash, id);
+    }
+    m_names[id].num_refs++;
+    return id;
+}
+
+void MDNS_ServiceRegistry::release_name(uint32_t id)
+{
+    auto& entry = m_names[id];
+    if (--entry.num_refs > 0)
+    {
+        return;
+    }
+
+    const auto [first, last] = m_name_index.equal_range(entry.hash);
+    const auto it = std::find_if(
+        first, last, [id](const auto& index) { return index.second == id; });
+    m_name_index.erase(it);
+    release_label(entry.label);
+    const auto parent = entry.parent;
+    entry = NameEntry{};
+    m_free_names.push_back(id);
+    if (parent != NO_ID)
+    {
+        release_name(parent);
+    }
+}
+
+uint32_t MDNS_ServiceRegistry::acquire_label(std::string_view label)
+{
+    const auto hash = std::hash<std::string_view>{}(label);
+    const auto [first, last] = m_label_index.equal_range(hash);
+    const auto it = std::find_if(first, last, [&](const auto& index) {
+        return m_labels[index.second].text == label;
+    });
+    if (it != last)
+    {
+        m_labels[it->second].num_refs++;
+        return it->second;
+    }
+
+    uint32_t id;
+    if (m_free_labels.empty())
+    {
+        id = static_cast<uint32_t>(m_labels.size());
+        m_labels.emplace_back();
+    }
+    else
+    {
+        id = m_free_labels.back();
+        m_free_labels.pop_back();
+    }
+    m_labels[id] = Label{ .text = std::string(label), .hash = hash,
+        .num_refs = 1 };
+    m_label_index.emplace(hash, id);
+    return id;
+}
+
+void MDNS_ServiceRegistry::release_label(uint32_t id)
+{
+    auto& label = m_labels[id];
+    if (--label.num_refs > 0)
+    {
+        return;
+    }
+
+    const auto [first, last] = m_label_index.equal_range(label.hash);
+    const auto it = std::find_if(
+        first, last, [id](const auto& index) { return index.second == id; });
+    m_label_index.erase(it);
+    label = Label{};
+    m_free_labels.push_back(id);
+}
+
+void MDNS_ServiceRegistry::add_browse(
+    uint32_t name, uint32_t ix, bool is_service_type)
+{
+    auto& browse = m_names[name].browse;
+    // a subtype listed twice
+    if (!browse.empty() && browse.back() == ix)
+    {
+        return;
+    }
+    if (browse.empty() && is_service_type)
+    {
+        m_service_types.push_back(name);
+    }
+    browse.push_back(ix);
+}
+
+void MDNS_ServiceRegistry::remove_browse(uint32_t name, uint32_t ix)
+{
+    auto& browse = m_names[name].browse;
+    if (std::erase(browse, ix) > 0 && browse.empty())
+    {
+        std::erase(m_service_types, name);
+    }
+}
+
+MDNS_ServiceInstance MDNS_ServiceRegistry::to_instance(
+    const Entry& entry) const
+{
+    std::vector<std::string> subtypes;
+    for (const auto subtype_name : entry.subtype_names)
+    {
+        subtypes.emplace_back(get_label(subtype_name));
+    }
+    return MDNS_ServiceInstance{
+        .instance_name = get_label(entry.name),
+        .service_type = get_name(entry.service_type),
+        .subtypes = std::move(subtypes),
+        .host_name = get_name(entry.host_name),
+        .port = entry.port,
+        .txt = entry.txt_rdata.substr(1),
+    };
+}
+
+void MDNS_ServiceRegistry::append_records(
+    const MDNS_ServiceInstance& instance, IAnswerList& answer)
+{
+    // only instances that made it into a registry come here
+    if (!instance.has_valid_names())
+    {
+        return;
+    }
+    const auto name = instance.get_instance_name().value();
+
+    answer.append_PTR(instance.service_type, name);
+    for (const auto& subtype : instance.subtypes)
+    {
+        answer.append_PTR(instance.get_subtype_name(subtype).value(), name);
+    }
+    answer.append_TXT(name, instance.txt);
+    answer.append_SRV(name, instance.host_name, instance.port);
+    answer.append_host_addresses(instance.host_name);
+}
+
+void MDNS_ServiceRegistry::append_entry_records(
+    const Entry& entry, IAnswerList& answer) const
+{
+    const auto name = get_name(entry.name);
+    const auto host_name = get_name(entry.host_name);
+    answer.append_PTR(get_name(entry.service_type), name);
+    for (const auto subtype_name : entry.subtype_names)
+    {
+        answer.append_PTR(get_name(subtype_name), name);
+    }
+    answer.append_TXT_rdata(name, entry.txt_rdata);
+    answer.append_SRV(name, host_name, entry.port);
+    answer.append_host_addresses(host_name);
+}
+
+void MDNS_ServiceRegistry::append_all(IAnswerList& answer) const
+{
+    for (const auto& entry : m_instances)
+    {
+        if (entry.name != NO_ID)
+        {
+            append_entry_records(entry, answer);
+        }
+    }
+}
+
+void MDNS_ServiceRegistry::append_added(IAnswerList& answer)
+{
+    for (const auto ix : m_added)
+    {
+        append_entry_records(m_instances[ix], answer);
+    }
+    m_added.clear();
+}
+
+void MDNS_ServiceRegistry::append_answers(
+    const Entry& entry, IAnswerList& answer) const
+{
+    const auto name = get_name(entry.name);
+    const auto host_name = get_name(entry.host_name);
+    answer.append_TXT_rdata(name, entry.txt_rdata);
+    answer.append_SRV(name, host_name, entry.port);
+    answer.append_host_addresses(host_name);
+
+    // the instance and host names are ours alone, so which types they
+    // have is known for sure (RFC 6762 §6.1). Service type names are
+    // shared with other responders.
+    answer.append_NSEC(name, INSTANCE_TYPES);
+    answer.append_host_NSEC(host_name);
+}
+
+MDNS_IsHandled MDNS_ServiceRegistry::handle_question(
+    const QuestionData& q, IAnswerList& answer) const
+{
+    if (q.equals(SERVICE_TYPE_ENUMERATION))
+    {
+        for (const auto service_type : m_service_types)
+        {
+            answer.append_PTR(q.name_list, get_name(service_type));
+        }
+        return m_service_types.empty() ? MDNS_IsHandled::NOT_HANDLED_YET :
+                                         MDNS_IsHandled::IS_HANDLED;
+    }
+
+    const auto id = find_name(q.name_list);
+    if (id == NO_ID || !has_roles(m_names[id]))
+    {
+        return MDNS_IsHandled::NOT_HANDLED_YET;
+    }
+
+    const auto& name = m_names[id];
+    for (const auto ix : name.browse)
+    {
+        const auto& entry = m_instances[ix];
+        answer.append_PTR(q.name_list, get_name(entry.name));
+        append_answers(entry, answer);
+    }
+    if (name.instance != NO_ID)
+    {
+        append_answers(m_instances[name.instance], answer);
+    }
+    if (name.num_hosted > 0)
+    {
+        const auto host_name = get_name(id);
+        answer.append_host_addresses(host_name);
+        answer.append_host_NSEC(host_name);
+    }
+    return MDNS_IsHandled::IS_HANDLED;
+}
+
+} // namespace mdns
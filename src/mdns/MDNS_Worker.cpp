@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "MDNS_Worker.hpp"
+
+namespace mdns
+{
+void MDNS_Worker::start()
+{
+    m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+
+    // the worker must never compete with the realtime threads
+    sched_param param{};
+    if (pthread_setschedparam(m_thread.native_handle(), SCHED_IDLE, &param) !=
+        0)
+    {
+        LOG_ERROR(m_logger, "MDNS: failed to lower the worker thread priority");
+    }
+}
+
+void MDNS_Worker::stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    m_thread.request_stop();
+    m_rx_signal.fetch_add(1);
+    m_rx_signal.notify_one();
+    m_thread.join();
+}
+
+bool MDNS_Worker::push_received(
+    const iuring::ReceivedMessage& data, size_t listener_ix)
+{
+    auto* d = m_rx.acquire();
+    if (!d || data.get_size() > MAX_RECEIVED_SIZE)
+    {
+        m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    memcpy(d->data.data(), data.begin(), data.get_size());
+    d->size = data.get_size();
+    d->source = data.get_source_address();
+    d->listener_ix = listener_ix;
+    d->received_at = std::chrono::steady_clock::now();
+
+    m_num_inflight.fetch_add(1, std::memory_order_release);
+    m_rx.commit();
+    wake();
+    return true;
+}
+
+bool MDNS_Worker::push_command(command_t command)
+{
+    auto* slot = m_commands.acquire();
+    if (!slot)
+    {
+        return false;
+    }
+
+    *slot = std::move(command);
+    m_num_inflight.fetch_add(1, std::memory_order_release);
+    m_commands.commit();
+    wake();
+    return true;
+}
+
+size_t MDNS_Worker::run_commands()
+{
+    size_t num_run = 0;
+    while (auto* command = m_commands.front())
+    {
+        (*command)();
+        // release what it captured now, not when the slot is reused
+        *command = nullptr;
+        m_commands.pop();
+        num_run++;
+    }
+
+    if (num_run > 0)
+    {
+        m_num_inflight.fetch_sub(num_run, std::memory_order_release);
+    }
+    return num_run;
+}
+
+void MDNS_Worker::wake()
+{
+    // only pay for the futex wake when the worker is actually asleep
+    m_rx_signal.fetch_add(1);
+    if (m_waiting.load())
+    {
+        m_rx_signal.notify_one();
+    }
+}
+
+bool MDNS_Worker::push_outgoing(size_t listener_ix,
+    std::span<const uint8_t> header, std::span<const uint8_t> payload,
+    MDNS_TxPriority priority)
+{
+    auto* d = m_tx.acquire();
+    if (!d || header.size() + payload.size() > MAX_DATAGRAM_SIZE)
+    {
+        m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // an empty span may have no data() at all, which memcpy doesn't allow
+    std::copy(header.begin(), header.end(), d->data.begin());
+    std::copy(payload.begin(), payload.end(), d->data.begin() + header.size());
+    d->size = header.size() + payload.size();
+    d->listener_ix = listener_ix;
+    d->priority = priority;
+    m_tx.commit();
+    return true;
+}
+
+void MDNS_Worker::run(std::stop_token stop)
+{
+    m_thread_id.store(std::this_thread::get_id(), std::memory_order_release);
+
+    while (!stop.stop_requested())
+    {
+        const auto signal = m_rx_signal.load();
+
+        // state changes apply to the datagrams received after them
+        const auto num_commands = run_commands();
+
+        size_t num_processed = 0;
+        while (auto* d = m_rx.front())
+        {
+            iuring::ReceivedMessage msg(
+                d->data.data(), d->size, d->source.value());
+            m_process(msg, d->listener_ix, d->received_at);
+            m_rx.pop();
+            num_processed++;
+        }
+
+        if (num_processed > 0)
+        {
+            m_idle();
+            m_num_inflight.fetch_sub(num_processed, std::memory_order_release);
+        }
+        if (num_commands + num_processed > 0)
+        {
+            continue;
+        }
+
+        m_waiting.store(true);
+        if (m_rx.empty() && m_commands.empty() && !stop.stop_requested())
+        {
+            m_rx_signal.wait(signal);
+        }
+        m_waiting.store(false);
+    }
+}
+
+} // namespace mdns
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <span>
+#include <thread>
+
+#include <iuring/IOUringInterface.hpp>
+#include <iuring/ReceivedMessage.hpp>
+
+#include <slogger/ILogger.hpp>
+
+#include <mdns/MDNS_TxScheduler.hpp>
+#include <mdns/SPSC_Ring.hpp>
+
+namespace mdns
+{
+/** @brief low priority thread that does the mdns work off the realtime
+ * thread.
+ *
+ * The receive callback only copies the datagram into the rx ring. The
+ * worker parses, dispatches and builds the replies and hands the finished
+ * datagrams back through the tx ring, which the realtime thread drains and
+ * submits to io_uring.
+ *
+ * The state the replies are built from belongs to the worker while it
+ * runs. The realtime thread changes it with commands queued on the command
+ * ring, so it never waits for the worker.
+ */
+class MDNS_Worker
+{
+public:
+    // RFC 6762 §17: a received packet may be as large as 9000 bytes, the
+    // ones built here fit an ethernet frame
+    static constexpr size_t MAX_RECEIVED_SIZE = 9000;
+    static constexpr size_t MAX_DATAGRAM_SIZE = 1500;
+    static constexpr size_t RING_SIZE = 128;
+    static constexpr size_t COMMAND_RING_SIZE = 64;
+
+    struct Received
+    {
+        std::array<uint8_t, MAX_RECEIVED_SIZE> data;
+        size_t size = 0;
+        std::optional<iuring::IPAddress> source;
+        size_t listener_ix = 0;
+        std::chrono::steady_clock::time_point received_at;
+    };
+
+    struct Datagram
+    {
+        std::array<uint8_t, MAX_DATAGRAM_SIZE> data;
+        size_t size = 0;
+        size_t listener_ix = 0;
+        MDNS_TxPriority priority = MDNS_TxPriority::RESPONSE;
+    };
+
+    using command_t = std::move_only_function<void()>;
+
+    using process_func_t = std::function<void(const iuring::ReceivedMessage&,
+        size_t, std::chrono::steady_clock::time_point)>;
+    using idle_func_t = std::function<void()>;
+
+    /** @param process called on the worker for each received datagram
+     * @param idle called on the worker after a burst was processed
+     */
+    MDNS_Worker(logging::ILogger& logger, const process_func_t& process,
+        const idle_func_t& idle)
+        : m_logger(logger)
+        , m_process(process)
+        , m_idle(idle)
+    {
+    }
+
+    ~MDNS_Worker()
+    {
+        stop();
+    }
+
+    void start();
+    void stop();
+
+    bool is_worker_thread() const
+    {
+        return std::this_thread::get_id() ==
+            m_thread_id.load(std::memory_order_acquire);
+    }
+
+    /** @brief realtime thread: copy a received datagram for the worker
+     * @return false when the rx ring is full or the datagram is larger
+     * than MAX_RECEIVED_SIZE, it was dropped
+     */
+    bool push_received(const iuring::ReceivedMessage& data, size_t listener_ix);
+
+    /** @brief realtime thread: run command on the worker, before the
+     * datagrams received after it
+     * @return false when the command ring is full and nothing was queued
+     */
+    bool push_command(command_t command);
+
+    /** @brief runs the queued commands on the calling thread, which must be
+     * the worker or, once it was stopped, the realtime thread
+     * @return the number of commands run
+     */
+    size_t run_commands();
+
+    /** @brief worker thread: queue a finished datagram (header + payload)
+     * for sending
+     * @return false when the tx ring is full and the datagram was dropped
+     */
+    bool push_outgoing(size_t listener_ix, std::span<const uint8_t> header,
+        std::span<const uint8_t> payload,
+        MDNS_TxPriority priority = MDNS_TxPriority::RESPONSE);
+
+    /** @brief realtime thread: hands each queued datagram to submit
+     */
+    template <typename Submit> size_t drain_outgoing(const Submit& submit)
+    {
+        size_t n = 0;
+        while (auto* d = m_tx.front())
+        {
+            submit(*d);
+            m_tx.pop();
+            n++;
+        }
+        return n;
+    }
+
+    /** @brief true while commands or datagrams are being processed or
+     * datagrams are waiting to be sent
+     */
+    bool is_busy() const
+    {
+        return m_num_inflight.load(std::memory_order_acquire) > 0 ||
+            !m_tx.empty();
+    }
+
+    uint64_t get_num_dropped() const
+    {
+        return m_num_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    logging::ILogger& m_logger;
+    process_func_t m_process;
+    idle_func_t m_idle;
+
+    SPSC_Ring<Received, RING_SIZE> m_rx;
+    SPSC_Ring<Datagram, RING_SIZE> m_tx;
+    SPSC_Ring<command_t, COMMAND_RING_SIZE> m_commands;
+
+    std::atomic<uint32_t> m_rx_signal{ 0 };
+    std::atomic<bool> m_waiting{ false };
+    std::atomic<size_t> m_num_inflight{ 0 };
+    std::atomic<uint64_t> m_num_dropped{ 0 };
+
+    // set by the worker itself, m_thread is still being assigned when it
+    // starts running
+    std::atomic<std::thread::id> m_thread_id;
+    std::jthread m_thread;
+
+    void wake();
+    void run(std::stop_token stop);
+};
+
+} // namespace mdns
@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+#include "allocation_hooks.hpp"
+
+namespace mdns::test
+{
+std::atomic<uint64_t> g_num_allocations{ 0 };
+std::atomic<uint64_t> g_num_bytes_live{ 0 };
+std::atomic<uint64_t> g_peak_bytes_live{ 0 };
+} // namespace mdns::test
+
+namespace
+{
+void count_free(void* ptr)
+{
+    if (ptr)
+    {
+        mdns::test::g_num_bytes_live.fetch_sub(
+            malloc_usable_size(ptr), std::memory_order_relaxed);
+    }
+    std::free(ptr);
+}
+
+} // anonymous namespace
+
+void* operator new(std::size_t size)
+{
+    using namespace mdns::test;
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        const auto size_allocated = malloc_usable_size(ptr);
+        const auto live = size_allocated +
+            g_num_bytes_live.fetch_add(
+                size_allocated, std::memory_order_relaxed);
+        auto peak = g_peak_bytes_live.load(std::memory_order_relaxed);
+        while (live > peak &&
+            !g_peak_bytes_live.compare_exchange_weak(
+                peak, live, std::memory_order_relaxed))
+        {
+        }
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    count_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    count_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    count_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    count_free(ptr);
+}
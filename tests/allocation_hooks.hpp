@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace mdns::test
+{
+// bumped by the replaced global operator new (allocation_hooks.cpp), which
+// every binary linking it gets
+extern std::atomic<uint64_t> g_num_allocations;
+
+// heap bytes currently allocated and the most there ever were, as reported
+// by malloc_usable_size()
+extern std::atomic<uint64_t> g_num_bytes_live;
+extern std::atomic<uint64_t> g_peak_bytes_live;
+
+inline uint64_t get_num_allocations()
+{
+    return g_num_allocations.load(std::memory_order_relaxed);
+}
+
+/** @brief restarts the high-water mark from what is allocated now
+ */
+inline void reset_peak_bytes_live()
+{
+    g_peak_bytes_live.store(
+        g_num_bytes_live.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+}
+
+} // namespace mdns::test
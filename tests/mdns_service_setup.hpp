@@ -0,0 +1,220 @@
+#pragma once
+
+#include <gmock/gmock.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_AnswerList.hpp>
+#include <mdns/MDNS_HotLog.hpp>
+#include <mdns/MDNS_NMOS_HTTP_Handler.hpp>
+#include <mdns/MDNS_Ravenna_HTTP_Handler.hpp>
+#include <mdns/MDNS_Service.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+#include "../iuring/tests/iuring_mocks.hpp"
+#include "../tests/slogger_mocks.hpp"
+
+#include "mdns_test_helpers.hpp"
+
+namespace mdns
+{
+struct MDNS_ServiceProbe
+{
+    static void receive(
+        MDNS_Service& service, const iuring::ReceivedMessage& msg)
+    {
+        service.process_event(msg, 0, std::chrono::steady_clock::now());
+    }
+
+    static void answer_all(MDNS_Service& service)
+    {
+        while (service.answer_pending_queries(std::chrono::nanoseconds::max()))
+        {
+        }
+    }
+
+    static size_t num_pending_queries(const MDNS_Service& service)
+    {
+        return service.m_pending_queries.size();
+    }
+
+    /** @brief lets every record through the rate limiters again
+     */
+    static void reset_rate_limiters(MDNS_Service& service)
+    {
+        for (auto& iface : service.m_interfaces)
+        {
+            iface.rate_limiter.reset();
+        }
+    }
+
+    /** @brief one drain tick with the rate limiter at limiter_now instead
+     * of the wall clock, for simulations that run in virtual time
+     * @return true when queries are left for the next tick
+     */
+    static bool answer_batch(
+        MDNS_Service& service, MDNS_RateLimiter::clock::time_point limiter_now)
+    {
+        for (auto& listener : service.m_listeners)
+        {
+            service.get_pending_answers(listener).set_rate_limiter(
+                &listener.iface->rate_limiter, limiter_now);
+        }
+        return service.answer_pending_queries(
+            std::chrono::nanoseconds::max());
+    }
+
+    /** @brief answers the pending queries as a drain tick does, but
+     * returns the datagrams (header included) of the first listener instead
+     * of sending them
+     */
+    static std::vector<std::vector<uint8_t>> answer_to_wire(
+        MDNS_Service& service)
+    {
+        while (auto* pending = service.m_pending_queries.front())
+        {
+            service.send_reply(
+                std::span(pending->questions).first(pending->num_questions),
+                pending->from_address.value(),
+                service.m_listeners[pending->listener_ix]);
+            service.m_pending_queries.pop();
+        }
+
+        std::vector<std::vector<uint8_t>> datagrams;
+        auto* answers = service.m_listeners.front().pending_answers;
+        if (answers)
+        {
+            answers->write_additional_records();
+            for (size_t i = 0; i < answers->get_num_packets(); i++)
+            {
+                const auto& pkt = answers->get_packet(i);
+                const MDNS_Header hdr(MDNS_Header::MessageType::REPLY, 0,
+                    pkt.num_answers, 0, pkt.num_additional);
+                const auto* bytes = reinterpret_cast<const uint8_t*>(&hdr);
+                auto& datagram =
+                    datagrams.emplace_back(bytes, bytes + sizeof(hdr));
+                datagram.insert(
+                    datagram.end(), pkt.payload.begin(), pkt.payload.end());
+            }
+        }
+        // hands them to the mocked io_uring as well and releases them
+        service.flush_pending_answers();
+        return datagrams;
+    }
+
+    // without the rate limiter so every iteration encodes the records
+    static void send_reply(MDNS_Service& service,
+        const std::vector<QuestionData>& questions,
+        const iuring::IPAddress& from_address)
+    {
+        auto& listener = service.m_listeners.front();
+        service.get_pending_answers(listener).set_rate_limiter(nullptr, {});
+        service.send_reply(questions, from_address, listener);
+        service.flush_pending_answers();
+    }
+};
+
+
+/** @brief a service on mocked io_uring, the same setup as the unit tests
+ */
+class MDNS_ServiceSetup
+{
+public:
+    /** @brief builds the service on the mocks, init() is called after
+     */
+    using make_service_t =
+        std::function<std::shared_ptr<MDNS_Service>(MDNS_ServiceSetup&)>;
+
+    // MDNS_Service with the Ravenna and NMOS handlers
+    MDNS_ServiceSetup()
+        : MDNS_ServiceSetup(make_default_service)
+    {
+    }
+
+    explicit MDNS_ServiceSetup(const make_service_t& make_service)
+        : logger(true, true, logging::LogOutput::CONSOLE)
+        , rt_kernel(std::make_shared<realtime::RealtimeKernel>(
+              timer, logger, "bench-kernel"))
+        , network(std::make_shared<testing::NiceMock<iuring::mocks::IOUring>>())
+        , work_item(std::make_shared<
+              testing::NiceMock<iuring::mocks::SendWorkItem>>())
+        , adapter(logger, "eth0", false)
+    {
+        ON_CALL(*network, submit_recv(testing::_, testing::_))
+            .WillByDefault([this](const std::shared_ptr<iuring::ISocket>&,
+                               iuring::recv_callback_func_t handler) {
+                recv_callbacks.push_back(handler);
+            });
+        // every datagram goes out through the same work item and completes
+        // as soon as it is submitted
+        ON_CALL(*network, ackuire_send_workitem(testing::_))
+            .WillByDefault([this](const std::shared_ptr<iuring::ISocket>&) {
+                return work_item;
+            });
+        ON_CALL(*work_item, get_send_packet())
+            .WillByDefault(testing::ReturnRef(send_packet));
+        ON_CALL(*work_item, submit_packet(testing::_, testing::_))
+            .WillByDefault(
+                [this](const iuring::DatagramSendParameters&,
+                    const std::function<void(const iuring::SendResult&)>&
+                        on_sent) {
+                    num_submitted++;
+                    num_submitted_bytes += send_packet.size();
+                    send_packet.reset();
+                    on_sent(iuring::SendResult{});
+                });
+        ON_CALL(timer, get_time_ns()).WillByDefault([]() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch());
+        });
+        adapter.set_interface_ip4(
+            iuring::IPAddress::parse("192.168.1.100").value());
+
+        // keep the per-packet logging out of the measurements
+        set_hot_log_level(MDNS_LogLevel::OFF);
+
+        service = make_service(*this);
+        // measure the reply path, not the egress limit
+        service->set_egress_limit(adapter, MDNS_EgressLimit::unlimited());
+        (void) service->init();
+    }
+
+    testing::NiceMock<time_utils::mocks::Timer> timer;
+    logging::DirectConsoleLogger logger;
+    std::shared_ptr<realtime::RealtimeKernel> rt_kernel;
+    std::shared_ptr<testing::NiceMock<iuring::mocks::IOUring>> network;
+    std::shared_ptr<testing::NiceMock<iuring::mocks::SendWorkItem>> work_item;
+    iuring::SendPacket send_packet;
+    iuring::mocks::SocketFactory socket_factory;
+    iuring::NetworkAdapter adapter;
+    test::FakeNMOS_Service nmos;
+    std::shared_ptr<MDNS_Service> service;
+
+    // what the service handed to submit_recv, one per listener
+    std::vector<iuring::recv_callback_func_t> recv_callbacks;
+
+    // datagrams (and their bytes) submitted through work_item
+    uint64_t num_submitted = 0;
+    uint64_t num_submitted_bytes = 0;
+
+private:
+    static std::shared_ptr<MDNS_Service> make_default_service(
+        MDNS_ServiceSetup& setup)
+    {
+        auto service = std::make_shared<MDNS_Service>(setup.rt_kernel,
+            setup.network, setup.logger, setup.adapter, setup.socket_factory);
+        service->add_handler(std::make_shared<MDNS_Ravenna_HTTP_Handler>(
+            setup.network, setup.logger, setup.adapter));
+        service->add_handler(std::make_shared<MDNS_NMOS_HTTP_Handler>(
+            setup.network, setup.logger, setup.nmos, setup.adapter));
+        return service;
+    }
+};
+
+} // namespace mdns
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <mdns/MDNS_Header.hpp>
+#include <mdns/MDNS_NMOS_HTTP_Handler.hpp>
+
+/** @brief packet builders and fakes shared by the unit tests and the
+ * benchmarks
+ */
+namespace mdns::test
+{
+// Helper to create a simple MDNS name (domain label encoding)
+inline std::vector<uint8_t> encode_mdns_name(const std::vector<std::string>& labels)
+{
+    std::vector<uint8_t> result;
+    for (const auto& label : labels)
+    {
+        result.push_back(static_cast<uint8_t>(label.size()));
+        result.insert(result.end(), label.begin(), label.end());
+    }
+    result.push_back(0); // null terminator
+    return result;
+}
+
+// Helper to create a valid MDNS query packet
+inline std::vector<uint8_t> create_mdns_query_packet(transaction_id_t id,
+    const std::vector<std::string>& qname, uint16_t qtype = 12 /*PTR*/,
+    uint16_t qclass = 1 /*IN*/)
+{
+    std::vector<uint8_t> packet;
+
+    // MDNS Header (12 bytes)
+    // Transaction ID
+    packet.push_back((id >> 8) & 0xFF);
+    packet.push_back(id & 0xFF);
+
+    // Flags: standard query (QR=0, OPCODE=0, AA=0, TC=0, RD=0)
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Questions count
+    packet.push_back(0x00);
+    packet.push_back(0x01); // 1 question
+
+    // Answer RRs
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Authority RRs
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Additional RRs
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Question section
+    auto encoded_name = encode_mdns_name(qname);
+    packet.insert(packet.end(), encoded_name.begin(), encoded_name.end());
+
+    // QTYPE
+    packet.push_back((qtype >> 8) & 0xFF);
+    packet.push_back(qtype & 0xFF);
+
+    // QCLASS
+    packet.push_back((qclass >> 8) & 0xFF);
+    packet.push_back(qclass & 0xFF);
+
+    return packet;
+}
+
+// Helper to create a valid MDNS reply packet with PTR record
+inline std::vector<uint8_t> create_mdns_reply_packet(transaction_id_t id,
+    const std::vector<std::string>& name, const std::vector<std::string>& ptr_value)
+{
+    std::vector<uint8_t> packet;
+
+    // MDNS Header (12 bytes)
+    // Transaction ID
+    packet.push_back((id >> 8) & 0xFF);
+    packet.push_back(id & 0xFF);
+
+    // Flags: standard response (QR=1, OPCODE=0, AA=1, TC=0, RD=0)
+    packet.push_back(0x84); // QR=1, AA=1
+    packet.push_back(0x00);
+
+    // Questions count
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Answer RRs
+    packet.push_back(0x00);
+    packet.push_back(0x01); // 1 answer
+
+    // Authority RRs
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Additional RRs
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+
+    // Answer section
+    auto encoded_name = encode_mdns_name(name);
+    packet.insert(packet.end(), encoded_name.begin(), encoded_name.end());
+
+    // TYPE (PTR = 12)
+    packet.push_back(0x00);
+    packet.push_back(0x0C);
+
+    // CLASS (IN = 1)
+    packet.push_back(0x00);
+    packet.push_back(0x01);
+
+    // TTL (4500 seconds)
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x11);
+    packet.push_back(0x94);
+
+    // RDLENGTH
+    auto ptr_data = encode_mdns_name(ptr_value);
+    uint16_t rdlen = ptr_data.size();
+    packet.push_back((rdlen >> 8) & 0xFF);
+    packet.push_back(rdlen & 0xFF);
+
+    // RDATA (PTR target)
+    packet.insert(packet.end(), ptr_data.begin(), ptr_data.end());
+
+    return packet;
+}
+
+// Helper to create an MDNS reply packet with compressed names
+inline std::vector<uint8_t> create_mdns_reply_with_compression(transaction_id_t id)
+{
+    std::vector<uint8_t> packet;
+
+    // MDNS Header (12 bytes)
+    packet.push_back((id >> 8) & 0xFF);
+    packet.push_back(id & 0xFF);
+    packet.push_back(0x84); // QR=1, AA=1
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x00); // 0 questions
+    packet.push_back(0x00);
+    packet.push_back(0x03); // 3 answers
+    packet.push_back(0x00);
+    packet.push_back(0x00); // 0 authority
+    packet.push_back(0x00);
+    packet.push_back(0x00); // 0 additional
+
+    // First answer: myservice._http._tcp.local PTR
+    // Name: _http._tcp.local (will be at offset 12)
+    const size_t first_name_offset = packet.size();
+    packet.push_back(0x05); // length of "_http"
+    packet.insert(packet.end(), {'_', 'h', 't', 't', 'p'});
+    packet.push_back(0x04); // length of "_tcp"
+    packet.insert(packet.end(), {'_', 't', 'c', 'p'});
+    packet.push_back(0x05); // length of "local"
+    packet.insert(packet.end(), {'l', 'o', 'c', 'a', 'l'});
+    packet.push_back(0x00); // null terminator
+
+    // TYPE PTR, CLASS IN
+    packet.push_back(0x00);
+    packet.push_back(0x0C); // PTR
+    packet.push_back(0x00);
+    packet.push_back(0x01); // IN
+    
+    // TTL
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x11);
+    packet.push_back(0x94);
+
+    // RDLENGTH
+    const size_t rdlen_pos1 = packet.size();
+    packet.push_back(0x00);
+    packet.push_back(0x00); // placeholder
+
+    // RDATA: myservice._http._tcp.local (uses compression for _http._tcp.local)
+    const size_t rdata_start1 = packet.size();
+    packet.push_back(0x09); // length of "myservice"
+    packet.insert(packet.end(), {'m', 'y', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
+    // Compression pointer to offset 12 (_http._tcp.local)
+    packet.push_back(0xC0);
+    packet.push_back(static_cast<uint8_t>(first_name_offset));
+    
+    // Update RDLENGTH
+    uint16_t rdlen1 = packet.size() - rdata_start1;
+    packet[rdlen_pos1] = (rdlen1 >> 8) & 0xFF;
+    packet[rdlen_pos1 + 1] = rdlen1 & 0xFF;
+
+    // Second answer: another service using compression
+    // Name: _http._tcp.local (compressed pointer to first occurrence)
+    packet.push_back(0xC0);
+    packet.push_back(static_cast<uint8_t>(first_name_offset));
+
+    // TYPE PTR, CLASS IN
+    packet.push_back(0x00);
+    packet.push_back(0x0C); // PTR
+    packet.push_back(0x00);
+    packet.push_back(0x01); // IN
+    
+    // TTL
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x11);
+    packet.push_back(0x94);
+
+    // RDLENGTH
+    const size_t rdlen_pos2 = packet.size();
+    packet.push_back(0x00);
+    packet.push_back(0x00); // placeholder
+
+    // RDATA: otherservice._http._tcp.local (uses compression)
+    const size_t rdata_start2 = packet.size();
+    packet.push_back(0x0C); // length of "otherservice"
+    packet.insert(packet.end(), {'o', 't', 'h', 'e', 'r', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
+    // Compression pointer to offset 12 (_http._tcp.local)
+    packet.push_back(0xC0);
+    packet.push_back(static_cast<uint8_t>(first_name_offset));
+    
+    // Update RDLENGTH
+    uint16_t rdlen2 = packet.size() - rdata_start2;
+    packet[rdlen_pos2] = (rdlen2 >> 8) & 0xFF;
+    packet[rdlen_pos2 + 1] = rdlen2 & 0xFF;
+
+    // Third answer: deeply nested compression
+    // Name uses compression pointer
+    packet.push_back(0xC0);
+    packet.push_back(static_cast<uint8_t>(first_name_offset));
+
+    // TYPE PTR, CLASS IN
+    packet.push_back(0x00);
+    packet.push_back(0x0C); // PTR
+    packet.push_back(0x00);
+    packet.push_back(0x01); // IN
+    
+    // TTL
+    packet.push_back(0x00);
+    packet.push_back(0x00);
+    packet.push_back(0x11);
+    packet.push_back(0x94);
+
+    // RDLENGTH
+    const size_t rdlen_pos3 = packet.size();
+    packet.push_back(0x00);
+    packet.push_back(0x00); // placeholder
+
+    // RDATA: thirdservice._http._tcp.local (uses compression)
+    const size_t rdata_start3 = packet.size();
+    packet.push_back(0x0C); // length of "thirdservice"
+    packet.insert(packet.end(), {'t', 'h', 'i', 'r', 'd', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
+    // Compression pointer to offset 12 (_http._tcp.local)
+    packet.push_back(0xC0);
+    packet.push_back(static_cast<uint8_t>(first_name_offset));
+    
+    // Update RDLENGTH
+    uint16_t rdlen3 = packet.size() - rdata_start3;
+    packet[rdlen_pos3] = (rdlen3 >> 8) & 0xFF;
+    packet[rdlen_pos3 + 1] = rdlen3 & 0xFF;
+
+    return packet;
+}
+
+// Helper to create a DNS-SD style reply: PTR, SRV, TXT and A for one
+// instance, the way responders announce a service
+inline std::vector<uint8_t> create_mdns_service_reply_packet(
+    transaction_id_t id, const std::vector<std::string>& service,
+    const std::string& instance, const std::vector<std::string>& host,
+    uint16_t port, const std::vector<std::string>& txt, uint32_t ip4)
+{
+    std::vector<uint8_t> packet{ static_cast<uint8_t>(id >> 8),
+        static_cast<uint8_t>(id), 0x84, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+        0x00, 0x00, 0x00 };
+
+    auto instance_name = service;
+    instance_name.insert(instance_name.begin(), instance);
+
+    const auto put_record = [&packet](const std::vector<std::string>& name,
+                                uint16_t type,
+                                const std::vector<uint8_t>& rdata) {
+        auto encoded_name = encode_mdns_name(name);
+        packet.insert(packet.end(), encoded_name.begin(), encoded_name.end());
+        packet.insert(packet.end(),
+            { static_cast<uint8_t>(type >> 8), static_cast<uint8_t>(type),
+                0x00, 0x01, 0x00, 0x00, 0x11, 0x94,
+                static_cast<uint8_t>(rdata.size() >> 8),
+                static_cast<uint8_t>(rdata.size()) });
+        packet.insert(packet.end(), rdata.begin(), rdata.end());
+    };
+
+    put_record(service, 12 /*PTR*/, encode_mdns_name(instance_name));
+
+    std::vector<uint8_t> srv{ 0x00, 0x00, 0x00, 0x00,
+        static_cast<uint8_t>(port >> 8), static_cast<uint8_t>(port) };
+    const auto encoded_host = encode_mdns_name(host);
+    srv.insert(srv.end(), encoded_host.begin(), encoded_host.end());
+    put_record(instance_name, 33 /*SRV*/, srv);
+
+    std::vector<uint8_t> txt_rdata;
+    for (const auto& kv : txt)
+    {
+        txt_rdata.push_back(static_cast<uint8_t>(kv.size()));
+        txt_rdata.insert(txt_rdata.end(), kv.begin(), kv.end());
+    }
+    put_record(instance_name, 16 /*TXT*/, txt_rdata);
+
+    put_record(host, 1 /*A*/,
+        { static_cast<uint8_t>(ip4 >> 24), static_cast<uint8_t>(ip4 >> 16),
+            static_cast<uint8_t>(ip4 >> 8), static_cast<uint8_t>(ip4) });
+
+    return packet;
+}
+
+class FakeNMOS_Service : public INMOS_Service
+{
+public:
+    void start_registration(const iuring::IPAddress&,
+        std::optional<uint16_t>) override
+    {
+    }
+
+    size_t num_self() const override
+    {
+        return 1;
+    }
+    size_t num_devices() const override
+    {
+        return 1;
+    }
+    size_t num_source() const override
+    {
+        return 1;
+    }
+    size_t num_flows() const override
+    {
+        return 1;
+    }
+    size_t num_senders() const override
+    {
+        return m_senders;
+    }
+    size_t num_receivers() const override
+    {
+        return 0;
+    }
+
+    void add_sender()
+    {
+        m_senders++;
+        notify_changed();
+    }
+
+private:
+    size_t m_senders = 0;
+};
+
+} // namespace mdns::test
@@ -0,0 +1,411 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <mdns/MDNS_AnswerList.hpp>
+#include <mdns/MDNS_Header.hpp>
+
+#include "../src/mdns/MDNS_Decoder.hpp"
+
+using namespace testing;
+using namespace mdns;
+
+namespace
+{
+
+uint32_t read_uint32(std::span<const uint8_t> buf, size_t pos)
+{
+    return (buf[pos] << 24) | (buf[pos + 1] << 16) | (buf[pos + 2] << 8) |
+        buf[pos + 3];
+}
+
+const name_list_t service_type{ "_http", "_tcp", "local" };
+const name_list_t instance{ "node", "_http", "_tcp", "local" };
+const name_list_t host{ "node", "local" };
+
+// what the registry adds for a service instance
+void append_instance(MDNS_AnswerList& answers, const name_list_t& ptr_name)
+{
+    answers.append_PTR(ptr_name, instance);
+    answers.append_TXT(instance, "path=/");
+    answers.append_SRV(instance, host, 8080);
+    answers.append_host_addresses(host);
+}
+
+// the record types of a packet, answers first
+std::vector<RRType> decode_types(const MDNS_AnswerList::Packet& pkt)
+{
+    std::vector<uint8_t> data(sizeof(MDNS_Header));
+    data.insert(data.end(), pkt.payload.begin(), pkt.payload.end());
+    MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+        data.data() + sizeof(MDNS_Header));
+
+    std::vector<RRType> types;
+    for (size_t i = 0; i < pkt.num_answers + pkt.num_additional; i++)
+    {
+        const auto record = decoder.read_record();
+        EXPECT_TRUE(record.has_value());
+        if (!record)
+        {
+            break;
+        }
+        types.push_back(record->get_type());
+    }
+    EXPECT_EQ(decoder.get_position(), data.data() + data.size());
+    return types;
+}
+
+QuestionData question(const name_list_t& name, RRType type)
+{
+    return QuestionData{ name, static_cast<uint16_t>(type), MDNS_class::IN,
+        false };
+}
+
+// Test that repeated name suffixes are written as compression pointers
+TEST(MDNS_AnswerListTest, CompressesRepeatedNames)
+{
+    MDNS_AnswerList answers;
+    answers.append_PTR(
+        { "_http", "_tcp", "local" }, { "x", "_http", "_tcp", "local" });
+
+    ASSERT_EQ(answers.get_num_packets(), 1);
+    const auto& pkt = answers.get_packet(0);
+    EXPECT_EQ(pkt.num_answers, 1);
+
+    // name (18) + type/class/ttl/rdlen (10) + "x" label (2) + pointer (2)
+    ASSERT_EQ(pkt.payload.size(), 32);
+    EXPECT_EQ(pkt.payload[30], 0xC0);
+    EXPECT_EQ(pkt.payload[31], sizeof(MDNS_Header));
+    EXPECT_EQ(read_uint32(pkt.payload, 22),
+        MDNS_AnswerList::TTL_OTHER_RECORD_SECS);
+}
+
+// Test that goodbye records carry TTL 0
+TEST(MDNS_AnswerListTest, GoodbyeRecordsHaveZeroTTL)
+{
+    MDNS_AnswerList answers;
+    answers.set_goodbye(true);
+    answers.append_PTR(
+        { "_http", "_tcp", "local" }, { "x", "_http", "_tcp", "local" });
+
+    const auto& pkt = answers.get_packet(0);
+    EXPECT_EQ(read_uint32(pkt.payload, 22), 0);
+}
+
+// Test that a large burst is split into packets that each fit in a datagram
+TEST(MDNS_AnswerListTest, SplitsLargeBurstOverPackets)
+{
+    MDNS_AnswerList answers;
+    const std::string txt(200, 'a');
+    for (int i = 0; i < 40; i++)
+    {
+        answers.append_TXT(
+            { "node" + std::to_string(i), "_http", "_tcp", "local" }, txt);
+    }
+
+    EXPECT_EQ(answers.get_num_answers(), 40);
+    EXPECT_GT(answers.get_num_packets(), 1);
+
+    size_t total = 0;
+    for (size_t i = 0; i < answers.get_num_packets(); i++)
+    {
+        const auto& pkt = answers.get_packet(i);
+        EXPECT_LE(sizeof(MDNS_Header) + pkt.payload.size(),
+            MDNS_AnswerList::MAX_PACKET_SIZE);
+        total += pkt.num_answers;
+    }
+    EXPECT_EQ(total, 40);
+}
+
+// Test that host addresses produce both an A and an AAAA record
+TEST(MDNS_AnswerListTest, AppendsHostAddressesForBothFamilies)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    in6_addr ip6;
+    inet_pton(AF_INET6, "fe80::1", &ip6);
+
+    MDNS_AnswerList answers(ip4, ip6);
+    answers.append_host_addresses({ "fanode", "local" });
+    EXPECT_EQ(answers.get_num_answers(), 2);
+
+    const auto& pkt = answers.get_packet(0);
+    // fanode.local (14) + A header (10) + 4 bytes
+    // + pointer (2) + AAAA header (10) + 16 bytes
+    ASSERT_EQ(pkt.payload.size(), 14 + 10 + 4 + 2 + 10 + 16);
+    EXPECT_EQ(pkt.payload[14 + 10 + 4 + 2 + 1],
+        static_cast<uint8_t>(RRType::AAAA));
+}
+
+// Test that a record is multicast at most once per second per interface
+TEST(MDNS_AnswerListTest, RateLimitsRecordsPerInterface)
+{
+    MDNS_RateLimiter limiter;
+    const auto now = MDNS_RateLimiter::clock::now();
+
+    MDNS_AnswerList first;
+    first.set_rate_limiter(&limiter, now);
+    first.append_TXT({ "node", "_http", "_tcp", "local" }, "a");
+    first.append_TXT({ "node", "_http", "_tcp", "local" }, "b");
+    EXPECT_EQ(first.get_num_answers(), 2);
+
+    MDNS_AnswerList second;
+    second.set_rate_limiter(&limiter, now + std::chrono::milliseconds(500));
+    second.append_TXT({ "node", "_http", "_tcp", "local" }, "a");
+    EXPECT_EQ(second.get_num_answers(), 0);
+    EXPECT_EQ(limiter.get_num_suppressed(), 1);
+
+    MDNS_AnswerList third;
+    third.set_rate_limiter(&limiter, now + std::chrono::milliseconds(1500));
+    third.append_TXT({ "node", "_http", "_tcp", "local" }, "a");
+    EXPECT_EQ(third.get_num_answers(), 1);
+}
+
+// Test that an additional record dropped for lack of room isn't taken as
+// multicast, so the next query still gets it
+TEST(MDNS_AnswerListTest, RateLimitsOnlyRecordsSent)
+{
+    MDNS_RateLimiter limiter;
+    const auto now = MDNS_RateLimiter::clock::now();
+    const std::vector<std::string> strings(6, std::string(250, 'a'));
+
+    MDNS_AnswerList first;
+    first.set_rate_limiter(&limiter, now);
+    const auto q = question(service_type, RRType::PTR);
+    first.set_question(&q);
+    first.append_PTR(service_type, instance);
+    first.append_TXT(instance, strings);
+    first.write_additional_records();
+    EXPECT_EQ(first.get_num_answers(), 1);
+    EXPECT_EQ(first.get_num_additional(), 0);
+
+    MDNS_AnswerList second;
+    second.set_rate_limiter(&limiter, now + std::chrono::milliseconds(500));
+    second.append_TXT(instance, strings);
+    EXPECT_EQ(second.get_num_answers(), 1);
+    EXPECT_EQ(limiter.get_num_suppressed(), 0);
+}
+
+// Test that a browse answers with the PTR and moves the instance records
+// to the additional section (RFC 6763 §12.1)
+TEST(MDNS_AnswerListTest, BrowseAddsInstanceRecordsAsAdditional)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question(service_type, RRType::PTR);
+    answers.set_question(&q);
+    append_instance(answers, q.name_list);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 1);
+    EXPECT_EQ(answers.get_num_additional(), 3);
+    ASSERT_EQ(answers.get_num_packets(), 1);
+    EXPECT_EQ(decode_types(answers.get_packet(0)),
+        (std::vector<RRType>{
+            RRType::PTR, RRType::TXT, RRType::SRV, RRType::A }));
+}
+
+// Test that a TXT record of several strings keeps them apart, as answer
+// and as additional record
+TEST(MDNS_AnswerListTest, EncodesTXTStrings)
+{
+    const std::vector<std::string> strings{ "api_ver=v1.3", "ver_slf=1" };
+    for (const auto type : { RRType::TXT, RRType::PTR })
+    {
+        MDNS_AnswerList answers;
+        const auto q = question(
+            type == RRType::TXT ? instance : service_type, type);
+        answers.set_question(&q);
+        answers.append_PTR(service_type, instance);
+        answers.append_TXT(instance, strings);
+        answers.write_additional_records();
+        EXPECT_EQ(answers.get_num_answers() + answers.get_num_additional(),
+            type == RRType::TXT ? 1 : 2);
+
+        const auto& pkt = answers.get_packet(0);
+        std::vector<uint8_t> data(sizeof(MDNS_Header));
+        data.insert(data.end(), pkt.payload.begin(), pkt.payload.end());
+        MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+            data.data() + sizeof(MDNS_Header));
+        std::optional<ReplyData> record;
+        while (auto next = decoder.read_record())
+        {
+            record = next;
+        }
+        ASSERT_TRUE(record && record->TXT);
+        EXPECT_EQ(record->TXT.value(),
+            (std::map<std::string, std::string>{
+                { "api_ver", "v1.3" }, { "ver_slf", "1" } }));
+    }
+}
+
+// Test that a question in other case still gets its records as answers
+TEST(MDNS_AnswerListTest, QuestionMatchesNamesCaseInsensitively)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question({ "_HTTP", "_TCP", "Local" }, RRType::PTR);
+    answers.set_question(&q);
+    append_instance(answers, service_type);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 1);
+    EXPECT_EQ(answers.get_num_additional(), 3);
+}
+
+// Test that a typed question only gets the asked for type of its name
+TEST(MDNS_AnswerListTest, TypedQuestionGetsOnlyItsType)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    in6_addr ip6;
+    inet_pton(AF_INET6, "fe80::1", &ip6);
+    MDNS_AnswerList answers(ip4, ip6);
+
+    const auto srv = question(instance, RRType::SRV);
+    answers.set_question(&srv);
+    append_instance(answers, service_type);
+
+    const auto a = question(host, RRType::A);
+    answers.set_question(&a);
+    answers.append_host_addresses(host);
+    answers.write_additional_records();
+
+    // the SRV and the A record with the AAAA record of the SRV target as
+    // additional, the TXT and PTR records are left out
+    EXPECT_EQ(answers.get_num_answers(), 2);
+    EXPECT_EQ(answers.get_num_additional(), 1);
+    EXPECT_EQ(decode_types(answers.get_packet(0)),
+        (std::vector<RRType>{ RRType::SRV, RRType::A, RRType::AAAA }));
+}
+
+// Test that ANY is answered with every record of the name
+TEST(MDNS_AnswerListTest, AnyQuestionGetsAllTypes)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question(instance, RRType::ANY);
+    answers.set_question(&q);
+    append_instance(answers, service_type);
+    answers.write_additional_records();
+
+    // nothing points at the service type, its PTR is left out
+    EXPECT_EQ(answers.get_num_answers(), 2);
+    EXPECT_EQ(decode_types(answers.get_packet(0)),
+        (std::vector<RRType>{ RRType::TXT, RRType::SRV, RRType::A }));
+}
+
+// Test that a question without answers doesn't get additional records
+TEST(MDNS_AnswerListTest, UnansweredQuestionGetsNoAdditional)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question(service_type, RRType::SRV);
+    answers.set_question(&q);
+    append_instance(answers, q.name_list);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 0);
+    EXPECT_EQ(answers.get_num_additional(), 0);
+}
+
+// Test that records already in the list are not repeated as additional
+TEST(MDNS_AnswerListTest, DoesNotRepeatAdditionalRecords)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto browse = question(service_type, RRType::PTR);
+    answers.set_question(&browse);
+    append_instance(answers, browse.name_list);
+
+    const auto txt = question(instance, RRType::TXT);
+    answers.set_question(&txt);
+    append_instance(answers, service_type);
+    answers.write_additional_records();
+
+    // PTR and TXT answers, SRV and A once each
+    EXPECT_EQ(answers.get_num_answers(), 2);
+    EXPECT_EQ(answers.get_num_additional(), 2);
+}
+
+// Test that asking an IPv4 only host for AAAA gets the A record and an NSEC
+// saying there is no AAAA (RFC 6762 §6.1, §6.2)
+TEST(MDNS_AnswerListTest, NegativeResponseCarriesNSEC)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question(host, RRType::AAAA);
+    answers.set_question(&q);
+    answers.append_host_addresses(host);
+    answers.append_host_NSEC(host);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 0);
+    EXPECT_EQ(answers.get_num_additional(), 2);
+    const auto& pkt = answers.get_packet(0);
+    EXPECT_EQ(decode_types(pkt),
+        (std::vector<RRType>{ RRType::A, RRType::NSEC }));
+
+    // window block 0 with only the A bit set
+    ASSERT_GE(pkt.payload.size(), 3);
+    EXPECT_EQ(std::vector<uint8_t>(pkt.payload.end() - 3, pkt.payload.end()),
+        (std::vector<uint8_t>{ 0, 1, 0x40 }));
+}
+
+// Test that NSEC goes with the records of instances a browse points at
+TEST(MDNS_AnswerListTest, BrowseAddsNSECForInstanceAndHost)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const std::array instance_types{ RRType::TXT, RRType::SRV };
+    const auto q = question(service_type, RRType::PTR);
+    answers.set_question(&q);
+    append_instance(answers, q.name_list);
+    answers.append_NSEC(instance, instance_types);
+    answers.append_host_NSEC(host);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 1);
+    EXPECT_EQ(decode_types(answers.get_packet(0)),
+        (std::vector<RRType>{ RRType::PTR, RRType::TXT, RRType::SRV,
+            RRType::A, RRType::NSEC, RRType::NSEC }));
+}
+
+// Test that NSEC is an answer only when it was asked for
+TEST(MDNS_AnswerListTest, NSECQuestionGetsNSECAnswer)
+{
+    in_addr ip4;
+    inet_pton(AF_INET, "192.168.1.100", &ip4);
+    MDNS_AnswerList answers(ip4);
+
+    const auto q = question(host, RRType::NSEC);
+    answers.set_question(&q);
+    answers.append_host_addresses(host);
+    answers.append_host_NSEC(host);
+    answers.write_additional_records();
+
+    EXPECT_EQ(answers.get_num_answers(), 1);
+    EXPECT_EQ(answers.get_num_additional(), 0);
+}
+
+} // anonymous namespace
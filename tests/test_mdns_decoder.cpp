@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <mdns/MDNS_Header.hpp>
+
+#include "../src/mdns/MDNS_Decoder.hpp"
+#include "mdns_test_helpers.hpp"
+
+using namespace mdns;
+using namespace mdns::test;
+
+namespace
+{
+
+std::vector<uint8_t> query_header(uint16_t num_questions)
+{
+    return { 0x00, 0x00, 0x00, 0x00, static_cast<uint8_t>(num_questions >> 8),
+        static_cast<uint8_t>(num_questions), 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00 };
+}
+
+MDNS_Decoder decoder_for(const std::vector<uint8_t>& packet, size_t pos)
+{
+    return MDNS_Decoder(
+        packet.data(), packet.data() + packet.size(), packet.data() + pos);
+}
+
+// Test that a well formed question is decoded including the QU bit
+TEST(MDNS_DecoderTest, ReadsQuestion)
+{
+    auto packet = create_mdns_query_packet(
+        0, { "_http", "_tcp", "local" }, 33 /*SRV*/, 0x8001);
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    QuestionData question{};
+    ASSERT_TRUE(decoder.read_question(question));
+    EXPECT_EQ(question.name_list,
+        (std::vector<std::string>{ "_http", "_tcp", "local" }));
+    EXPECT_EQ(question.type, 33);
+    EXPECT_EQ(question.clazz, MDNS_class::IN);
+    EXPECT_TRUE(question.question_unicast);
+    EXPECT_EQ(decoder.get_position(), packet.data() + packet.size());
+}
+
+// Test that the records of a DNS-SD announcement are decoded
+TEST(MDNS_DecoderTest, ReadsServiceRecords)
+{
+    const auto packet = create_mdns_service_reply_packet(0,
+        { "_http", "_tcp", "local" }, "node", { "node", "local" }, 8080,
+        { "path=/", "flag" }, 0xC0A80132);
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    const auto ptr = decoder.read_record();
+    ASSERT_TRUE(ptr.has_value());
+    ASSERT_TRUE(ptr->PTR.has_value());
+    EXPECT_EQ(ptr->PTR->front(), "node");
+
+    const auto srv = decoder.read_record();
+    ASSERT_TRUE(srv.has_value());
+    ASSERT_TRUE(srv->SRV.has_value());
+    EXPECT_EQ(srv->SRV->port, 8080);
+    EXPECT_EQ(srv->SRV->name_list,
+        (std::vector<std::string>{ "node", "local" }));
+
+    const auto txt = decoder.read_record();
+    ASSERT_TRUE(txt.has_value());
+    ASSERT_TRUE(txt->TXT.has_value());
+    EXPECT_EQ(txt->TXT->at("path"), "/");
+    EXPECT_EQ(txt->TXT->at("flag"), "");
+
+    const auto a = decoder.read_record();
+    ASSERT_TRUE(a.has_value());
+    EXPECT_TRUE(a->A.has_value());
+}
+
+// Test that a pointer to itself is rejected instead of looping
+TEST(MDNS_DecoderTest, RejectsSelfPointer)
+{
+    auto packet = query_header(1);
+    packet.insert(packet.end(), { 0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    QuestionData question{};
+    EXPECT_FALSE(decoder.read_question(question));
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::BAD_POINTER);
+}
+
+// Test that a pointer to a later part of the packet is rejected
+TEST(MDNS_DecoderTest, RejectsForwardPointer)
+{
+    auto packet = query_header(1);
+    packet.insert(packet.end(), { 0xC0, 0x0E, 0x01, 'a', 0x00 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    name_list_t name;
+    EXPECT_FALSE(decoder.read_name(name));
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::BAD_POINTER);
+}
+
+// Test that a long chain of backward pointers is cut off
+TEST(MDNS_DecoderTest, LimitsPointerHops)
+{
+    // "a" at 12, then each pointer refers to the one before it
+    auto packet = query_header(1);
+    packet.insert(packet.end(), { 0x01, 'a', 0x00 });
+    size_t target = 12;
+    for (size_t i = 0; i < MDNS_Decoder::MAX_POINTER_HOPS + 1; i++)
+    {
+        const auto pos = packet.size();
+        packet.push_back(static_cast<uint8_t>(0xC0 | (target >> 8)));
+        packet.push_back(static_cast<uint8_t>(target));
+        target = pos;
+    }
+
+    name_list_t name;
+    auto short_chain = decoder_for(packet, 15 + 2 * 3);
+    EXPECT_TRUE(short_chain.read_name(name));
+    EXPECT_EQ(name, (std::vector<std::string>{ "a" }));
+
+    auto long_chain = decoder_for(packet, target);
+    EXPECT_FALSE(long_chain.read_name(name));
+    EXPECT_EQ(long_chain.get_error(),
+        MDNS_MalformedReason::TOO_MANY_POINTER_HOPS);
+}
+
+// Test that names beyond 255 bytes are rejected
+TEST(MDNS_DecoderTest, RejectsNameTooLong)
+{
+    auto packet = query_header(1);
+    for (int i = 0; i < 5; i++)
+    {
+        packet.push_back(60);
+        packet.insert(packet.end(), 60, 'x');
+    }
+    packet.insert(packet.end(), { 0x00, 0x00, 0x01, 0x00, 0x01 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    name_list_t name;
+    EXPECT_FALSE(decoder.read_name(name));
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::NAME_TOO_LONG);
+}
+
+// Test that the reserved label types are rejected
+TEST(MDNS_DecoderTest, RejectsExtendedLabel)
+{
+    auto packet = query_header(1);
+    packet.insert(packet.end(), { 0x41, 'a', 0x00 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    name_list_t name;
+    EXPECT_FALSE(decoder.read_name(name));
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::BAD_LABEL);
+}
+
+// Test that a question without QTYPE/QCLASS is rejected
+TEST(MDNS_DecoderTest, RejectsTruncatedQuestion)
+{
+    auto packet = query_header(1);
+    packet.insert(packet.end(), { 0x04, 't', 'e', 's', 't', 0x00, 0x00 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    QuestionData question{};
+    EXPECT_FALSE(decoder.read_question(question));
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::TRUNCATED);
+}
+
+// Test that RDLENGTH can't reach beyond the packet
+TEST(MDNS_DecoderTest, RejectsRdataOverrun)
+{
+    auto packet = query_header(0);
+    packet.insert(packet.end(),
+        { 0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x7D, 0x00,
+            0x03, 'a', 'b', 'c' });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    EXPECT_FALSE(decoder.read_record().has_value());
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::RDATA_OVERRUN);
+}
+
+// Test that an A record must carry exactly 4 bytes
+TEST(MDNS_DecoderTest, RejectsShortAddress)
+{
+    auto packet = query_header(0);
+    packet.insert(packet.end(),
+        { 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x03,
+            192, 168, 1 });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    EXPECT_FALSE(decoder.read_record().has_value());
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::BAD_RDATA);
+}
+
+// Test that TXT strings can't run past their RDATA
+TEST(MDNS_DecoderTest, RejectsTxtOverrun)
+{
+    auto packet = query_header(0);
+    packet.insert(packet.end(),
+        { 0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x02,
+            0x05, 'a', 'b', 'c', 'd', 'e' });
+    auto decoder = decoder_for(packet, sizeof(MDNS_Header));
+
+    EXPECT_FALSE(decoder.read_record().has_value());
+    EXPECT_EQ(decoder.get_error(), MDNS_MalformedReason::BAD_RDATA);
+}
+
+} // anonymous namespace
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <mdns/DNSName.hpp>
+
+#include "../src/mdns/MDNS_Decoder.hpp"
+#include "mdns_test_helpers.hpp"
+
+using namespace mdns;
+
+namespace
+{
+
+static_assert(mdns_name<"_http._tcp.local">.name.size() == 3);
+static_assert(mdns_name<"_http._tcp.local">.name[1] == "_tcp");
+static_assert(mdns_name<"fanode.local.">.name.back() == "local");
+static_assert(mdns_name<"FaNode.LOCAL">.canonical_hash ==
+    mdns_name<"fanode.local">.canonical_hash);
+static_assert(mdns_name<"fanode.local">.canonical_hash !=
+    mdns_name<"fanode.locals">.canonical_hash);
+
+// Test that labels are stored in wire format and read back as views
+TEST(DNSNameTest, StoresLabelsInWireFormat)
+{
+    const DNSName name{ "fanode", "local" };
+
+    ASSERT_EQ(name.size(), 2);
+    EXPECT_EQ(name.front(), "fanode");
+    EXPECT_EQ(name.back(), "local");
+    EXPECT_EQ(name.to_string(), "fanode.local");
+
+    const auto wire = name.get_wire_labels();
+    const std::vector<uint8_t> expected{ 6, 'f', 'a', 'n', 'o', 'd', 'e', 5,
+        'l', 'o', 'c', 'a', 'l' };
+    EXPECT_EQ(std::vector<uint8_t>(wire.begin(), wire.end()), expected);
+
+    std::vector<std::string> labels;
+    for (const auto label : name)
+    {
+        labels.emplace_back(label);
+    }
+    EXPECT_EQ(labels, name.to_vector());
+}
+
+// Test that names compare equal to the string vectors they replace
+TEST(DNSNameTest, ComparesWithStringVectors)
+{
+    const DNSName name{ "_http", "_tcp", "local" };
+
+    EXPECT_EQ(name, (std::vector<std::string>{ "_http", "_tcp", "local" }));
+    EXPECT_NE(name, (std::vector<std::string>{ "_http", "_tcp" }));
+    EXPECT_NE(name, (DNSName{ "_http", "_udp", "local" }));
+}
+
+// Test that canonical equality ignores the case of letters only
+TEST(DNSNameTest, ComparesCanonicallyIgnoringCase)
+{
+    const DNSName name{ "_http", "_tcp", "local" };
+    const DNSName upper{ "_HTTP", "_Tcp", "LOCAL" };
+
+    EXPECT_TRUE(name.equals_canonical(upper));
+    EXPECT_EQ(name.get_canonical_hash(), upper.get_canonical_hash());
+    EXPECT_NE(name, upper);
+    EXPECT_FALSE(name.equals_canonical({ "_http", "_tcp", "locals" }));
+    EXPECT_FALSE(name.equals_canonical({ "_http", "_udp", "local" }));
+    EXPECT_FALSE(DNSName({ "a@" }).equals_canonical(DNSName({ "a`" })));
+    EXPECT_TRUE(upper.matches({ "*", "_tcp", "local" }));
+}
+
+// Test that a "*" label of the pattern matches any label
+TEST(DNSNameTest, MatchesWildcards)
+{
+    const DNSName name{ "registry", "_nmos-register", "_tcp", "local" };
+
+    EXPECT_TRUE(name.matches({ "*", "_nmos-register", "_tcp", "local" }));
+    EXPECT_FALSE(name.matches({ "*", "_nmos-query", "_tcp", "local" }));
+    EXPECT_FALSE(name.matches({ "*", "_tcp", "local" }));
+}
+
+// Test that labels and names beyond the RFC 1035 limits are rejected
+TEST(DNSNameTest, RejectsOversizedLabels)
+{
+    DNSName name;
+    EXPECT_FALSE(name.push_back(""));
+    EXPECT_FALSE(name.push_back(std::string(64, 'x')));
+    EXPECT_TRUE(name.push_back(std::string(63, 'x')));
+
+    // 4 * 64 bytes plus the root label is more than 255
+    EXPECT_TRUE(name.push_back(std::string(63, 'x')));
+    EXPECT_TRUE(name.push_back(std::string(63, 'x')));
+    EXPECT_FALSE(name.push_back(std::string(63, 'x')));
+    EXPECT_TRUE(name.push_back(std::string(61, 'x')));
+    EXPECT_EQ(name.get_wire_labels().size(), DNSName::MAX_WIRE_LENGTH - 1);
+    EXPECT_FALSE(name.append(DNSName{ "a" }));
+    EXPECT_EQ(name.size(), 4);
+}
+
+// Test that names built from input are all or nothing
+TEST(DNSNameTest, BuildsFromLabelsOrFails)
+{
+    const std::vector<std::string> labels{ "node", "_http", "_tcp", "local" };
+    const auto name = DNSName::from_labels(labels);
+    ASSERT_TRUE(name.has_value());
+    EXPECT_EQ(name.value(), labels);
+
+    const std::vector<std::string> long_label{ std::string(64, 'x'), "local" };
+    EXPECT_FALSE(DNSName::from_labels(long_label).has_value());
+
+    const std::vector<std::string> long_name(5, std::string(63, 'x'));
+    EXPECT_FALSE(DNSName::from_labels(long_name).has_value());
+}
+
+// Test that a name listed in code that doesn't fit is flagged, not cut
+// silently
+TEST(DNSNameTest, FlagsOversizedInitializerList)
+{
+    EXPECT_TRUE((DNSName{ "node", "local" }.valid()));
+
+    const std::string long_label(64, 'x');
+    const DNSName bad_label{ "node", long_label, "local" };
+    EXPECT_FALSE(bad_label.valid());
+    EXPECT_EQ(bad_label.size(), 1);
+
+    const std::string label(63, 'x');
+    const DNSName too_long{ label, label, label, label };
+    EXPECT_FALSE(too_long.valid());
+
+    DNSName name{ "node" };
+    EXPECT_FALSE(name.append(bad_label));
+    EXPECT_EQ(name.size(), 1);
+}
+
+// Test that names are concatenated and shortened label by label
+TEST(DNSNameTest, AppendsAndPopsLabels)
+{
+    DNSName name{ "node" };
+    ASSERT_TRUE(name.append({ "_http", "_tcp", "local" }));
+    EXPECT_EQ(name, (DNSName{ "node", "_http", "_tcp", "local" }));
+    EXPECT_EQ(name[2], "_tcp");
+
+    name.pop_back();
+    EXPECT_EQ(name, (DNSName{ "node", "_http", "_tcp" }));
+
+    name.clear();
+    EXPECT_TRUE(name.empty());
+    EXPECT_EQ(name, DNSName{});
+}
+
+// Test that literals compare against names decoded from a packet
+TEST(DNSNameTest, LiteralMatchesDecodedName)
+{
+    const auto packet = test::create_mdns_query_packet(
+        0, { "_ravenna", "_sub", "_http", "_tcp", "local" });
+    MDNS_Decoder decoder(packet.data(), packet.data() + packet.size(),
+        packet.data() + sizeof(MDNS_Header));
+
+    QuestionData question{};
+    ASSERT_TRUE(decoder.read_question(question));
+    EXPECT_TRUE(question.equals(mdns_name<"_ravenna._sub._http._tcp.local">));
+    EXPECT_FALSE(question.equals(mdns_name<"_ravenna._sub._rtsp._tcp.local">));
+    EXPECT_EQ(question.name_list.get_canonical_hash(),
+        mdns_name<"_ravenna._sub._http._tcp.local">.canonical_hash);
+}
+
+} // anonymous namespace
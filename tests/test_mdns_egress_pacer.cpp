@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <mdns/MDNS_EgressPacer.hpp>
+
+using namespace mdns;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// a datagram of 500 bytes
+const std::array<uint8_t, 12> header{};
+const std::vector<uint8_t> payload(488, 0x55);
+
+MDNS_EgressLimit limit(uint32_t packets_per_sec, uint64_t bytes_per_sec)
+{
+    return MDNS_EgressLimit{ .bytes_per_sec = bytes_per_sec,
+        .packets_per_sec = packets_per_sec,
+        .burst_bytes = 1000,
+        .burst_packets = 2,
+        .max_queue_delay = 500ms };
+}
+
+struct Sent
+{
+    std::vector<size_t> listeners;
+
+    bool operator()(size_t listener_ix, std::span<const uint8_t>)
+    {
+        listeners.push_back(listener_ix);
+        return true;
+    }
+};
+
+// Test that the burst goes out right away and the rest waits for tokens
+TEST(MDNS_EgressPacerTest, SendsBurstThenPaces)
+{
+    MDNS_EgressPacer pacer(limit(10, 0));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    EXPECT_FALSE(pacer.try_send(500, t0));
+    EXPECT_EQ(pacer.push(0, header, payload, t0),
+        MDNS_EgressPacer::Result::QUEUED);
+
+    // nothing overtakes a queued packet
+    EXPECT_FALSE(pacer.try_send(500, t0 + 1s));
+
+    Sent sent;
+    pacer.drain(t0 + 50ms, std::ref(sent));
+    EXPECT_TRUE(sent.listeners.empty());
+    pacer.drain(t0 + 100ms, std::ref(sent));
+    EXPECT_EQ(sent.listeners.size(), 1);
+    EXPECT_TRUE(pacer.empty());
+    EXPECT_EQ(pacer.get_num_paced(), 1);
+}
+
+// Test that the pacer tells when the queued packet has enough tokens
+TEST(MDNS_EgressPacerTest, ReportsNextSend)
+{
+    MDNS_EgressPacer pacer(limit(10, 5000));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+    EXPECT_EQ(
+        pacer.get_next_send(t0), MDNS_EgressPacer::clock::time_point::max());
+
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    pacer.push(0, header, payload, t0);
+    EXPECT_EQ(pacer.get_next_send(t0), t0 + 100ms);
+
+    // the tokens are there by then, but that is no time in the past
+    EXPECT_EQ(pacer.get_next_send(t0 + 1s), t0 + 1s);
+
+    Sent sent;
+    pacer.drain(pacer.get_next_send(t0), std::ref(sent));
+    EXPECT_EQ(sent.listeners.size(), 1);
+}
+
+// Test that a packet the buckets allow but that fails to send is retried
+// after an interval rather than right away
+TEST(MDNS_EgressPacerTest, BacksOffAfterFailedSend)
+{
+    MDNS_EgressPacer pacer(limit(10, 0));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+    pacer.try_send(500, t0);
+    pacer.try_send(500, t0);
+    pacer.push(0, header, payload, t0);
+
+    const auto t1 = t0 + 200ms;
+    pacer.drain(t1, [](size_t, std::span<const uint8_t>) { return false; });
+    EXPECT_FALSE(pacer.empty());
+    EXPECT_EQ(pacer.get_next_send(t1),
+        t1 + MDNS_EgressPacer::SEND_RETRY_INTERVAL);
+
+    Sent sent;
+    pacer.drain(pacer.get_next_send(t1), std::ref(sent));
+    EXPECT_EQ(sent.listeners.size(), 1);
+    EXPECT_TRUE(pacer.empty());
+}
+
+// Test that the byte limit holds even when packets are allowed
+TEST(MDNS_EgressPacerTest, LimitsBytes)
+{
+    MDNS_EgressPacer pacer(limit(0, 5000));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    EXPECT_TRUE(pacer.try_send(500, t0));
+    EXPECT_FALSE(pacer.try_send(500, t0));
+    EXPECT_FALSE(pacer.try_send(500, t0 + 99ms));
+    EXPECT_TRUE(pacer.try_send(500, t0 + 100ms));
+}
+
+// Test that a packet already waiting is not queued twice
+TEST(MDNS_EgressPacerTest, CoalescesDuplicates)
+{
+    MDNS_EgressPacer pacer(limit(10, 0));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+    pacer.try_send(500, t0);
+    pacer.try_send(500, t0);
+
+    const std::vector<uint8_t> other(488, 0x66);
+    EXPECT_EQ(pacer.push(0, header, payload, t0),
+        MDNS_EgressPacer::Result::QUEUED);
+    EXPECT_EQ(pacer.push(0, header, payload, t0),
+        MDNS_EgressPacer::Result::COALESCED);
+    EXPECT_EQ(pacer.push(1, header, payload, t0),
+        MDNS_EgressPacer::Result::QUEUED);
+    EXPECT_EQ(pacer.push(0, header, other, t0),
+        MDNS_EgressPacer::Result::QUEUED);
+    EXPECT_EQ(pacer.get_num_coalesced(), 1);
+}
+
+// Test that packets which waited too long or don't fit are dropped
+TEST(MDNS_EgressPacerTest, DropsStaleAndOverflowingPackets)
+{
+    MDNS_EgressPacer pacer(limit(1, 0));
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+    pacer.try_send(500, t0);
+    pacer.try_send(500, t0);
+
+    for (size_t i = 0; i < MDNS_EgressPacer::MAX_QUEUED; i++)
+    {
+        EXPECT_EQ(pacer.push(i, header, payload, t0),
+            MDNS_EgressPacer::Result::QUEUED);
+    }
+    EXPECT_EQ(pacer.push(0, header, {}, t0),
+        MDNS_EgressPacer::Result::DROPPED);
+
+    Sent sent;
+    pacer.drain(t0 + 2s, std::ref(sent));
+    EXPECT_TRUE(sent.listeners.empty());
+    EXPECT_TRUE(pacer.empty());
+    EXPECT_EQ(pacer.get_num_dropped(), MDNS_EgressPacer::MAX_QUEUED + 1);
+}
+
+// Test that no limit lets everything through
+TEST(MDNS_EgressPacerTest, UnlimitedSendsEverything)
+{
+    MDNS_EgressPacer pacer(MDNS_EgressLimit::unlimited());
+    const MDNS_EgressPacer::clock::time_point t0{ 1s };
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_TRUE(pacer.try_send(1500, t0));
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <mdns/MDNS_HotLog.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+using namespace mdns;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Test that a call site emits a burst per interval and then reports how
+// many messages it suppressed
+TEST(MDNS_HotLogTest, RateLimitsPerCallSite)
+{
+    MDNS_LogSite site(1s, 2);
+    const auto now = MDNS_LogSite::clock::now();
+
+    uint64_t num_suppressed = 0;
+    EXPECT_TRUE(site.should_log(now, num_suppressed));
+    EXPECT_TRUE(site.should_log(now, num_suppressed));
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_FALSE(site.should_log(now + 100ms, num_suppressed));
+    }
+
+    EXPECT_TRUE(site.should_log(now + 1500ms, num_suppressed));
+    EXPECT_EQ(num_suppressed, 10);
+}
+
+// Test that sampling lets every n'th message through once the burst is used
+TEST(MDNS_HotLogTest, SamplesBeyondBurst)
+{
+    MDNS_LogSite site(1s, 1, 3);
+    const auto now = MDNS_LogSite::clock::now();
+
+    uint64_t num_suppressed = 0;
+    int num_emitted = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        num_emitted += site.should_log(now, num_suppressed) ? 1 : 0;
+    }
+    // the burst message plus messages 1, 4 and 7 after it
+    EXPECT_EQ(num_emitted, 4);
+}
+
+// Test that arguments are not evaluated when the level is disabled
+TEST(MDNS_HotLogTest, DoesNotFormatDisabledLevels)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    int num_evaluated = 0;
+    const auto expensive = [&num_evaluated]() {
+        num_evaluated++;
+        return std::string("expensive");
+    };
+
+    set_hot_log_level(MDNS_LogLevel::ERROR);
+    MDNS_HOT_LOG_INFO(logger, "value: {}", expensive());
+    EXPECT_EQ(num_evaluated, 0);
+
+    set_hot_log_level(MDNS_LogLevel::INFO);
+    MDNS_HOT_LOG_INFO(logger, "value: {}", expensive());
+    EXPECT_EQ(num_evaluated, 1);
+}
+
+} // anonymous namespace
@@ -0,0 +1,218 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_Header.hpp>
+#include <mdns/MDNS_NMOS_HTTP_Handler.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+#include "../iuring/tests/iuring_mocks.hpp"
+#include "../src/mdns/MDNS_Decoder.hpp"
+#include "mdns_service_setup.hpp"
+#include "mdns_test_helpers.hpp"
+
+using namespace testing;
+using namespace mdns;
+using namespace mdns::test;
+
+namespace
+{
+
+class MockAnswerList : public IAnswerList
+{
+public:
+    MOCK_METHOD(void, append_PTR,
+        (const name_list_t& name, const name_list_t& value), (override));
+    MOCK_METHOD(void, append_TXT,
+        (const name_list_t& name, const std::string& txt), (override));
+    MOCK_METHOD(void, append_TXT,
+        (const name_list_t& name, std::span<const std::string> strings),
+        (override));
+    MOCK_METHOD(void, append_TXT_rdata,
+        (const name_list_t& name, std::string_view rdata), (override));
+    MOCK_METHOD(void, append_SRV,
+        (const name_list_t& name, const name_list_t& hostname_list,
+            uint16_t port),
+        (override));
+    MOCK_METHOD(void, append_A, (const name_list_t& name, const in_addr& addr),
+        (override));
+    MOCK_METHOD(void, append_AAAA,
+        (const name_list_t& name, const in6_addr& addr), (override));
+    MOCK_METHOD(
+        void, append_host_addresses, (const name_list_t& name), (override));
+    MOCK_METHOD(void, append_NSEC,
+        (const name_list_t& name, std::span<const RRType> types),
+        (override));
+    MOCK_METHOD(void, append_host_NSEC, (const name_list_t& name), (override));
+};
+
+// Test that a counter change re-renders the TXT records and asks for an
+// unsolicited announcement
+TEST(MDNS_NMOS_HTTP_HandlerTest, CounterChangeTriggersAnnouncement)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    auto network = std::make_shared<iuring::mocks::IOUring>();
+    iuring::NetworkAdapter adapter(logger, "eth0", false);
+    FakeNMOS_Service nmos;
+
+    MDNS_NMOS_HTTP_Handler handler(network, logger, nmos, adapter);
+
+    int num_announcements = 0;
+    handler.set_announcer([&](IMDNS_Handler&) { num_announcements++; });
+
+    nmos.add_sender();
+    nmos.add_sender();
+    EXPECT_EQ(num_announcements, 2);
+
+    NiceMock<MockAnswerList> answers;
+    std::vector<std::string> txt;
+    EXPECT_CALL(answers,
+        append_TXT(ElementsAre("fanode", "_nmos-node", "_tcp", "local"),
+            An<std::span<const std::string>>()))
+        .WillOnce([&](const name_list_t&, std::span<const std::string> s) {
+            txt.assign(s.begin(), s.end());
+        });
+    handler.append_announcement(answers);
+    EXPECT_THAT(txt, Contains("ver_snd=2"));
+}
+
+// Test that the node is published as an instance the PTR points at, with
+// the records of the instance and its host
+TEST(MDNS_NMOS_HTTP_HandlerTest, PublishesNodeInstance)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    auto network = std::make_shared<iuring::mocks::IOUring>();
+    iuring::NetworkAdapter adapter(logger, "eth0", false);
+    FakeNMOS_Service nmos;
+
+    MDNS_NMOS_HTTP_Handler handler(
+        network, logger, nmos, adapter, "studio-n", 3000);
+
+    StrictMock<MockAnswerList> answers;
+    EXPECT_CALL(answers,
+        append_PTR(ElementsAre("_nmos-node", "_tcp", "local"),
+            ElementsAre("studio-n", "_nmos-node", "_tcp", "local")));
+    EXPECT_CALL(answers,
+        append_SRV(ElementsAre("studio-n", "_nmos-node", "_tcp", "local"),
+            ElementsAre("studio-n", "local"), 3000));
+    EXPECT_CALL(answers,
+        append_TXT(ElementsAre("studio-n", "_nmos-node", "_tcp", "local"),
+            An<std::span<const std::string>>()));
+    EXPECT_CALL(
+        answers, append_host_addresses(ElementsAre("studio-n", "local")));
+    std::vector<RRType> instance_types;
+    EXPECT_CALL(answers,
+        append_NSEC(ElementsAre("studio-n", "_nmos-node", "_tcp", "local"), _))
+        .WillOnce([&](const name_list_t&, std::span<const RRType> types) {
+            instance_types.assign(types.begin(), types.end());
+        });
+    EXPECT_CALL(answers, append_host_NSEC(ElementsAre("studio-n", "local")));
+
+    const QuestionData q{ name_list_t{ "_nmos-node", "_tcp", "local" },
+        static_cast<uint16_t>(RRType::PTR), MDNS_class::IN, false };
+    EXPECT_EQ(handler.handle_question(q, answers), MDNS_IsHandled::IS_HANDLED);
+    EXPECT_EQ(instance_types, (std::vector{ RRType::TXT, RRType::SRV }));
+}
+
+// Test that a browse for NMOS nodes gets the PTR to the node instance on
+// the wire, with its SRV, TXT, address and NSEC records as additional
+// records
+TEST(MDNS_NMOS_HTTP_HandlerTest, AnswersNodeBrowseOnTheWire)
+{
+    MDNS_ServiceSetup setup;
+    const auto packet =
+        create_mdns_query_packet(0, { "_nmos-node", "_tcp", "local" });
+    const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+        iuring::IPAddress::parse("192.168.1.50").value());
+    MDNS_ServiceProbe::receive(*setup.service, msg);
+
+    const auto datagrams = MDNS_ServiceProbe::answer_to_wire(*setup.service);
+    ASSERT_EQ(datagrams.size(), 1);
+    const auto& data = datagrams.front();
+    ASSERT_GE(data.size(), sizeof(MDNS_Header));
+    const auto* hdr = reinterpret_cast<const MDNS_Header*>(data.data());
+    EXPECT_EQ(hdr->get_num_answers(), 1);
+    EXPECT_EQ(hdr->get_num_additional(), 5);
+
+    MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+        data.data() + sizeof(MDNS_Header));
+    const name_list_t instance{ "fanode", "_nmos-node", "_tcp", "local" };
+    const name_list_t host{ "fanode", "local" };
+
+    const auto ptr = decoder.read_record();
+    ASSERT_TRUE(ptr && ptr->PTR);
+    EXPECT_EQ(ptr->name_list, (name_list_t{ "_nmos-node", "_tcp", "local" }));
+    EXPECT_EQ(ptr->PTR.value(), instance);
+
+    const auto srv = decoder.read_record();
+    ASSERT_TRUE(srv && srv->SRV);
+    EXPECT_EQ(srv->name_list, instance);
+    EXPECT_EQ(srv->SRV->name_list, host);
+
+    const auto txt = decoder.read_record();
+    ASSERT_TRUE(txt && txt->TXT);
+    EXPECT_EQ(txt->name_list, instance);
+    EXPECT_EQ(txt->TXT->at("api_proto"), "http");
+    EXPECT_EQ(txt->TXT->at("api_ver"), "v1.3");
+    EXPECT_EQ(txt->TXT->at("ver_snd"), "0");
+
+    const auto a = decoder.read_record();
+    ASSERT_TRUE(a && a->A);
+    EXPECT_EQ(a->name_list, host);
+    EXPECT_EQ(a->A->to_human_readable_ip_string(), "192.168.1.100");
+
+    const auto instance_nsec = decoder.read_record();
+    ASSERT_TRUE(instance_nsec);
+    EXPECT_EQ(instance_nsec->get_type(), RRType::NSEC);
+    EXPECT_EQ(instance_nsec->name_list, instance);
+
+    const auto host_nsec = decoder.read_record();
+    ASSERT_TRUE(host_nsec);
+    EXPECT_EQ(host_nsec->get_type(), RRType::NSEC);
+    EXPECT_EQ(host_nsec->name_list, host);
+    EXPECT_EQ(decoder.get_position(), data.data() + data.size());
+}
+
+// Test that asking for the AAAA record of the node's IPv4-only host gets a
+// negative response: no answer, the A record and an NSEC that lists A only
+TEST(MDNS_NMOS_HTTP_HandlerTest, DeniesMissingAddressFamilyOnTheWire)
+{
+    MDNS_ServiceSetup setup;
+    const auto packet = create_mdns_query_packet(0, { "fanode", "local" },
+        static_cast<uint16_t>(RRType::AAAA));
+    const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+        iuring::IPAddress::parse("192.168.1.50").value());
+    MDNS_ServiceProbe::receive(*setup.service, msg);
+
+    const auto datagrams = MDNS_ServiceProbe::answer_to_wire(*setup.service);
+    ASSERT_EQ(datagrams.size(), 1);
+    const auto& data = datagrams.front();
+    ASSERT_GE(data.size(), sizeof(MDNS_Header));
+    const auto* hdr = reinterpret_cast<const MDNS_Header*>(data.data());
+    EXPECT_EQ(hdr->get_num_answers(), 0);
+    EXPECT_EQ(hdr->get_num_additional(), 2);
+
+    MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+        data.data() + sizeof(MDNS_Header));
+    const name_list_t host{ "fanode", "local" };
+
+    const auto a = decoder.read_record();
+    ASSERT_TRUE(a && a->A);
+    EXPECT_EQ(a->name_list, host);
+
+    const auto nsec = decoder.read_record();
+    ASSERT_TRUE(nsec);
+    EXPECT_EQ(nsec->get_type(), RRType::NSEC);
+    EXPECT_EQ(nsec->name_list, host);
+    // window 0, one byte of bitmap with only the bit of A (type 1) set
+    ASSERT_GE(nsec->payload.size(), 3);
+    EXPECT_EQ(nsec->payload.substr(nsec->payload.size() - 3),
+        std::string("\x00\x01\x40", 3));
+    EXPECT_EQ(decoder.get_position(), data.data() + data.size());
+}
+
+} // anonymous namespace
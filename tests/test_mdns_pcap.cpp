@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_Pcap.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+#include "mdns_test_helpers.hpp"
+
+using namespace mdns;
+using namespace mdns::test;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+class MDNS_PcapTest : public ::testing::Test
+{
+protected:
+    MDNS_PcapTest()
+        : logger(true, true, logging::LogOutput::CONSOLE)
+        , path(std::filesystem::temp_directory_path() /
+              ("mdns_pcap_test_" + std::to_string(::getpid()) + ".pcap"))
+    {
+    }
+
+    ~MDNS_PcapTest() override
+    {
+        std::filesystem::remove(path);
+    }
+
+    logging::DirectConsoleLogger logger;
+    std::filesystem::path path;
+};
+
+// Test that datagrams written by the capture come back unchanged, with
+// their source, source port and timestamp
+TEST_F(MDNS_PcapTest, WriteReadRoundTrip)
+{
+    const auto query =
+        create_mdns_query_packet(0x1234, { "_http", "_tcp", "local" });
+    const auto reply = create_mdns_reply_packet(
+        0x5678, { "_http", "_tcp", "local" }, { "myservice", "local" });
+    in_addr addr4{};
+    ASSERT_EQ(inet_pton(AF_INET, "192.168.1.50", &addr4), 1);
+    // a one-shot querier (RFC 6762 §5.1) sends from an ephemeral port
+    const iuring::IPAddress source4(
+        addr4, static_cast<iuring::SocketPortID>(49152));
+    const auto source6 = iuring::IPAddress::parse("fe80::1").value();
+    const std::chrono::system_clock::time_point t0(1700000000s);
+
+    {
+        auto writer = MDNS_PcapWriter::create(path.string(), logger);
+        ASSERT_TRUE(writer);
+        writer->write(
+            iuring::ReceivedMessage(query.data(), query.size(), source4),
+            iuring::IPAddress::parse("224.0.0.251").value(), t0);
+        writer->write(
+            iuring::ReceivedMessage(reply.data(), reply.size(), source6),
+            iuring::IPAddress::parse("ff02::fb").value(), t0 + 1500us);
+        writer->flush();
+        EXPECT_EQ(writer->get_num_written(), 2);
+    }
+
+    auto reader = MDNS_PcapReader::open(path.string(), logger);
+    ASSERT_TRUE(reader);
+
+    auto first = reader->next();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->payload, query);
+    EXPECT_EQ(first->source.to_human_readable_ip_string(), "192.168.1.50");
+    EXPECT_EQ(first->source_port, 49152);
+    EXPECT_EQ(first->timestamp, t0.time_since_epoch());
+
+    auto second = reader->next();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->payload, reply);
+    EXPECT_EQ(second->source.to_human_readable_ip_string(), "fe80::1");
+    EXPECT_EQ(second->timestamp - first->timestamp, 1500us);
+
+    EXPECT_FALSE(reader->next().has_value());
+    EXPECT_EQ(reader->get_num_skipped(), 0);
+}
+
+// Test that a datagram larger than a ring slot is dropped, not truncated
+TEST_F(MDNS_PcapTest, DropsOversizedDatagrams)
+{
+    const std::vector<uint8_t> packet(MDNS_PcapWriter::MAX_DATAGRAM_SIZE + 1);
+    const auto source = iuring::IPAddress::parse("192.168.1.50").value();
+    {
+        auto writer = MDNS_PcapWriter::create(path.string(), logger);
+        ASSERT_TRUE(writer);
+        EXPECT_FALSE(writer->write(
+            iuring::ReceivedMessage(packet.data(), packet.size(), source),
+            iuring::IPAddress::parse("224.0.0.251").value()));
+        writer->flush();
+        EXPECT_EQ(writer->get_num_dropped(), 1);
+        EXPECT_EQ(writer->get_num_written(), 0);
+    }
+
+    auto reader = MDNS_PcapReader::open(path.string(), logger);
+    ASSERT_TRUE(reader);
+    EXPECT_FALSE(reader->next().has_value());
+}
+
+// Test that replay delivers every datagram of the capture
+TEST_F(MDNS_PcapTest, ReplayDeliversAll)
+{
+    const auto query =
+        create_mdns_query_packet(0, { "_http", "_tcp", "local" });
+    const auto source = iuring::IPAddress::parse("192.168.1.50").value();
+    {
+        auto writer = MDNS_PcapWriter::create(path.string(), logger);
+        ASSERT_TRUE(writer);
+        for (int i = 0; i < 5; i++)
+        {
+            writer->write(
+                iuring::ReceivedMessage(query.data(), query.size(), source),
+                iuring::IPAddress::parse("224.0.0.251").value());
+        }
+    }
+
+    auto reader = MDNS_PcapReader::open(path.string(), logger);
+    ASSERT_TRUE(reader);
+    size_t num_received = 0;
+    const auto n = replay_capture(*reader, MDNS_ReplaySpeed::MAXIMUM,
+        [&](const iuring::ReceivedMessage& msg) {
+            EXPECT_EQ(msg.get_size(), query.size());
+            num_received++;
+        });
+    EXPECT_EQ(n, 5);
+    EXPECT_EQ(num_received, 5);
+}
+
+// Test that a file that isn't a capture is rejected
+TEST_F(MDNS_PcapTest, RejectsGarbage)
+{
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "this is not a capture file";
+    }
+    EXPECT_FALSE(MDNS_PcapReader::open(path.string(), logger));
+    EXPECT_FALSE(MDNS_PcapReader::open(
+        (path.parent_path() / "does_not_exist.pcap").string(), logger));
+}
+
+} // anonymous namespace
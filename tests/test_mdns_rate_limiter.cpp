@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+
+#include <mdns/MDNS_RateLimiter.hpp>
+
+using namespace mdns;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Test that a record is let through once per interval
+TEST(MDNS_RateLimiterTest, AllowsOncePerInterval)
+{
+    MDNS_RateLimiter limiter;
+    const MDNS_RateLimiter::clock::time_point now;
+
+    EXPECT_TRUE(limiter.allow(42, now));
+    EXPECT_FALSE(limiter.allow(42, now + 999ms));
+    EXPECT_TRUE(limiter.allow(7, now + 999ms));
+    EXPECT_TRUE(limiter.allow(42, now + 1s));
+    EXPECT_EQ(limiter.get_num_suppressed(), 1);
+    EXPECT_EQ(limiter.get_num_entries(), 2);
+}
+
+// Test that key 0 is a record like any other
+TEST(MDNS_RateLimiterTest, LimitsKeyZero)
+{
+    MDNS_RateLimiter limiter;
+    const MDNS_RateLimiter::clock::time_point now;
+
+    EXPECT_TRUE(limiter.allow(0, now));
+    EXPECT_FALSE(limiter.allow(0, now));
+}
+
+// Test that the table doesn't grow beyond its capacity: expired entries are
+// reused and live ones evicted oldest first once all slots in reach are
+// taken
+TEST(MDNS_RateLimiterTest, StaysWithinCapacity)
+{
+    MDNS_RateLimiter limiter(64);
+    ASSERT_EQ(limiter.get_capacity(), 64);
+    const MDNS_RateLimiter::clock::time_point now;
+
+    for (uint64_t key = 1; key <= 10'000; key++)
+    {
+        EXPECT_TRUE(limiter.allow(key, now + key * 1us));
+    }
+    EXPECT_LE(limiter.get_num_entries(), limiter.get_capacity());
+    EXPECT_GT(limiter.get_num_evictions(), 0);
+
+    // the most recent key is still held back, an old one made room
+    EXPECT_FALSE(limiter.allow(10'000, now + 20ms));
+    EXPECT_TRUE(limiter.allow(1, now + 20ms));
+
+    const auto evictions = limiter.get_num_evictions();
+    for (uint64_t key = 1; key <= 10'000; key++)
+    {
+        EXPECT_TRUE(limiter.allow(key + 10'000, now + 2s + key * 1us));
+    }
+    EXPECT_LE(limiter.get_num_entries(), limiter.get_capacity());
+    EXPECT_GT(limiter.get_num_evictions(), evictions);
+}
+
+// Test that a reset lets every record through again without giving up the
+// table
+TEST(MDNS_RateLimiterTest, ForgetsEverythingOnReset)
+{
+    MDNS_RateLimiter limiter(64);
+    const MDNS_RateLimiter::clock::time_point now;
+
+    EXPECT_TRUE(limiter.allow(1, now));
+    EXPECT_TRUE(limiter.allow(2, now));
+    EXPECT_FALSE(limiter.allow(1, now + 10ms));
+
+    limiter.reset();
+    EXPECT_EQ(limiter.get_num_entries(), 0);
+    EXPECT_EQ(limiter.get_capacity(), 64);
+    EXPECT_EQ(limiter.get_num_suppressed(), 1);
+
+    EXPECT_TRUE(limiter.allow(1, now + 20ms));
+    EXPECT_TRUE(limiter.allow(2, now + 20ms));
+    EXPECT_EQ(limiter.get_num_entries(), 2);
+}
+
+} // anonymous namespace
@@ -9,9 +9,12 @@
 
 #include "../iuring/tests/iuring_mocks.hpp"
 #include "../tests/slogger_mocks.hpp"
+#include "mdns_service_setup.hpp"
+#include "mdns_test_helpers.hpp"
 
 using namespace testing;
 using namespace mdns;
+using namespace mdns::test;
 using namespace iuring;
 
 using namespace std::chrono_literals;
@@ -35,260 +38,6 @@ public:
         (const std::vector<ReplyData>& replies), (override));
 };
 
-// Helper to create a simple MDNS name (domain label encoding)
-std::vector<uint8_t> encode_mdns_name(const std::vector<std::string>& labels)
-{
-    std::vector<uint8_t> result;
-    for (const auto& label : labels)
-    {
-        result.push_back(static_cast<uint8_t>(label.size()));
-        result.insert(result.end(), label.begin(), label.end());
-    }
-    result.push_back(0); // null terminator
-    return result;
-}
-
-// Helper to create a valid MDNS query packet
-std::vector<uint8_t> create_mdns_query_packet(transaction_id_t id,
-    const std::vector<std::string>& qname, uint16_t qtype = 12 /*PTR*/,
-    uint16_t qclass = 1 /*IN*/)
-{
-    std::vector<uint8_t> packet;
-
-    // MDNS Header (12 bytes)
-    // Transaction ID
-    packet.push_back((id >> 8) & 0xFF);
-    packet.push_back(id & 0xFF);
-
-    // Flags: standard query (QR=0, OPCODE=0, AA=0, TC=0, RD=0)
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Questions count
-    packet.push_back(0x00);
-    packet.push_back(0x01); // 1 question
-
-    // Answer RRs
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Authority RRs
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Additional RRs
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Question section
-    auto encoded_name = encode_mdns_name(qname);
-    packet.insert(packet.end(), encoded_name.begin(), encoded_name.end());
-
-    // QTYPE
-    packet.push_back((qtype >> 8) & 0xFF);
-    packet.push_back(qtype & 0xFF);
-
-    // QCLASS
-    packet.push_back((qclass >> 8) & 0xFF);
-    packet.push_back(qclass & 0xFF);
-
-    return packet;
-}
-
-// Helper to create a valid MDNS reply packet with PTR record
-std::vector<uint8_t> create_mdns_reply_packet(transaction_id_t id,
-    const std::vector<std::string>& name, const std::vector<std::string>& ptr_value)
-{
-    std::vector<uint8_t> packet;
-
-    // MDNS Header (12 bytes)
-    // Transaction ID
-    packet.push_back((id >> 8) & 0xFF);
-    packet.push_back(id & 0xFF);
-
-    // Flags: standard response (QR=1, OPCODE=0, AA=1, TC=0, RD=0)
-    packet.push_back(0x84); // QR=1, AA=1
-    packet.push_back(0x00);
-
-    // Questions count
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Answer RRs
-    packet.push_back(0x00);
-    packet.push_back(0x01); // 1 answer
-
-    // Authority RRs
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Additional RRs
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-
-    // Answer section
-    auto encoded_name = encode_mdns_name(name);
-    packet.insert(packet.end(), encoded_name.begin(), encoded_name.end());
-
-    // TYPE (PTR = 12)
-    packet.push_back(0x00);
-    packet.push_back(0x0C);
-
-    // CLASS (IN = 1)
-    packet.push_back(0x00);
-    packet.push_back(0x01);
-
-    // TTL (4500 seconds)
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-    packet.push_back(0x11);
-    packet.push_back(0x94);
-
-    // RDLENGTH
-    auto ptr_data = encode_mdns_name(ptr_value);
-    uint16_t rdlen = ptr_data.size();
-    packet.push_back((rdlen >> 8) & 0xFF);
-    packet.push_back(rdlen & 0xFF);
-
-    // RDATA (PTR target)
-    packet.insert(packet.end(), ptr_data.begin(), ptr_data.end());
-
-    return packet;
-}
-
-// Helper to create an MDNS reply packet with compressed names
-std::vector<uint8_t> create_mdns_reply_with_compression(transaction_id_t id)
-{
-    std::vector<uint8_t> packet;
-
-    // MDNS Header (12 bytes)
-    packet.push_back((id >> 8) & 0xFF);
-    packet.push_back(id & 0xFF);
-    packet.push_back(0x84); // QR=1, AA=1
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-    packet.push_back(0x00); // 0 questions
-    packet.push_back(0x00);
-    packet.push_back(0x03); // 3 answers
-    packet.push_back(0x00);
-    packet.push_back(0x00); // 0 authority
-    packet.push_back(0x00);
-    packet.push_back(0x00); // 0 additional
-
-    // First answer: myservice._http._tcp.local PTR
-    // Name: _http._tcp.local (will be at offset 12)
-    const size_t first_name_offset = packet.size();
-    packet.push_back(0x05); // length of "_http"
-    packet.insert(packet.end(), {'_', 'h', 't', 't', 'p'});
-    packet.push_back(0x04); // length of "_tcp"
-    packet.insert(packet.end(), {'_', 't', 'c', 'p'});
-    packet.push_back(0x05); // length of "local"
-    packet.insert(packet.end(), {'l', 'o', 'c', 'a', 'l'});
-    packet.push_back(0x00); // null terminator
-
-    // TYPE PTR, CLASS IN
-    packet.push_back(0x00);
-    packet.push_back(0x0C); // PTR
-    packet.push_back(0x00);
-    packet.push_back(0x01); // IN
-    
-    // TTL
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-    packet.push_back(0x11);
-    packet.push_back(0x94);
-
-    // RDLENGTH
-    const size_t rdlen_pos1 = packet.size();
-    packet.push_back(0x00);
-    packet.push_back(0x00); // placeholder
-
-    // RDATA: myservice._http._tcp.local (uses compression for _http._tcp.local)
-    const size_t rdata_start1 = packet.size();
-    packet.push_back(0x09); // length of "myservice"
-    packet.insert(packet.end(), {'m', 'y', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
-    // Compression pointer to offset 12 (_http._tcp.local)
-    packet.push_back(0xC0);
-    packet.push_back(static_cast<uint8_t>(first_name_offset));
-    
-    // Update RDLENGTH
-    uint16_t rdlen1 = packet.size() - rdata_start1;
-    packet[rdlen_pos1] = (rdlen1 >> 8) & 0xFF;
-    packet[rdlen_pos1 + 1] = rdlen1 & 0xFF;
-
-    // Second answer: another service using compression
-    // Name: _http._tcp.local (compressed pointer to first occurrence)
-    packet.push_back(0xC0);
-    packet.push_back(static_cast<uint8_t>(first_name_offset));
-
-    // TYPE PTR, CLASS IN
-    packet.push_back(0x00);
-    packet.push_back(0x0C); // PTR
-    packet.push_back(0x00);
-    packet.push_back(0x01); // IN
-    
-    // TTL
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-    packet.push_back(0x11);
-    packet.push_back(0x94);
-
-    // RDLENGTH
-    const size_t rdlen_pos2 = packet.size();
-    packet.push_back(0x00);
-    packet.push_back(0x00); // placeholder
-
-    // RDATA: otherservice._http._tcp.local (uses compression)
-    const size_t rdata_start2 = packet.size();
-    packet.push_back(0x0C); // length of "otherservice"
-    packet.insert(packet.end(), {'o', 't', 'h', 'e', 'r', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
-    // Compression pointer to offset 12 (_http._tcp.local)
-    packet.push_back(0xC0);
-    packet.push_back(static_cast<uint8_t>(first_name_offset));
-    
-    // Update RDLENGTH
-    uint16_t rdlen2 = packet.size() - rdata_start2;
-    packet[rdlen_pos2] = (rdlen2 >> 8) & 0xFF;
-    packet[rdlen_pos2 + 1] = rdlen2 & 0xFF;
-
-    // Third answer: deeply nested compression
-    // Name uses compression pointer
-    packet.push_back(0xC0);
-    packet.push_back(static_cast<uint8_t>(first_name_offset));
-
-    // TYPE PTR, CLASS IN
-    packet.push_back(0x00);
-    packet.push_back(0x0C); // PTR
-    packet.push_back(0x00);
-    packet.push_back(0x01); // IN
-    
-    // TTL
-    packet.push_back(0x00);
-    packet.push_back(0x00);
-    packet.push_back(0x11);
-    packet.push_back(0x94);
-
-    // RDLENGTH
-    const size_t rdlen_pos3 = packet.size();
-    packet.push_back(0x00);
-    packet.push_back(0x00); // placeholder
-
-    // RDATA: thirdservice._http._tcp.local (uses compression)
-    const size_t rdata_start3 = packet.size();
-    packet.push_back(0x0C); // length of "thirdservice"
-    packet.insert(packet.end(), {'t', 'h', 'i', 'r', 'd', 's', 'e', 'r', 'v', 'i', 'c', 'e'});
-    // Compression pointer to offset 12 (_http._tcp.local)
-    packet.push_back(0xC0);
-    packet.push_back(static_cast<uint8_t>(first_name_offset));
-    
-    // Update RDLENGTH
-    uint16_t rdlen3 = packet.size() - rdata_start3;
-    packet[rdlen_pos3] = (rdlen3 >> 8) & 0xFF;
-    packet[rdlen_pos3 + 1] = rdlen3 & 0xFF;
-
-    return packet;
-}
-
 class MDNS_ServiceTest : public ::testing::Test
 {
 protected:
@@ -625,9 +374,13 @@ TEST_F(MDNS_ServiceTest, RejectsMissingQuestionFields)
     EXPECT_EQ(init_result, error::Error::OK);
 
     ASSERT_TRUE(recv_callback != nullptr);
-    // This should handle gracefully (likely segfault protection needed in actual impl)
-    // For now, we're just testing that the test framework works
-    // auto ret = recv_callback(msg); // Commenting out as this may cause actual issues
+    auto ret = recv_callback(msg);
+    ASSERT_EQ(ret, iuring::ReceivePostAction::RE_SUBMIT);
+
+    const auto metrics = service->get_metrics();
+    EXPECT_EQ(metrics.malformed[static_cast<size_t>(
+                  MDNS_MalformedReason::TRUNCATED)],
+        1);
 }
 
 // Test a complete valid query with multiple labels
@@ -778,4 +531,192 @@ TEST_F(MDNS_ServiceTest, HandlesCompressedNames)
     ASSERT_EQ(ret, iuring::ReceivePostAction::RE_SUBMIT);
 }
 
+// Test that a query flood beyond the pending-query ring is dropped and counted
+TEST_F(MDNS_ServiceTest, DropsQueriesWhenPendingRingIsFull)
+{
+    auto service = std::make_shared<MDNS_Service>(
+        rt_kernel, network, *logger, *adapter, *socket_factory);
+
+    auto handler = std::make_shared<MockMDNSHandler>(network, *logger, *adapter);
+    service->add_handler(handler);
+
+    EXPECT_CALL(*handler, handle_question(_, _))
+        .Times(MDNS_Service::MAX_PENDING_QUERIES)
+        .WillRepeatedly(Return(MDNS_IsHandled::NOT_HANDLED_YET));
+
+    auto packet = create_mdns_query_packet(
+        0x1234, {"_http", "_tcp", "local"}, 12 /*PTR*/, 1 /*IN*/);
+
+    auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+
+    iuring::recv_callback_func_t recv_callback;
+    EXPECT_CALL(*network, submit_recv(_, _))
+        .WillOnce([&recv_callback](const std::shared_ptr<ISocket>&,
+                      iuring::recv_callback_func_t handler) {
+            recv_callback = handler;
+        });
+
+    auto init_result = service->init();
+    EXPECT_EQ(init_result, error::Error::OK);
+
+    ASSERT_TRUE(recv_callback != nullptr);
+    const size_t num_queries = MDNS_Service::MAX_PENDING_QUERIES + 10;
+    for (size_t i = 0; i < num_queries; i++)
+    {
+        recv_callback(msg);
+    }
+    EXPECT_EQ(service->get_num_dropped_queries(), 10);
+
+    rt_kernel->run(1s);
+}
+
+// Test that with an exhausted tick budget queries are spread over ticks
+TEST_F(MDNS_ServiceTest, DefersQueriesBeyondTickBudget)
+{
+    auto service = std::make_shared<MDNS_Service>(
+        rt_kernel, network, *logger, *adapter, *socket_factory);
+    service->set_tick_budget(0ns);
+
+    auto handler = std::make_shared<MockMDNSHandler>(network, *logger, *adapter);
+    service->add_handler(handler);
+
+    EXPECT_CALL(*handler, handle_question(_, _))
+        .Times(5)
+        .WillRepeatedly(Return(MDNS_IsHandled::NOT_HANDLED_YET));
+
+    auto packet = create_mdns_query_packet(
+        0x1234, {"_http", "_tcp", "local"}, 12 /*PTR*/, 1 /*IN*/);
+
+    auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+
+    iuring::recv_callback_func_t recv_callback;
+    EXPECT_CALL(*network, submit_recv(_, _))
+        .WillOnce([&recv_callback](const std::shared_ptr<ISocket>&,
+                      iuring::recv_callback_func_t handler) {
+            recv_callback = handler;
+        });
+
+    auto init_result = service->init();
+    EXPECT_EQ(init_result, error::Error::OK);
+
+    ASSERT_TRUE(recv_callback != nullptr);
+    for (int i = 0; i < 5; i++)
+    {
+        recv_callback(msg);
+    }
+
+    rt_kernel->run(1s);
+
+    EXPECT_EQ(service->get_num_deferred_batches(), 4);
+    EXPECT_GE(service->get_num_budget_overruns(), 1);
+}
+
+// Test that the metrics block counts traffic, questions and parse errors
+TEST_F(MDNS_ServiceTest, CountsQueriesInMetrics)
+{
+    auto service = std::make_shared<MDNS_Service>(
+        rt_kernel, network, *logger, *adapter, *socket_factory);
+
+    auto handler = std::make_shared<MockMDNSHandler>(network, *logger, *adapter);
+    service->add_handler(handler);
+
+    EXPECT_CALL(*handler, handle_question(_, _))
+        .WillOnce(Return(MDNS_IsHandled::NOT_HANDLED_YET));
+
+    auto packet = create_mdns_query_packet(
+        0x1234, {"_http", "_tcp", "local"}, 12 /*PTR*/, 1 /*IN*/);
+    const std::vector<uint8_t> runt(4, 0);
+
+    auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+    iuring::ReceivedMessage runt_msg(runt.data(), runt.size(), src_addr);
+
+    iuring::recv_callback_func_t recv_callback;
+    EXPECT_CALL(*network, submit_recv(_, _))
+        .WillOnce([&recv_callback](const std::shared_ptr<ISocket>&,
+                      iuring::recv_callback_func_t handler) {
+            recv_callback = handler;
+        });
+
+    auto init_result = service->init();
+    EXPECT_EQ(init_result, error::Error::OK);
+
+    ASSERT_TRUE(recv_callback != nullptr);
+    recv_callback(msg);
+    recv_callback(runt_msg);
+
+    rt_kernel->run(1s);
+
+    const auto metrics = service->get_metrics();
+    EXPECT_EQ(metrics.packets_in[0], 1);
+    EXPECT_EQ(metrics.bytes_in[0], packet.size());
+    EXPECT_EQ(metrics.questions[12], 1);
+    EXPECT_EQ(metrics.handler_misses[0], 1);
+    EXPECT_EQ(metrics.unanswered_questions, 1);
+    EXPECT_EQ(metrics.malformed[static_cast<size_t>(
+                  MDNS_MalformedReason::HEADER_TOO_SHORT)],
+        1);
+    // nothing was sent for the unanswered query
+    EXPECT_EQ(metrics.latency_count, 0);
+
+    const auto text = to_prometheus_text(metrics);
+    EXPECT_THAT(text, HasSubstr("mdns_packets_in_total{type=\"query\"} 1"));
+    EXPECT_THAT(text, HasSubstr("mdns_questions_total{qtype=\"12\"} 1"));
+}
+
+// Test that a reply the egress pacer holds back isn't counted as sent
+TEST(MDNS_ServiceEgressTest, CountsOnlySentReplies)
+{
+    MDNS_ServiceSetup setup;
+    setup.service->set_egress_limit(setup.adapter,
+        MDNS_EgressLimit{ .bytes_per_sec = 1,
+            .packets_per_sec = 1,
+            .burst_bytes = 0,
+            .burst_packets = 0 });
+
+    const auto packet =
+        create_mdns_query_packet(0, { "_nmos-node", "_tcp", "local" });
+    const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+        iuring::IPAddress::parse("192.168.1.50").value());
+    MDNS_ServiceProbe::receive(*setup.service, msg);
+    MDNS_ServiceProbe::answer_all(*setup.service);
+
+    const auto metrics = setup.service->get_metrics();
+    EXPECT_EQ(metrics.paced_packets, 1);
+    EXPECT_EQ(metrics.packets_out[static_cast<size_t>(
+                  MDNS_Header::MessageType::REPLY)],
+        0);
+    EXPECT_EQ(metrics.records_out, 0);
+    EXPECT_EQ(metrics.latency_count, 0);
+}
+
+// Test that a query with more questions than a slot holds is answered in
+// part and the rest is counted
+TEST(MDNS_ServiceQueryTest, CapsQuestionsPerQuery)
+{
+    MDNS_ServiceSetup setup;
+
+    constexpr size_t num_questions = MDNS_Service::MAX_QUESTIONS_PER_QUERY + 4;
+    auto packet =
+        create_mdns_query_packet(0, { "_nmos-node", "_tcp", "local" });
+    const std::vector<uint8_t> question(packet.begin() + sizeof(MDNS_Header),
+        packet.end());
+    for (size_t i = 1; i < num_questions; i++)
+    {
+        packet.insert(packet.end(), question.begin(), question.end());
+    }
+    packet[5] = num_questions;
+
+    const iuring::ReceivedMessage msg(packet.data(), packet.size(),
+        iuring::IPAddress::parse("192.168.1.50").value());
+    MDNS_ServiceProbe::receive(*setup.service, msg);
+
+    const auto metrics = setup.service->get_metrics();
+    EXPECT_EQ(metrics.questions[12], MDNS_Service::MAX_QUESTIONS_PER_QUERY);
+    EXPECT_EQ(metrics.dropped_questions, 4);
+    EXPECT_EQ(MDNS_ServiceProbe::num_pending_queries(*setup.service), 1);
+}
+
 } // anonymous namespace
@@ -0,0 +1,282 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mdns/MDNS_AnswerList.hpp>
+#include <mdns/MDNS_Header.hpp>
+#include <mdns/MDNS_ServiceRegistry.hpp>
+
+#include "../src/mdns/MDNS_Decoder.hpp"
+
+using namespace testing;
+using namespace mdns;
+
+namespace
+{
+
+MDNS_ServiceInstance make_instance(const std::string& instance_name,
+    const name_list_t& service_type,
+    const std::vector<std::string>& subtypes = {})
+{
+    return MDNS_ServiceInstance{ .instance_name = instance_name,
+        .service_type = service_type,
+        .subtypes = subtypes,
+        .host_name = { "node", "local" },
+        .port = 8080,
+        .txt = "path=/" };
+}
+
+class MDNS_ServiceRegistryTest : public Test
+{
+protected:
+    MDNS_ServiceRegistryTest()
+    {
+        inet_pton(AF_INET, "192.168.1.100", &ip4);
+    }
+
+    // the PTR targets answering a PTR question for name
+    std::vector<name_list_t> browse(const name_list_t& name)
+    {
+        const QuestionData q{ name, static_cast<uint16_t>(RRType::PTR),
+            MDNS_class::IN, false };
+        MDNS_AnswerList answers(ip4);
+        answers.set_question(&q);
+        handled = registry.handle_question(q, answers);
+        answers.write_additional_records();
+
+        const auto& pkt = answers.get_packet(0);
+        std::vector<uint8_t> data(sizeof(MDNS_Header));
+        data.insert(data.end(), pkt.payload.begin(), pkt.payload.end());
+        MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+            data.data() + sizeof(MDNS_Header));
+
+        std::vector<name_list_t> targets;
+        for (size_t i = 0; i < pkt.num_answers; i++)
+        {
+            const auto record = decoder.read_record();
+            EXPECT_TRUE(record.has_value() && record->PTR.has_value());
+            if (!record || !record->PTR)
+            {
+                break;
+            }
+            targets.push_back(record->PTR.value());
+        }
+        return targets;
+    }
+
+    const name_list_t http{ "_http", "_tcp", "local" };
+    const name_list_t nmos{ "_nmos-node", "_tcp", "local" };
+    const name_list_t enumeration{ "_services", "_dns-sd", "_udp", "local" };
+
+    in_addr ip4;
+    MDNS_ServiceRegistry registry;
+    MDNS_IsHandled handled = MDNS_IsHandled::NOT_HANDLED_YET;
+};
+
+// Test that each registered service type is enumerated once (RFC 6763 §9)
+TEST_F(MDNS_ServiceRegistryTest, EnumeratesServiceTypes)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http, { "_ravenna" })));
+    EXPECT_TRUE(registry.add(make_instance("studio-b", http)));
+    EXPECT_TRUE(registry.add(make_instance("studio-a", nmos)));
+
+    EXPECT_EQ(browse(enumeration), (std::vector<name_list_t>{ http, nmos }));
+    EXPECT_EQ(handled, MDNS_IsHandled::IS_HANDLED);
+}
+
+// Test that a subtype browse only finds the instances with that subtype
+TEST_F(MDNS_ServiceRegistryTest, BrowsesSubtypes)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http, { "_ravenna" })));
+    EXPECT_TRUE(registry.add(make_instance("studio-b", http)));
+
+    const name_list_t ravenna{ "_ravenna", "_sub", "_http", "_tcp", "local" };
+    EXPECT_EQ(browse(ravenna),
+        (std::vector<name_list_t>{ { "studio-a", "_http", "_tcp", "local" } }));
+    EXPECT_EQ(browse(http).size(), 2);
+}
+
+// Test that names are looked up whatever their case (RFC 6762 §16)
+TEST_F(MDNS_ServiceRegistryTest, FindsNamesCaseInsensitively)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http)));
+
+    const std::vector<name_list_t> studio_a{
+        { "studio-a", "_http", "_tcp", "local" }
+    };
+    EXPECT_EQ(browse({ "_HTTP", "_tcp", "local" }), studio_a);
+    EXPECT_EQ(handled, MDNS_IsHandled::IS_HANDLED);
+    EXPECT_EQ(browse({ "_Services", "_DNS-SD", "_udp", "LOCAL" }),
+        (std::vector<name_list_t>{ http }));
+
+    EXPECT_TRUE(registry.remove({ "Studio-A", "_http", "_tcp", "local" }));
+    EXPECT_TRUE(browse(http).empty());
+}
+
+// Test that the index follows instances being replaced and removed
+TEST_F(MDNS_ServiceRegistryTest, UpdatesIndexOnRemoval)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http, { "_ravenna" })));
+    EXPECT_TRUE(registry.add(make_instance("studio-b", http, { "_ravenna" })));
+    EXPECT_TRUE(registry.add(make_instance("studio-c", nmos)));
+
+    // replacing studio-a drops its subtype
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http)));
+    const name_list_t ravenna{ "_ravenna", "_sub", "_http", "_tcp", "local" };
+    EXPECT_EQ(browse(ravenna),
+        (std::vector<name_list_t>{ { "studio-b", "_http", "_tcp", "local" } }));
+
+    registry.remove({ "studio-c", "_nmos-node", "_tcp", "local" });
+    EXPECT_EQ(browse(enumeration), (std::vector<name_list_t>{ http }));
+    EXPECT_EQ(browse(http).size(), 2);
+
+    registry.remove({ "studio-a", "_http", "_tcp", "local" });
+    registry.remove({ "studio-b", "_http", "_tcp", "local" });
+    EXPECT_TRUE(browse(enumeration).empty());
+    EXPECT_EQ(handled, MDNS_IsHandled::NOT_HANDLED_YET);
+    EXPECT_TRUE(browse(ravenna).empty());
+}
+
+// Test that with thousands of nodes each of them is still answered alone
+TEST_F(MDNS_ServiceRegistryTest, ServesThousandsOfNodes)
+{
+    constexpr size_t NUM_NODES = 10000;
+    for (size_t i = 0; i < NUM_NODES; i++)
+    {
+        auto instance = make_instance("node-" + std::to_string(i), http);
+        instance.host_name = { "node-" + std::to_string(i), "local" };
+        EXPECT_TRUE(registry.add(instance));
+    }
+    EXPECT_EQ(registry.size(), NUM_NODES);
+    // "node-<i>" plus _http, _tcp and local
+    EXPECT_EQ(registry.get_num_labels(), NUM_NODES + 3);
+
+    for (const auto& [name, type] : {
+             std::pair{ name_list_t{ "node-4711", "local" }, RRType::A },
+             std::pair{ name_list_t{ "node-4711", "_http", "_tcp", "local" },
+                 RRType::SRV } })
+    {
+        const QuestionData q{ name, static_cast<uint16_t>(type),
+            MDNS_class::IN, false };
+        MDNS_AnswerList answers(ip4);
+        answers.set_question(&q);
+        EXPECT_EQ(
+            registry.handle_question(q, answers), MDNS_IsHandled::IS_HANDLED);
+        answers.write_additional_records();
+        EXPECT_EQ(answers.get_num_answers(), 1);
+    }
+}
+
+// Test that the TXT record rendered on add() follows a replaced instance
+TEST_F(MDNS_ServiceRegistryTest, AnswersCurrentTXT)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http)));
+    auto replaced = make_instance("studio-a", http);
+    replaced.txt = "path=/v2";
+    EXPECT_TRUE(registry.add(replaced));
+
+    const QuestionData q{ { "studio-a", "_http", "_tcp", "local" },
+        static_cast<uint16_t>(RRType::TXT), MDNS_class::IN, false };
+    MDNS_AnswerList answers(ip4);
+    answers.set_question(&q);
+    EXPECT_EQ(registry.handle_question(q, answers), MDNS_IsHandled::IS_HANDLED);
+    answers.write_additional_records();
+    ASSERT_EQ(answers.get_num_answers(), 1);
+
+    const auto& pkt = answers.get_packet(0);
+    std::vector<uint8_t> data(sizeof(MDNS_Header));
+    data.insert(data.end(), pkt.payload.begin(), pkt.payload.end());
+    MDNS_Decoder decoder(data.data(), data.data() + data.size(),
+        data.data() + sizeof(MDNS_Header));
+    const auto record = decoder.read_record();
+    ASSERT_TRUE(record.has_value() && record->TXT.has_value());
+    EXPECT_EQ(record->TXT->at("path"), "/v2");
+
+    const auto removed =
+        registry.remove({ "studio-a", "_http", "_tcp", "local" });
+    ASSERT_TRUE(removed.has_value());
+    EXPECT_EQ(removed->txt, "path=/v2");
+}
+
+// Test that names share their labels and suffixes aren't answered for
+TEST_F(MDNS_ServiceRegistryTest, SharesLabelsBetweenNames)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http)));
+    // studio-a, _http, _tcp, local and node
+    EXPECT_EQ(registry.get_num_labels(), 5);
+    EXPECT_TRUE(registry.add(make_instance("studio-b", http)));
+    EXPECT_EQ(registry.get_num_labels(), 6);
+
+    EXPECT_TRUE(browse({ "_tcp", "local" }).empty());
+    EXPECT_EQ(handled, MDNS_IsHandled::NOT_HANDLED_YET);
+    EXPECT_EQ(browse(http).size(), 2);
+
+    registry.remove({ "studio-a", "_http", "_tcp", "local" });
+    EXPECT_EQ(registry.get_num_labels(), 5);
+    registry.remove({ "studio-b", "_http", "_tcp", "local" });
+    EXPECT_EQ(registry.get_num_labels(), 0);
+}
+
+// Test that a removed instance comes back whole for its goodbye
+TEST_F(MDNS_ServiceRegistryTest, RemoveReturnsInstance)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http, { "_ravenna" })));
+
+    const auto removed =
+        registry.remove({ "studio-a", "_http", "_tcp", "local" });
+    ASSERT_TRUE(removed.has_value());
+    EXPECT_EQ(removed->instance_name, "studio-a");
+    EXPECT_EQ(removed->service_type, http);
+    EXPECT_EQ(removed->subtypes, (std::vector<std::string>{ "_ravenna" }));
+    EXPECT_EQ(removed->host_name, (name_list_t{ "node", "local" }));
+    EXPECT_EQ(removed->port, 8080);
+    EXPECT_EQ(removed->txt, "path=/");
+    EXPECT_TRUE(registry.empty());
+
+    EXPECT_FALSE(registry.remove({ "studio-a", "_http", "_tcp", "local" }));
+}
+
+// Test that instances whose names don't fit are refused, not truncated
+TEST_F(MDNS_ServiceRegistryTest, RejectsOversizedNames)
+{
+    EXPECT_FALSE(registry.add(make_instance(std::string(64, 'x'), http)));
+    EXPECT_FALSE(registry.add(
+        make_instance("studio-a", http, { std::string(64, 'x') })));
+
+    auto long_name = make_instance(std::string(63, 'x'), http);
+    long_name.service_type = { std::string(63, 'y'), std::string(63, 'z'),
+        std::string(63, 'w') };
+    EXPECT_FALSE(registry.add(long_name));
+
+    auto long_host = make_instance("studio-a", http);
+    long_host.host_name = { std::string(64, 'x'), "local" };
+    EXPECT_FALSE(registry.add(long_host));
+    auto long_type = make_instance("studio-a", http);
+    long_type.service_type = { "_http", std::string(64, 'x'), "local" };
+    EXPECT_FALSE(registry.add(long_type));
+
+    EXPECT_TRUE(registry.empty());
+    EXPECT_TRUE(browse(enumeration).empty());
+}
+
+// Test that the instances added since the last announcement go out once
+TEST_F(MDNS_ServiceRegistryTest, AnnouncesAddedInstancesOnce)
+{
+    EXPECT_TRUE(registry.add(make_instance("studio-a", http)));
+    EXPECT_TRUE(registry.add(make_instance("studio-b", http)));
+    registry.remove({ "studio-b", "_http", "_tcp", "local" });
+
+    MDNS_AnswerList first(ip4);
+    registry.append_added(first);
+    // PTR, TXT, SRV, A of studio-a
+    EXPECT_EQ(first.get_num_answers(), 4);
+
+    MDNS_AnswerList second(ip4);
+    registry.append_added(second);
+    EXPECT_EQ(second.get_num_answers(), 0);
+}
+
+} // anonymous namespace
@@ -0,0 +1,197 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_Ravenna_HTTP_Handler.hpp>
+#include <mdns/StaticMDNS_Service.hpp>
+
+#include "mdns_service_setup.hpp"
+#include "mdns_test_helpers.hpp"
+
+using namespace testing;
+using namespace mdns;
+using namespace mdns::test;
+
+namespace
+{
+
+// answers two service types and claims every reply
+struct FakeStaticHandler
+{
+    static constexpr std::array question_names{
+        mdns_name<"_fake._tcp.local">, mdns_name<"_fake-alt._tcp.local">
+    };
+
+    MDNS_IsHandled handle_question(
+        const QuestionData& q, MDNS_AnswerList& answer)
+    {
+        num_questions++;
+        answer.append_PTR(q.name_list, mdns_name<"studio-b._fake._tcp.local">);
+        return MDNS_IsHandled::IS_HANDLED;
+    }
+
+    MDNS_IsHandled handle_reply(const std::vector<ReplyData>&)
+    {
+        num_replies++;
+        return MDNS_IsHandled::IS_HANDLED;
+    }
+
+    void append_announcement(MDNS_AnswerList& answer)
+    {
+        answer.append_PTR(mdns_name<"_fake._tcp.local">,
+            mdns_name<"studio-b._fake._tcp.local">);
+        num_announcements++;
+    }
+
+    size_t num_questions = 0;
+    size_t num_replies = 0;
+    size_t num_announcements = 0;
+};
+
+// owns the browse name but has nothing to answer
+struct PassingStaticHandler
+{
+    static constexpr std::array question_names{ mdns_name<"_http._tcp.local"> };
+    static constexpr std::array question_types{ RRType::PTR };
+
+    MDNS_IsHandled handle_question(const QuestionData&, MDNS_AnswerList&)
+    {
+        num_questions++;
+        return MDNS_IsHandled::NOT_HANDLED_YET;
+    }
+
+    size_t num_questions = 0;
+};
+
+static_assert(StaticMDNS_Handler<FakeStaticHandler>);
+static_assert(StaticMDNS_Handler<PassingStaticHandler>);
+static_assert(!StaticMDNS_Handler<MDNS_Ravenna_HTTP_Handler>);
+
+using TestService =
+    StaticMDNS_Service<FakeStaticHandler, PassingStaticHandler>;
+
+class StaticMDNS_ServiceTest : public Test
+{
+protected:
+    StaticMDNS_ServiceTest()
+        : setup([](MDNS_ServiceSetup& s) {
+            auto ret = std::make_shared<TestService>(s.rt_kernel, s.network,
+                s.logger, s.adapter, s.socket_factory, FakeStaticHandler{},
+                PassingStaticHandler{});
+            EXPECT_TRUE(ret->add_service(MDNS_ServiceInstance{
+                    .instance_name = "studio-a",
+                    .service_type = { "_http", "_tcp", "local" },
+                    .subtypes = {},
+                    .host_name = { "studio-a", "local" },
+                    .port = 8080,
+                    .txt = "path=/" }));
+            return ret;
+        })
+        , service(std::static_pointer_cast<TestService>(setup.service))
+    {
+    }
+
+    void query(const std::vector<std::string>& name,
+        RRType type = RRType::PTR)
+    {
+        const auto packet = create_mdns_query_packet(
+            0, name, static_cast<uint16_t>(type));
+        const iuring::ReceivedMessage msg(packet.data(), packet.size(), from);
+        MDNS_ServiceProbe::receive(*service, msg);
+        MDNS_ServiceProbe::answer_all(*service);
+    }
+
+    MDNS_ServiceSetup setup;
+    std::shared_ptr<TestService> service;
+    const iuring::IPAddress from =
+        iuring::IPAddress::parse("192.168.1.50").value();
+};
+
+// Test that a question only reaches the handler declaring its name
+TEST_F(StaticMDNS_ServiceTest, RoutesQuestionsByDeclaredName)
+{
+    auto& fake = service->get_handler<FakeStaticHandler>();
+    auto& passing = service->get_handler<PassingStaticHandler>();
+
+    query({ "_fake", "_tcp", "local" });
+    query({ "_fake-alt", "_tcp", "local" });
+    EXPECT_EQ(fake.num_questions, 2);
+    EXPECT_EQ(passing.num_questions, 0);
+
+    query({ "_printer", "_tcp", "local" });
+    EXPECT_EQ(fake.num_questions, 2);
+    EXPECT_EQ(passing.num_questions, 0);
+    EXPECT_EQ(service->get_metrics().unanswered_questions, 1);
+}
+
+// Test that a question is routed whatever the case of its name
+TEST_F(StaticMDNS_ServiceTest, RoutesQuestionsCaseInsensitively)
+{
+    query({ "_FAKE", "_Tcp", "LOCAL" });
+
+    EXPECT_EQ(service->get_handler<FakeStaticHandler>().num_questions, 1);
+    EXPECT_EQ(service->get_metrics().unanswered_questions, 0);
+}
+
+// Test that a declared name never reaches the registry, even when its
+// handler leaves the question unhandled
+TEST_F(StaticMDNS_ServiceTest, KeepsDeclaredNamesFromRegistry)
+{
+    query({ "_http", "_tcp", "local" });
+    query({ "_http", "_tcp", "local" }, RRType::SRV);
+
+    EXPECT_EQ(service->get_handler<PassingStaticHandler>().num_questions, 1);
+    EXPECT_EQ(service->get_metrics().registry_hits, 0);
+    EXPECT_EQ(service->get_metrics().registry_misses, 0);
+    EXPECT_EQ(service->get_metrics().unanswered_questions, 0);
+}
+
+// Test that the names no static handler declares go to the registry
+TEST_F(StaticMDNS_ServiceTest, LeavesOtherNamesToRegistry)
+{
+    query({ "studio-a", "_http", "_tcp", "local" }, RRType::SRV);
+
+    EXPECT_EQ(service->get_handler<PassingStaticHandler>().num_questions, 0);
+    EXPECT_EQ(service->get_handler<FakeStaticHandler>().num_questions, 0);
+    EXPECT_EQ(service->get_metrics().registry_hits, 1);
+}
+
+// Test that a handler only gets the types it declared and ANY
+TEST_F(StaticMDNS_ServiceTest, RoutesQuestionsByDeclaredType)
+{
+    const name_list_t name{ "_http", "_tcp", "local" };
+    for (const auto type : { RRType::SRV, RRType::PTR, RRType::ANY })
+    {
+        const auto packet = create_mdns_query_packet(
+            0, name.to_vector(), static_cast<uint16_t>(type));
+        const iuring::ReceivedMessage msg(packet.data(), packet.size(), from);
+        MDNS_ServiceProbe::receive(*service, msg);
+    }
+    MDNS_ServiceProbe::answer_all(*service);
+
+    EXPECT_EQ(service->get_handler<PassingStaticHandler>().num_questions, 2);
+}
+
+// Test that replies reach the handlers that take them
+TEST_F(StaticMDNS_ServiceTest, DispatchesReplies)
+{
+    const auto packet = create_mdns_reply_packet(
+        0, { "_fake", "_tcp", "local" }, { "studio-c", "_fake", "_tcp" });
+    const iuring::ReceivedMessage msg(packet.data(), packet.size(), from);
+    MDNS_ServiceProbe::receive(*service, msg);
+
+    EXPECT_EQ(service->get_handler<FakeStaticHandler>().num_replies, 1);
+}
+
+// Test that the static handlers are part of the goodbye packet
+TEST_F(StaticMDNS_ServiceTest, AppendsGoodbyeRecords)
+{
+    EXPECT_EQ(service->finish(), error::Error::OK);
+    EXPECT_EQ(service->get_handler<FakeStaticHandler>().num_announcements, 1);
+}
+
+} // anonymous namespace
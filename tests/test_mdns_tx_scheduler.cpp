@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <mdns/MDNS_TxScheduler.hpp>
+
+using namespace mdns;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const std::array<uint8_t, 2> header{ 0xab, 0xcd };
+const std::array<uint8_t, 1> announcement{ 1 };
+const std::array<uint8_t, 1> goodbye{ 2 };
+
+// Test that queued packets leave one per interval
+TEST(MDNS_TxSchedulerTest, PacesToPacketRate)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 0us);
+    for (int i = 0; i < 3; i++)
+    {
+        scheduler.push(0, header, announcement);
+    }
+
+    const MDNS_TxScheduler::clock::time_point t0{ 1s };
+    ASSERT_NE(scheduler.next(t0), nullptr);
+    EXPECT_EQ(scheduler.next(t0)->data,
+        (std::vector<uint8_t>{ 0xab, 0xcd, 1 }));
+    scheduler.pop(t0);
+
+    EXPECT_EQ(scheduler.next(t0 + 99ms), nullptr);
+    ASSERT_NE(scheduler.next(t0 + 100ms), nullptr);
+    scheduler.pop(t0 + 100ms);
+
+    // being late doesn't make up for it with a burst
+    ASSERT_NE(scheduler.next(t0 + 1s), nullptr);
+    scheduler.pop(t0 + 1s);
+    EXPECT_TRUE(scheduler.empty());
+    EXPECT_EQ(scheduler.next(t0 + 2s), nullptr);
+}
+
+// Test that queued packets leave in the order they were queued
+TEST(MDNS_TxSchedulerTest, SendsInQueueOrder)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 0us);
+    scheduler.push(0, header, announcement);
+    scheduler.push(1, header, goodbye);
+
+    const MDNS_TxScheduler::clock::time_point t0{ 1s };
+    ASSERT_NE(scheduler.next(t0), nullptr);
+    EXPECT_EQ(scheduler.next(t0)->listener_ix, 0);
+    scheduler.pop(t0);
+    ASSERT_NE(scheduler.next(t0 + 100ms), nullptr);
+    EXPECT_EQ(scheduler.next(t0 + 100ms)->listener_ix, 1);
+    EXPECT_EQ(scheduler.next(t0 + 100ms)->data,
+        (std::vector<uint8_t>{ 0xab, 0xcd, 2 }));
+}
+
+// Test that packets sent right away delay the queued ones by a gap
+TEST(MDNS_TxSchedulerTest, ChargesImmediateSends)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 0us);
+    scheduler.push(0, header, announcement);
+
+    const MDNS_TxScheduler::clock::time_point t0{ 1s };
+    scheduler.charge(t0);
+    scheduler.charge(t0 + 50ms);
+    EXPECT_EQ(scheduler.next(t0 + 149ms), nullptr);
+    EXPECT_EQ(scheduler.get_next_send(), t0 + 150ms);
+    EXPECT_NE(scheduler.next(scheduler.get_next_send()), nullptr);
+}
+
+// Test that a packet that was due but failed to send holds the queue back
+// for the retry interval
+TEST(MDNS_TxSchedulerTest, BacksOffAfterFailedSend)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 0us);
+    scheduler.push(0, header, announcement);
+
+    const MDNS_TxScheduler::clock::time_point t0{ 1s };
+    ASSERT_NE(scheduler.next(t0), nullptr);
+    scheduler.retry_later(t0);
+    EXPECT_EQ(scheduler.get_next_send(),
+        t0 + MDNS_TxScheduler::SEND_RETRY_INTERVAL);
+    EXPECT_EQ(scheduler.next(t0), nullptr);
+    EXPECT_NE(scheduler.next(scheduler.get_next_send()), nullptr);
+}
+
+// Test that a storm of responses doesn't starve the queue once it is over
+TEST(MDNS_TxSchedulerTest, BoundsDebtOfResponseStorm)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 10000us);
+
+    // 10 s of responses at 1000 packets/s, 100 times the rate
+    MDNS_TxScheduler::clock::time_point now{ 1s };
+    const auto storm_end = now + 10s;
+    for (; now < storm_end; now += 1ms)
+    {
+        scheduler.charge(now);
+    }
+
+    scheduler.push(0, header, announcement);
+    EXPECT_EQ(scheduler.next(now + 100ms - 2ms), nullptr);
+    EXPECT_NE(scheduler.next(now + 110ms), nullptr);
+}
+
+// Test that the jitter only ever stretches the gap, by at most max_jitter
+TEST(MDNS_TxSchedulerTest, JittersWithinBounds)
+{
+    MDNS_TxScheduler scheduler;
+    scheduler.set_rate(10, 5000us);
+
+    MDNS_TxScheduler::clock::time_point now{ 1s };
+    for (int i = 0; i < 100; i++)
+    {
+        scheduler.push(0, header, announcement);
+        ASSERT_NE(scheduler.next(now), nullptr);
+        scheduler.pop(now);
+
+        scheduler.push(0, header, announcement);
+        EXPECT_EQ(scheduler.next(now + 100ms - 1ns), nullptr);
+        EXPECT_NE(scheduler.next(now + 105ms), nullptr);
+        scheduler.drain([](const MDNS_TxScheduler::Datagram&) {});
+        now += 1s;
+    }
+}
+
+} // anonymous namespace
@@ -0,0 +1,198 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <slogger/DirectConsoleLogger.hpp>
+
+#include "../src/mdns/MDNS_Worker.hpp"
+
+using namespace testing;
+using namespace mdns;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Test that datagrams are processed on the worker and replies come back
+// through the tx ring
+TEST(MDNS_WorkerTest, ProcessesOnWorkerThreadAndQueuesReplies)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+
+    std::atomic<int> num_processed{ 0 };
+    std::atomic<bool> on_worker{ true };
+    std::atomic<int> num_idle{ 0 };
+    MDNS_Worker* worker_ptr = nullptr;
+
+    MDNS_Worker worker(
+        logger,
+        [&](const iuring::ReceivedMessage& msg, size_t listener_ix,
+            std::chrono::steady_clock::time_point) {
+            on_worker = on_worker && worker_ptr->is_worker_thread();
+            const std::vector<uint8_t> reply(msg.begin(), msg.end());
+            worker_ptr->push_outgoing(listener_ix, {}, reply);
+            num_processed++;
+        },
+        [&]() { num_idle++; });
+    worker_ptr = &worker;
+    worker.start();
+
+    const std::vector<uint8_t> packet{ 1, 2, 3, 4 };
+    const auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    for (size_t i = 0; i < 3; i++)
+    {
+        iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+        ASSERT_TRUE(worker.push_received(msg, i));
+    }
+
+    std::vector<size_t> sent;
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (worker.is_busy() && std::chrono::steady_clock::now() < deadline)
+    {
+        worker.drain_outgoing([&](const MDNS_Worker::Datagram& d) {
+            EXPECT_EQ(d.size, packet.size());
+            sent.push_back(d.listener_ix);
+        });
+        std::this_thread::sleep_for(1ms);
+    }
+    worker.stop();
+
+    EXPECT_EQ(num_processed, 3);
+    EXPECT_TRUE(on_worker);
+    EXPECT_GE(num_idle, 1);
+    EXPECT_THAT(sent, ElementsAre(0, 1, 2));
+    EXPECT_EQ(worker.get_num_dropped(), 0);
+}
+
+// Test that commands run on the worker, before the datagrams queued after
+// them
+TEST(MDNS_WorkerTest, RunsCommandsBeforeLaterDatagrams)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+
+    std::vector<int> order;
+    std::atomic<bool> on_worker{ false };
+    MDNS_Worker* worker_ptr = nullptr;
+
+    MDNS_Worker worker(
+        logger,
+        [&](const iuring::ReceivedMessage&, size_t,
+            std::chrono::steady_clock::time_point) { order.push_back(2); },
+        []() {});
+    worker_ptr = &worker;
+
+    // may be asked before the thread exists
+    EXPECT_FALSE(worker.is_worker_thread());
+
+    ASSERT_TRUE(worker.push_command([&]() {
+        on_worker = worker_ptr->is_worker_thread();
+        order.push_back(1);
+    }));
+    const std::vector<uint8_t> packet{ 1, 2, 3, 4 };
+    const auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+    ASSERT_TRUE(worker.push_received(msg, 0));
+    EXPECT_TRUE(worker.is_busy());
+    worker.start();
+
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (worker.is_busy() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    worker.stop();
+
+    EXPECT_TRUE(on_worker);
+    EXPECT_FALSE(worker.is_worker_thread());
+    EXPECT_THAT(order, ElementsAre(1, 2));
+}
+
+// Test that commands left when the worker stopped can still be run and a
+// full command ring is reported
+TEST(MDNS_WorkerTest, RunsLeftoverCommandsAfterStop)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    MDNS_Worker worker(
+        logger,
+        [](const iuring::ReceivedMessage&, size_t,
+            std::chrono::steady_clock::time_point) {},
+        []() {});
+
+    size_t num_run = 0;
+    for (size_t i = 0; i < MDNS_Worker::COMMAND_RING_SIZE; i++)
+    {
+        ASSERT_TRUE(worker.push_command([&num_run]() { num_run++; }));
+    }
+    EXPECT_FALSE(worker.push_command([&num_run]() { num_run++; }));
+
+    EXPECT_EQ(worker.run_commands(), MDNS_Worker::COMMAND_RING_SIZE);
+    EXPECT_EQ(num_run, MDNS_Worker::COMMAND_RING_SIZE);
+    EXPECT_FALSE(worker.is_busy());
+}
+
+// Test that a datagram of the largest size RFC 6762 allows reaches the
+// worker whole
+TEST(MDNS_WorkerTest, ProcessesJumboDatagrams)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    std::atomic<size_t> processed_size{ 0 };
+    std::atomic<bool> intact{ false };
+    std::vector<uint8_t> packet(MDNS_Worker::MAX_RECEIVED_SIZE);
+    for (size_t i = 0; i < packet.size(); i++)
+    {
+        packet[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    MDNS_Worker worker(
+        logger,
+        [&](const iuring::ReceivedMessage& msg, size_t,
+            std::chrono::steady_clock::time_point) {
+            intact = std::equal(msg.begin(), msg.end(), packet.begin());
+            processed_size = msg.get_size();
+        },
+        []() {});
+    worker.start();
+
+    const auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+    ASSERT_TRUE(worker.push_received(msg, 0));
+
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (worker.is_busy() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    worker.stop();
+
+    EXPECT_EQ(processed_size, packet.size());
+    EXPECT_TRUE(intact);
+    EXPECT_EQ(worker.get_num_dropped(), 0);
+}
+
+// Test that oversized datagrams are dropped instead of truncated
+TEST(MDNS_WorkerTest, DropsOversizedDatagrams)
+{
+    logging::DirectConsoleLogger logger(true, true, logging::LogOutput::CONSOLE);
+    MDNS_Worker worker(
+        logger,
+        [](const iuring::ReceivedMessage&, size_t,
+            std::chrono::steady_clock::time_point) {},
+        []() {});
+
+    const std::vector<uint8_t> packet(MDNS_Worker::MAX_RECEIVED_SIZE + 1);
+    const auto src_addr = iuring::IPAddress::parse("192.168.1.50").value();
+    iuring::ReceivedMessage msg(packet.data(), packet.size(), src_addr);
+
+    EXPECT_FALSE(worker.push_received(msg, 0));
+    EXPECT_EQ(worker.get_num_dropped(), 1);
+    EXPECT_FALSE(worker.is_busy());
+}
+
+} // anonymous namespace
@@ -0,0 +1,150 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include <iuring/ReceivedMessage.hpp>
+#include <mdns/MDNS_Header.hpp>
+#include <mdns/MDNS_HotLog.hpp>
+
+#include "../src/mdns/MDNS_Decoder.hpp"
+#include "allocation_hooks.hpp"
+#include "mdns_service_setup.hpp"
+#include "mdns_test_helpers.hpp"
+
+using namespace testing;
+using namespace mdns;
+using namespace mdns::test;
+
+namespace
+{
+
+// the query path has to stay off the heap once it is warmed up, any
+// allocation that creeps back in fails this test. Queries go in through
+// the receive path, the kernel's idle task answers them and the replies
+// are submitted to the mocked io_uring, as on a live interface.
+class MDNS_ZeroAllocTest : public Test
+{
+protected:
+    static constexpr size_t WARMUP_ROUNDS = 4;
+    static constexpr size_t MEASURED_ROUNDS = 100;
+    // long enough for the idle task to run a few times
+    static constexpr auto ROUND_TIME = std::chrono::milliseconds(1);
+
+    MDNS_ZeroAllocTest()
+    {
+        EXPECT_TRUE(setup.service->add_service(MDNS_ServiceInstance{
+                .instance_name = "studio-a",
+                .service_type = { "_http", "_tcp", "local" },
+                .subtypes = { "_ravenna" },
+                .host_name = { "studio-a", "local" },
+                .port = 8080,
+                .txt = "path=/" }));
+
+        const auto from = iuring::IPAddress::parse("192.168.1.50").value();
+        const std::vector<std::vector<std::string>> names{
+            { "_ravenna", "_sub", "_http", "_tcp", "local" },
+            { "_nmos-node", "_tcp", "local" },
+            { "_http", "_tcp", "local" },
+            { "studio-a", "_http", "_tcp", "local" },
+            { "_printer", "_tcp", "local" },
+        };
+        for (const auto& name : names)
+        {
+            const auto& packet =
+                packets.emplace_back(create_mdns_query_packet(0, name));
+            messages.emplace_back(packet.data(), packet.size(), from);
+        }
+    }
+
+    ~MDNS_ZeroAllocTest() override
+    {
+        set_hot_log_level(saved_log_level);
+    }
+
+    void run(size_t num_rounds)
+    {
+        for (size_t round = 0; round < num_rounds; round++)
+        {
+            // the records were multicast a moment ago, forget that so every
+            // round encodes and sends them again
+            MDNS_ServiceProbe::reset_rate_limiters(*setup.service);
+            for (const auto& msg : messages)
+            {
+                setup.recv_callbacks.front()(msg);
+            }
+            setup.rt_kernel->run(ROUND_TIME);
+            EXPECT_EQ(
+                MDNS_ServiceProbe::num_pending_queries(*setup.service), 0);
+        }
+    }
+
+    // gmock allocates on every call of a mocked method, a send makes three
+    uint64_t allocations_per_mock_send()
+    {
+        constexpr uint64_t num_sends = 16;
+        const std::shared_ptr<iuring::ISocket> socket;
+        const iuring::DatagramSendParameters params{};
+        const auto before = get_num_allocations();
+        for (uint64_t i = 0; i < num_sends; i++)
+        {
+            auto wi = setup.network->ackuire_send_workitem(socket);
+            (void) wi->get_send_packet();
+            wi->submit_packet(params, [](const iuring::SendResult&) {});
+        }
+        return (get_num_allocations() - before) / num_sends;
+    }
+
+    const MDNS_LogLevel saved_log_level =
+        hot_log_level().load(std::memory_order_relaxed);
+    MDNS_ServiceSetup setup;
+    std::deque<std::vector<uint8_t>> packets;
+    std::deque<iuring::ReceivedMessage> messages;
+};
+
+// Test that receiving, answering and sending queries doesn't allocate
+TEST_F(MDNS_ZeroAllocTest, SteadyStateQueriesDontAllocate)
+{
+    // lets the announcement of the new service go out first
+    setup.rt_kernel->run(2 * MDNS_Service::ANNOUNCE_DEBOUNCE);
+
+    // sizes the question slots, the rate limiter tables and the handlers'
+    // static names
+    run(WARMUP_ROUNDS);
+    const auto per_mock_send = allocations_per_mock_send();
+
+    const auto sends_before = setup.num_submitted;
+    const auto allocations_before = get_num_allocations();
+    run(MEASURED_ROUNDS);
+    const auto num_allocations = get_num_allocations() - allocations_before;
+    const auto num_sends = setup.num_submitted - sends_before;
+
+    // at least one reply datagram per round, and nothing allocated but
+    // what the mock itself does per send
+    EXPECT_GE(num_sends, MEASURED_ROUNDS);
+    EXPECT_EQ(num_allocations, num_sends * per_mock_send);
+
+    const auto metrics = setup.service->get_metrics();
+    EXPECT_GE(metrics.latency_count, MEASURED_ROUNDS);
+}
+
+// Test that decoding a name doesn't allocate, however long its labels
+TEST_F(MDNS_ZeroAllocTest, DecodingNamesDoesntAllocate)
+{
+    const auto packet = create_mdns_query_packet(
+        0, { "a-label-too-long-for-sso", "_http", "_tcp", "local" });
+    const auto* name = packet.data() + sizeof(MDNS_Header);
+
+    name_list_t name_list;
+    MDNS_MalformedReason error{};
+    const auto before = get_num_allocations();
+    ASSERT_NE(MDNS_Decoder::decode_name(packet.data(),
+                  packet.data() + packet.size(), name, name_list, error),
+        nullptr);
+    EXPECT_EQ(get_num_allocations(), before);
+    EXPECT_EQ(name_list.size(), 4);
+}
+
+} // anonymous namespace